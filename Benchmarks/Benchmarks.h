@@ -0,0 +1,29 @@
+#pragma once
+
+namespace NCL {
+	namespace CSC8503 {
+		//Each prints what it measured and whether that met its target, as
+		//PASS or FAIL
+
+		//Floods a server with small packets over loopback
+		void TestNetworkThroughput();
+
+		//Saves, restores and rolls back a world of this many bodies
+		void TestRollback(int bodies);
+
+		//A* and JPS over generated grids, in queries a second
+		void TestPathfindingSpeed();
+
+		//HPA* against A* on a big map, held to microsecond query targets
+		void TestHierarchicalPathfinding();
+
+		//A crowd pathing to one goal, one A* each against one flow field
+		void TestFlowFieldCrowd();
+
+		//Many agents re-pathing on one frame, inline and through the service
+		void TestPathfindingService();
+
+		//Navmesh queries between random triangles, smoothed and not
+		void TestNavMeshSpeed();
+	}
+}
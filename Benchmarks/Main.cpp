@@ -0,0 +1,42 @@
+#include "Benchmarks.h"
+
+#include <string>
+#include <iostream>
+
+using namespace NCL;
+using namespace CSC8503;
+
+/*
+
+Runs the engine's benchmarks with no window, so they can go on a build
+machine or a server as easily as a desk:
+
+Benchmarks -netbench
+Benchmarks -rollbackbench [bodies]
+Benchmarks -pathbench
+
+Bodies is how big a world to roll back, 5000 by default. Each one prints what it measured against its target, and PASS or FAIL.
+
+*/
+
+int main(int argc, char** argv) {
+	std::string test = argc > 1 ? argv[1] : "";
+	if (test == "-netbench") {
+		TestNetworkThroughput();
+		return 0;
+	}
+	if (test == "-rollbackbench") {
+		TestRollback(argc > 2 ? std::stoi(argv[2]) : 5000);
+		return 0;
+	}
+	if (test == "-pathbench") {
+		TestPathfindingSpeed();
+		TestHierarchicalPathfinding();
+		TestFlowFieldCrowd();
+		TestPathfindingService();
+		TestNavMeshSpeed();
+		return 0;
+	}
+	std::cout << "Usage: Benchmarks -netbench | -rollbackbench [bodies] | -pathbench" << std::endl;
+	return 1;
+}
@@ -0,0 +1,85 @@
+#include "Benchmarks.h"
+#include "NavigationMesh.h"
+
+#include <chrono>
+#include <random>
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	//A flat navmesh of size by size squares, each split into two triangles,
+	//with roughly one square in holeChance left out
+	void MakeBenchmarkMesh(int size, float holeChance, unsigned int seed, std::vector<Vector3>& vertices, std::vector<int>& indices) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+
+		for (int y = 0; y <= size; ++y) {
+			for (int x = 0; x <= size; ++x) {
+				vertices.emplace_back(x * 10.0f, 0.0f, y * 10.0f);
+			}
+		}
+		for (int y = 0; y < size; ++y) {
+			for (int x = 0; x < size; ++x) {
+				if (chance(random) < holeChance) {
+					continue;
+				}
+				int a = y * (size + 1) + x;
+				int b = a + 1;
+				int c = a + size + 1;
+				int d = c + 1;
+				indices.insert(indices.end(), { a, c, b, b, c, d });
+			}
+		}
+	}
+}
+
+//Times navmesh queries between random triangles, on a mesh of a few
+//hundred thousand triangles
+void NCL::CSC8503::TestNavMeshSpeed() {
+	const int queries = 50;
+
+	std::vector<Vector3>	vertices;
+	std::vector<int>		indices;
+	MakeBenchmarkMesh(300, 0.15f, 1234, vertices, indices);
+	NavigationMesh mesh(vertices, indices);
+
+	const auto& tris = mesh.GetTriangles();
+	std::mt19937 random(5678);
+	std::uniform_int_distribution<int> pick(0, (int)tris.size() - 1);
+
+	std::vector<std::pair<Vector3, Vector3>> pairs;
+	for (int i = 0; i < queries; ++i) {
+		pairs.emplace_back(tris[pick(random)].centroid, tris[pick(random)].centroid);
+	}
+	GridSearchScratch scratch;
+	int			found		= 0;
+	long long	expanded	= 0;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (auto& [from, to] : pairs) {
+		NavigationPath path;
+		found		+= mesh.FindPath(from, to, path, scratch) ? 1 : 0;
+		expanded	+= scratch.expanded;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	//How many waypoints an agent has to steer through, pulled tight or not
+	long long waypoints[2] = { 0, 0 };
+	for (int smooth = 0; smooth < 2; ++smooth) {
+		mesh.SetPathSmoothing(smooth == 1);
+		for (auto& [from, to] : pairs) {
+			NavigationPath path;
+			mesh.FindPath(from, to, path, scratch);
+			Vector3 waypoint;
+			while (path.PopWaypoint(waypoint)) {
+				waypoints[smooth]++;
+			}
+		}
+	}
+
+	std::cout << "Navmesh, " << tris.size() << " triangles: " << seconds / pairs.size() * 1000.0 << "ms a query, "
+		<< expanded / (long long)pairs.size() << " triangles expanded on average, " << found << "/" << pairs.size() << " found" << std::endl;
+	std::cout << "Navmesh waypoints a path: " << waypoints[1] / (double)pairs.size() << " pulled tight, "
+		<< waypoints[0] / (double)pairs.size() << " through every centroid" << std::endl;
+}
@@ -0,0 +1,75 @@
+#include "Benchmarks.h"
+#include "GameServer.h"
+#include "GameClient.h"
+#include "NetworkObject.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	//Counts packets without doing anything else, so the benchmark only
+	//measures the receive loop and dispatch
+	class CountingPacketReceiver : public PacketReceiver {
+	public:
+		void ReceivePacket(int, GamePacket*, int) override {
+			count++;
+		}
+		int count = 0;
+	};
+}
+
+//Floods the server with small packets over loopback and reports how many
+//it got through per second
+void NCL::CSC8503::TestNetworkThroughput() {
+	const int totalPackets	= 500000;
+	const int batchSize		= 200;
+	const double target		= 100000.0;
+
+	NetworkBase::Initialise();
+	int port = NetworkBase::GetDefaultPort();
+
+	GameServer* server = new GameServer(port, 1);
+	GameClient* client = new GameClient();
+
+	CountingPacketReceiver serverReceiver;
+	server->RegisterPacketHandler(Player_Input, &serverReceiver);
+
+	client->Connect(127, 0, 0, 1, port);
+	for (int i = 0; i < 100; ++i) {
+		server->UpdateServer();
+		client->UpdateClient();
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	ClientPacket packet;
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (int sent = 0; sent < totalPackets; ) {
+		for (int i = 0; i < batchSize; ++i, ++sent) {
+			packet.sequence = sent;
+			client->SendPacket(packet);
+		}
+		client->UpdateClient();
+		server->UpdateServer();
+	}
+	//Give anything still in flight a moment to land
+	for (int i = 0; i < 50; ++i) {
+		client->UpdateClient();
+		server->UpdateServer();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	double seconds = std::chrono::duration<double>(end - start).count();
+	double rate		= serverReceiver.count / seconds;
+
+	std::cout << "Sent " << totalPackets << " packets, received " << serverReceiver.count
+		<< " in " << seconds << "s (" << (int)rate << " packets/sec) - "
+		<< (rate >= target ? "PASS" : "FAIL") << std::endl;
+
+	delete client;
+	delete server;
+	NetworkBase::Destroy();
+}
@@ -0,0 +1,66 @@
+#include "Benchmarks.h"
+#include "LockstepSimulation.h"
+#include "RollbackManager.h"
+#include "PhysicsObject.h"
+
+#include <chrono>
+
+using namespace NCL;
+using namespace CSC8503;
+
+//Saves and restores a world of the given size over and over, then checks
+//that rolling back and resimulating lands exactly where it did the first
+//time
+void NCL::CSC8503::TestRollback(int bodies) {
+	const int		iterations		= 200;
+	const double	target			= 1.0; //ms for one save and one restore
+	const float		resimBudget		= LockstepSimulation::GetTickDT(); //a full rollback has to fit in one tick
+
+	LockstepSimulation sim(1, 1234, bodies);
+	GameWorld&		world	= sim.GetWorld();
+	PhysicsSystem&	physics = sim.GetPhysics();
+
+	//Each frame pushes the player a different way, so a resimulation that
+	//replayed the wrong frame's input would end up somewhere else
+	auto step = [&](int frame) {
+		float push = (float)(frame % 7 - 3) * 10.0f;
+		sim.GetPlayer(0)->GetPhysicsObject()->AddForce(Vector3(push, 0.0f, -push));
+		world.UpdateWorld(LockstepSimulation::GetTickDT());
+		physics.FixedUpdate();
+	};
+	//Let things land on each other, so there are collisions to save too
+	for (int i = 0; i < 60; ++i) {
+		step(i);
+	}
+	WorldSnapshot snapshot;
+	world.SaveState(snapshot); //the first save sizes the buffers
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		world.SaveState(snapshot);
+		world.RestoreState(snapshot);
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+
+	std::cout << "Save + restore of " << snapshot.GetObjectCount() << " objects ("
+		<< snapshot.GetSizeInBytes() / 1024 << "KB) took " << ms << "ms - "
+		<< (ms < target ? "PASS" : "FAIL") << std::endl;
+
+	RollbackManager rollback(world, physics, 8);
+	int frame = 0;
+	for (; frame < 30; ++frame) {
+		rollback.SaveFrame(frame);
+		step(frame);
+	}
+	uint32_t before = LockstepSession::HashWorld(world);
+	bool rolledBack = rollback.Rollback(frame - rollback.GetMaxRollback(), frame, step);
+	uint32_t after	= LockstepSession::HashWorld(world);
+
+	float rollbackTime = rollback.GetAverageRollbackTime();
+	bool  matches		= rolledBack && before == after;
+	std::cout << "Rolled back " << rollback.GetMaxRollback() << " frames in "
+		<< rollbackTime * 1000.0f << "ms (budget " << resimBudget * 1000.0f << "ms), world "
+		<< (matches ? "matches" : "differs") << " - "
+		<< (matches && rollbackTime <= resimBudget ? "PASS" : "FAIL") << std::endl;
+}
@@ -20,4 +20,8 @@ void NetworkPlayer::OnCollisionBegin(GameObject* otherObject) {
 		}
 	}
 	GameObject::OnCollisionBegin(otherObject);
+}
+
+void NetworkPlayer::ApplyInput(const PlayerInput& input, bool isNewInput, float share) {
+	PlayerMovement::ApplyInput(*this, input, isNewInput, share);
 }
\ No newline at end of file
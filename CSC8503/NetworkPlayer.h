@@ -1,6 +1,7 @@
 #pragma once
 #include "GameObject.h"
 #include "GameClient.h"
+#include "PlayerMovement.h"
 
 struct PlayerUpdatePacket : public GamePacket {
 	int playerID;
@@ -37,6 +38,10 @@ namespace NCL {
 				networkObject = obj;
 			}
 
+			//Turns a set of button states into forces - the server and the
+			//predicting client both move the player through this
+			void ApplyInput(const PlayerInput& input, bool isNewInput, float share = 1.0f);
+
 		protected:
 			NetworkedGame* game;
 			int playerNum;
@@ -1,9 +1,15 @@
 #include "NetworkedGame.h"
 #include "NetworkPlayer.h"
 #include "NetworkObject.h"
+#include "PhysicsObject.h"
 #include "GameServer.h"
 #include "GameClient.h"
-#include "AckPacket.h"
+#include "ClientPrediction.h"
+#include "LagCompensator.h"
+#include "EntityReplicator.h"
+#include "FlowField.h"
+#include "PathfindingService.h"
+#include "NavMeshBuilder.h"
 
 #include "BehaviourNode.h"
 #include "BehaviourSelector.h"
@@ -30,7 +36,13 @@ NetworkedGame::NetworkedGame(bool isServer)	{
 	NetworkBase::Initialise();
 	timeToNextPacket  = 0.0f;
 	packetsToSnapshot = 0;
+	networkTime		  = 0.0f;
+	packetInterval	  = 1.0f / 20.0f; //20hz server/client update
+	inputInterval	  = 1.0f / 60.0f; //inputs go out faster so the server stays close to us
+	shotImpulse		  = 20.0f;
 	std::cout << "NetworkedGame Created!" << std::endl;
+	replicator = new EntityReplicator(*world, *physics, FIRST_DYNAMIC_ID);
+	RegisterPrefabs();
 	StartLevel();
 	TestPathfinding();
 
@@ -45,7 +57,7 @@ NetworkedGame::NetworkedGame(bool isServer)	{
 	client = nullptr;
 	server = nullptr;
 	if (isServer) {
-		server = new GameServer(port, 1);
+		server = new GameServer(port, MAX_CLIENTS);
 
 		//this->StartAsServer();
 		//server = thisServer; // initialize the server
@@ -53,7 +65,11 @@ NetworkedGame::NetworkedGame(bool isServer)	{
 		server->RegisterPacketHandler(Received_State, serverReceiver);
 		server->RegisterPacketHandler(Client_Connected, serverReceiver);
 		server->RegisterPacketHandler(Client_Disconnected, serverReceiver);
-		server->RegisterPacketHandler(Player_Update, serverReceiver);
+		server->RegisterPacketHandler(Player_Update, serverReceiver, (int)(sizeof(PlayerUpdatePacket) - sizeof(GamePacket)));
+		server->RegisterPacketHandler(Player_Input, serverReceiver);
+		server->RegisterPacketHandler(Raycast_Request, serverReceiver);
+		server->RegisterPacketHandler(Ack_State, serverReceiver);
+		server->StartNetworkThread();
 	}
 	else {
 		client = new GameClient();
@@ -64,146 +80,132 @@ NetworkedGame::NetworkedGame(bool isServer)	{
 		client->RegisterPacketHandler(Full_State, clientReceiver);
 		client->RegisterPacketHandler(Server_Connected, clientReceiver);
 		client->RegisterPacketHandler(Server_Disconnected, clientReceiver);
-		client->RegisterPacketHandler(Player_Update, clientReceiver);
+		client->RegisterPacketHandler(Player_Update, clientReceiver, (int)(sizeof(PlayerUpdatePacket) - sizeof(GamePacket)));
+		client->RegisterPacketHandler(Player_State, clientReceiver);
+		client->RegisterPacketHandler(Entity_Spawn, replicator);
+		client->RegisterPacketHandler(Entity_Despawn, replicator);
 
 		client->Connect(127, 0, 0, 1, port);
+		client->StartNetworkThread();
 	}
 
 	StartLevel();
-	
+
+	if (server) {
+		lagCompensator = new LagCompensator(*world);
+	}
 }
 
 NetworkedGame::~NetworkedGame()	{
+	delete prediction;
+	delete lagCompensator;
 	delete server;
 	delete client;
+	delete replicator;
+	delete pathfinding; //before the grid its searches might be using
+	delete flowFields;
+	delete navMeshBuilder;
 }
 
-void TestPacketReceiver::ReceivePacket(int type, GamePacket* payload, int source) {
-	if (type < 0) {
-		std::cerr << "Invalid packet type received: " << type << std::endl;
-		return;
-	}
-
-	std::cout << "Received packet of type: " << type << " from source: " << source << " Size: " << payload->size << std::endl;
-	if (type == String_Message) {
-		StringPacket* realPacket = (StringPacket*)payload;
-
-		std::string message = realPacket->GetStringFromData();
-
-		std::cout << name << " received message: " << message << std::endl;
-	}
-
-	if (type == Client_Connected) {
-		std::cout << name << " received client connected message" << std::endl;
-
-		game->OnPlayerConnected(source);
-
-	}
-
-	if (type == Client_Disconnected) {
-		std::cout << name << " received client disconnected message" << std::endl;
-
-	}
-
-	if (type == Server_Connected) {
-		std::cout << name << " received server connected message" << std::endl;
-
-		ServerConnectedPacket* serverPacket = (ServerConnectedPacket*)payload;
-		int serverID = serverPacket->serverID; // Assuming server packet contains an ID or other data
-
-		std::cout << "Connected to server with ID: " << serverID << std::endl;
-	}
-
-	if (type == Server_Disconnected) {
-		std::cout << name << " received server disconnected message" << std::endl;
-	}
-
-	if (type == Player_Update) {
-		PlayerUpdatePacket* updatePacket = (PlayerUpdatePacket*)payload;
-
-		Vector3 newPosition = updatePacket->position;
-		Quaternion newOrientation = updatePacket->orientation;
-
-		std::cout << name << " received Player_Update for Player ID: " << source << std::endl;
-
-		// Locate the player object in the game world
-		auto playerIter = game->playerPeerMap.find(source);
-		if (playerIter != game->playerPeerMap.end()) {
-			NetworkPlayer* player = playerIter->second;
-
-			// Update the player's position and orientation
-			player->GetTransform().SetPosition(newPosition);
-			player->GetTransform().SetOrientation(newOrientation);
-
-			/*std::cout << "Updated Player ID " << source
-				<< " to Position: " << newPosition.x << ", " << newPosition.y << ", " << newPosition.z
-				<< " and Orientation: " << newOrientation.x << newOrientation.y << newOrientation.z << std::endl;*/
-		}
-		else {
-			std::cerr << "Player ID " << source << " not found in playerPeerMap!" << std::endl;
-		}
-	}
-
-	if (type == Full_State) {
-		FullPacket* fullPacket = (FullPacket*)payload;
-
-		int objectID = fullPacket->objectID; // Extract the ID of the networked object
-		NetworkState fullState = fullPacket->fullState; // Extract the state data
-
-		std::cout << name << " received Full_State for Object ID: " << objectID << std::endl;
-
-		// Locate the network object in the game
-		auto objectIter = game->networkObjects.find(objectID);
-		if (objectIter != game->networkObjects.end()) {
-			NetworkObject* networkObject = objectIter->second;
+//Both ends have to build the same thing for each ID, so these are the only
+//things the server can ask a client to create
+void NetworkedGame::RegisterPrefabs() {
+	replicator->RegisterPrefab(Prefab_Crate, [this](const Vector3& position, const Quaternion&) {
+		return AddCubeToWorld(position, Vector3(1, 1, 1), 1.0f);
+	});
+	replicator->RegisterPrefab(Prefab_Ball, [this](const Vector3& position, const Quaternion&) {
+		return AddSphereToWorld(position, 1.0f, 1.0f, false);
+	});
+	replicator->RegisterPrefab(Prefab_Bonus, [this](const Vector3& position, const Quaternion&) {
+		return AddBonusToWorld(position);
+	});
+}
 
-			std::cout << "Updated Object ID " << objectID
-				<< " to Position: " << fullState.position.x << ", "
-				<< fullState.position.y << ", " << fullState.position.z
-				<< " and Orientation: " << fullState.orientation.x << ", "
-				<< fullState.orientation.y << ", " << fullState.orientation.z
-				<< ", " << fullState.orientation.w << std::endl;
+NetworkObject* NetworkedGame::GetNetworkObject(int id) const {
+	return replicator->GetNetworkObject(id);
+}
 
-			// Apply the full state to the network object
+void TestPacketReceiver::ReceivePacket(int type, GamePacket* payload, int source) {
+	//The payload points straight into enet's receive buffer, so each case
+	//reads it in place rather than copying it out first
+	switch (type) {
+		case String_Message: {
+			StringPacket* realPacket = (StringPacket*)payload;
+			NET_LOG_INFO(name << " received message: " << realPacket->GetStringFromData());
+		}break;
+		case Client_Connected: {
+			NET_LOG_INFO(name << " received client connected message");
+			game->OnPlayerConnected(source);
+		}break;
+		case Client_Disconnected: {
+			NET_LOG_INFO(name << " received client disconnected message");
+			game->OnPlayerDisconnected(source);
+		}break;
+		case Server_Connected: {
+			NET_LOG_INFO(name << " received server connected message");
+		}break;
+		case Server_Disconnected: {
+			NET_LOG_INFO(name << " received server disconnected message");
+		}break;
+		case Player_Update: {
+			PlayerUpdatePacket* updatePacket = (PlayerUpdatePacket*)payload;
+
+			// Locate the player object in the game world
+			auto playerIter = game->playerPeerMap.find(source);
+			if (playerIter == game->playerPeerMap.end()) {
+				NET_LOG_ERROR("Player ID " << source << " not found in playerPeerMap!");
+				break;
+			}
+			playerIter->second->GetTransform().SetPosition(updatePacket->position);
+			playerIter->second->GetTransform().SetOrientation(updatePacket->orientation);
+		}break;
+		case Player_Input: {
+			game->OnPlayerInput(source, *(ClientPacket*)payload);
+		}break;
+		case Ack_State: {
+			game->OnStateAcknowledged(source, *(AckPacket*)payload);
+		}break;
+		case Player_State: {
+			game->OnPlayerState(*(PlayerStatePacket*)payload);
+		}break;
+		case Raycast_Request: {
+			game->OnRaycastRequest(source, *(RaycastRequestPacket*)payload);
+		}break;
+		case Full_State: {
+			FullPacket* fullPacket = (FullPacket*)payload;
+			NetworkObject* networkObject = game->GetNetworkObject(fullPacket->objectID);
+			if (!networkObject) {
+				//Snapshots aren't ordered with spawns, so one can beat its object here
+				NET_LOG_PACKET("Object ID " << fullPacket->objectID << " hasn't been spawned yet");
+				break;
+			}
+			NET_LOG_PACKET(name << " received Full_State for Object ID: " << fullPacket->objectID);
 			networkObject->ReadFullPacket(*fullPacket);
-		}
-		else {
-			std::cerr << "Object ID " << objectID << " not found in networkObjects!" << std::endl;
-		}
-	}
-
-	if (type == Delta_State) {
-		DeltaPacket* deltaPacket = (DeltaPacket*)payload;
-
-		int objectID = deltaPacket->objectID; // Extract the ID of the networked object
-
-		std::cout << name << " received Delta_State for Object ID: " << objectID << std::endl;
-
-		// Locate the network object in the game
-		auto objectIter = game->networkObjects.find(objectID);
-		if (objectIter != game->networkObjects.end()) {
-			NetworkObject* networkObject = objectIter->second;
-
-			// Apply the delta state to the network object
+		}break;
+		case Delta_State: {
+			DeltaPacket* deltaPacket = (DeltaPacket*)payload;
+			NetworkObject* networkObject = game->GetNetworkObject(deltaPacket->objectID);
+			if (!networkObject) {
+				//Snapshots aren't ordered with spawns, so one can beat its object here
+				NET_LOG_PACKET("Object ID " << deltaPacket->objectID << " hasn't been spawned yet");
+				break;
+			}
+			NET_LOG_PACKET(name << " received Delta_State for Object ID: " << deltaPacket->objectID);
 			networkObject->ReadDeltaPacket(*deltaPacket);
-
-			std::cout << "Updated Object ID " << objectID
-				<< " to Position: " << networkObject->GetLatestNetworkState().position.x << ", "
-				<< networkObject->GetLatestNetworkState().position.y << ", "
-				<< networkObject->GetLatestNetworkState().position.z
-				<< " and Orientation: " << networkObject->GetLatestNetworkState().orientation.x << ", "
-				<< networkObject->GetLatestNetworkState().orientation.y << ", "
-				<< networkObject->GetLatestNetworkState().orientation.z << ", "
-				<< networkObject->GetLatestNetworkState().orientation.w << std::endl;
-		}
-		else {
-			std::cerr << "Object ID " << objectID << " not found in networkObjects!" << std::endl;
-		}
+		}break;
 	}
 }
 
 void NetworkedGame::UpdateGame(float dt) {
+	networkTime		 += dt;
 	timeToNextPacket -= dt;
+
+	//Recorded before physics moves anything, so each frame lines up with
+	//the timestamp on the snapshots written this frame
+	if (lagCompensator) {
+		lagCompensator->RecordFrame(networkTime);
+	}
+
 	if (timeToNextPacket < 0) {
 		if (server) {
 			UpdateAsServer(dt);
@@ -211,20 +213,41 @@ void NetworkedGame::UpdateGame(float dt) {
 		else if (client) {
 			UpdateAsClient(dt);
 		}
-		timeToNextPacket += 1.0f / 20.0f; //20hz server/client update
+		timeToNextPacket += packetInterval;
 	}
 
 	DisplayPathfinding();
+	DisplayNetworkStats();
 
 	if (client) {
 		Debug::Print("This is Client Player", Vector2(2, 15), Debug::MAGENTA);
 		client->UpdateClient();
+		UpdateNetworkObjects(dt);
+		UpdateLocalInput(dt);
 	}
 	if (server) {
 		Debug::Print("This is Server Player", Vector2(2, 15), Debug::MAGENTA);
 		server->UpdateServer();
+		ApplyClientInputs(dt);
+		UpdateSpawnKeys();
 	}
 	
+	if (pathfinding) {
+		pathfinding->Update();
+	}
+	if (flowFields) {
+		flowFields->Update();
+	}
+	//Boxes hardly ever move, so there's no need to look for ones that have
+	//every frame. Only the tiles under any that have get rebuilt.
+	navMeshUpdateTimer -= dt;
+	if (navMeshBuilder && navMeshUpdateTimer < 0.0f) {
+		navMeshUpdateTimer = navMeshUpdateInterval;
+		if (navMeshBuilder->Update(*world) > 0) {
+			NavMeshPathFinding();
+		}
+	}
+
 	if (angryGoose) {
 		angryGoose->Update(dt);
 	}
@@ -244,24 +267,34 @@ void NetworkedGame::UpdateGame(float dt) {
 
 void NetworkedGame::UpdateAsServer(float dt) {
 	packetsToSnapshot--;
+	snapshotStateID++;
 	for (auto& [playerID, player] : playerPeerMap) {
 		if (player->controllerByServer) {
 			NetworkObject* networkObj = player->GetNetworkObject();
-			if (networkObj) {
+			PeerSlot* peer = server->GetPeer(playerID);
+			if (networkObj && peer) {
+				networkObj->RecordState(snapshotStateID, networkTime);
 				GamePacket* newPacket = nullptr;
-				if (networkObj->WritePacket(&newPacket, packetsToSnapshot < 0, 0)) {
+				if (networkObj->WritePacket(&newPacket, packetsToSnapshot < 0, peer->GetAckedState(networkObj->GetNetworkID()))) {
 					server->SendPacket(*newPacket, playerID);
 					delete newPacket;
 				}
 			}
 		}
 	}
-	if (packetsToSnapshot < 0) {
+	SendPlayerStates();
+
+	//Before any snapshot, so the objects they're for are on their way first
+	replicator->Flush(*server);
+
+	//Put off until the next frame if the last one is still going out
+	if (packetsToSnapshot < 0 && server->ReadyForSnapshot()) {
 		packetsToSnapshot = 5; // Reset the snapshot counter
 
 		// Broadcast the snapshot to all clients
 		// Send snapshot data to each player
 		BroadcastSnapshot(true);
+		UpdateMinimumState();
 	}
 }
 
@@ -271,28 +304,221 @@ void NetworkedGame::UpdateAsClient(float dt) {
 		return;
 	}
 
-	if (!player2->controllerByServer) {
-		// Update player inputs and send them to the server
-		ClientPacket newPacket;
-		if (Window::GetKeyboard()->KeyPressed(KeyCodes::SPACE)) {
-			newPacket.buttonstates[0] = 1;
+	client->UpdateClient();
+
+	//Let the server know the newest full state we have for every object
+	//that's had a new one, so it knows what it can send deltas against
+	AckPacket ack;
+	for (NetworkObject* o : replicator->GetNetworkObjects()) {
+		if (!o) {
+			continue;
+		}
+		int id		= o->GetNetworkID();
+		int stateID = o->GetLatestNetworkState().stateID;
+		if (id >= (int)sentAcks.size()) {
+			sentAcks.resize(id + 1, -1);
+		}
+		if (stateID <= sentAcks[id]) {
+			continue;
+		}
+		sentAcks[id] = stateID;
+		ack.Add(id, stateID);
+		if (ack.IsFull()) {
+			client->SendPacket(ack);
+			ack = AckPacket();
 		}
-		client->SendPacket(newPacket);
 	}
-	client->UpdateClient();
+	if (ack.count > 0) {
+		client->SendPacket(ack);
+	}
 }
 
-void NetworkedGame::BroadcastSnapshot(bool deltaFrame) {
+//Samples the keyboard at a fixed rate, sends each input to the server and
+//applies it straight away rather than waiting to hear back
+void NetworkedGame::UpdateLocalInput(float dt) {
+	if (!prediction) {
+		return;
+	}
+	timeToNextInput -= dt;
+	if (timeToNextInput < 0.0f) {
+		timeToNextInput += inputInterval;
+
+		char buttons[8] = { 0 };
+		buttons[Button_Forward] = Window::GetKeyboard()->KeyDown(KeyCodes::W);
+		buttons[Button_Back]	= Window::GetKeyboard()->KeyDown(KeyCodes::S);
+		buttons[Button_Left]	= Window::GetKeyboard()->KeyDown(KeyCodes::A);
+		buttons[Button_Right]	= Window::GetKeyboard()->KeyDown(KeyCodes::D);
+		buttons[Button_Jump]	= Window::GetKeyboard()->KeyDown(KeyCodes::SPACE);
+
+		if (const PlayerInput* finished = prediction->BeginInput(buttons)) {
+			ClientPacket newPacket;
+			newPacket.lastID	= prediction->GetLastAcknowledged();
+			newPacket.sequence	= finished->sequence;
+			newPacket.duration	= finished->duration;
+			memcpy(newPacket.buttonstates, finished->buttons, sizeof(newPacket.buttonstates));
+
+			int older = 0;
+			while (older < ClientPacket::MAX_OLDER_INPUTS) {
+				const PlayerInput* resend = prediction->GetUnacknowledged(finished->sequence - 1 - older);
+				if (!resend) {
+					break;
+				}
+				newPacket.older[older].duration = resend->duration;
+				memcpy(newPacket.older[older].buttonstates, resend->buttons, sizeof(resend->buttons));
+				older++;
+			}
+			newPacket.SetOlderCount(older);
+			client->SendPacket(newPacket);
+		}
+	}
+	prediction->ApplyCurrentInput(dt);
+
+	if (Window::GetKeyboard()->KeyPressed(KeyCodes::F)) {
+		SendRaycastRequest();
+	}
+
+	Debug::Print("Pending inputs: " + std::to_string(prediction->GetPendingInputs()), Vector2(2, 20), Debug::WHITE);
+	Debug::Print("Corrections: " + std::to_string(prediction->GetCorrectionCount()), Vector2(2, 25), Debug::WHITE);
+}
+
+void NetworkedGame::OnPlayerState(PlayerStatePacket& packet) {
+	if (!prediction || !localPlayer || localPlayer->GetNetworkObject()->GetNetworkID() != packet.objectID) {
+		return;
+	}
+	PredictedState state;
+	state.position			= packet.position;
+	state.orientation		= packet.orientation;
+	state.linearVelocity	= packet.linearVelocity;
+	state.angularVelocity	= packet.angularVelocity;
+
+	prediction->Reconcile(packet.lastSequence, packet.heldFor, state);
+}
+
+//Fires a ray from the camera, telling the server when we fired it on its
+//timeline so it can check it against what was on our screen
+void NetworkedGame::SendRaycastRequest() {
+	NetworkObject* viewed = player->GetNetworkObject();
+	if (!viewed || viewed->GetInterpolationBuffer().GetSnapshotCount() == 0) {
+		return; //haven't heard from the server yet, so we have no view time
+	}
+	Ray ray = CollisionDetection::BuildRayFromMouse(world->GetMainCamera());
+
+	RaycastRequestPacket packet;
+	packet.origin		= ray.GetPosition();
+	packet.direction	= ray.GetDirection();
+	packet.viewTime		= viewed->GetInterpolationBuffer().GetRenderTime();
+
+	RayCollision closestCollision;
+	if (world->Raycast(ray, closestCollision, true, localPlayer)) {
+		NetworkObject* target = ((GameObject*)closestCollision.node)->GetNetworkObject();
+		if (target) {
+			packet.targetID = target->GetNetworkID();
+		}
+	}
+	client->SendPacket(packet);
+}
+
+void NetworkedGame::OnRaycastRequest(int playerID, RaycastRequestPacket& packet) {
+	auto playerIter = playerPeerMap.find(playerID);
+	if (!lagCompensator || playerIter == playerPeerMap.end()) {
+		return;
+	}
+	Ray ray(packet.origin, Vector::Normalise(packet.direction));
+
+	RayCollision closestCollision;
+	int hitID = -1;
+	if (lagCompensator->Raycast(ray, packet.viewTime, closestCollision, playerIter->second)) {
+		GameObject* hit = (GameObject*)closestCollision.node;
+		if (hit->GetNetworkObject()) {
+			hitID = hit->GetNetworkObject()->GetNetworkID();
+		}
+		Debug::DrawLine(packet.origin, closestCollision.collidedAt, Debug::RED, 2.0f);
+	}
+	bool confirmed = packet.targetID >= 0 && hitID == packet.targetID;
+	NET_LOG_INFO("Player " << playerID << " shot at object " << packet.targetID
+		<< (confirmed ? ", confirmed" : ", rejected") << " (rewound " << networkTime - packet.viewTime << "s)");
+
+	//The hit point is where the target was on the shooter's screen, so the
+	//shot pushes it along the ray rather than at that point. Where it ends
+	//up goes back to everyone in the snapshots.
+	if (confirmed) {
+		GameObject* hit = (GameObject*)closestCollision.node;
+		if (PhysicsObject* phys = hit->GetPhysicsObject()) {
+			phys->ApplyLinearImpulse(ray.GetDirection() * shotImpulse);
+		}
+	}
+}
+
+//Inputs wait in the peer's slot until the next frame, so several arriving
+//at once are applied in order rather than only the last one being seen
+void NetworkedGame::OnPlayerInput(int playerID, ClientPacket& packet) {
+	server->QueueInputs(playerID, packet);
+}
+
+void NetworkedGame::OnStateAcknowledged(int playerID, AckPacket& packet) {
+	server->AcknowledgeStates(playerID, packet);
+}
+
+//Each client input is held for as long as it was on the client, so the
+//server moves the player the same way the client's replay does
+void NetworkedGame::ApplyClientInputs(float dt) {
+	for (auto& [playerID, player] : playerPeerMap) {
+		PeerSlot* slot = server->GetPeer(playerID);
+		if (player->controllerByServer || !slot) {
+			continue;
+		}
+		NetworkPlayer* target = player; //structured bindings can't be captured
+		slot->inputs.Play(dt, [target](const PlayerInput& input, bool isNewInput, float share) {
+			target->ApplyInput(input, isNewInput, share);
+		});
+	}
+}
+
+//Tells each client where its own player really is, and which of its inputs
+//that position includes
+void NetworkedGame::SendPlayerStates() {
 	for (auto& [playerID, player] : playerPeerMap) {
-		std::vector<GameObject*>::const_iterator first, last;
-		world->GetObjectIterators(first, last);
+		NetworkObject* networkObj	= player->GetNetworkObject();
+		PeerSlot* slot				= server->GetPeer(playerID);
+		if (player->controllerByServer || !networkObj || !slot) {
+			continue;
+		}
+		PredictedState state = PredictedState::FromObject(*player);
+
+		PlayerStatePacket packet;
+		packet.objectID			= networkObj->GetNetworkID();
+		packet.lastSequence		= slot->inputs.current.sequence;
+		packet.heldFor			= slot->inputs.GetHeldTime();
+		packet.position			= state.position;
+		packet.orientation		= state.orientation;
+		packet.linearVelocity	= state.linearVelocity;
+		packet.angularVelocity	= state.angularVelocity;
+		server->SendPacket(packet, playerID);
+	}
+}
 
+//Every connected peer gets a snapshot, spectators included, with each
+//object's delta built against whatever state that peer last acknowledged
+//for it
+void NetworkedGame::BroadcastSnapshot(bool deltaFrame) {
+	std::vector<GameObject*>::const_iterator first, last;
+	world->GetObjectIterators(first, last);
+	for (auto i = first; i != last; ++i) {
+		if (NetworkObject* o = (*i)->GetNetworkObject()) {
+			o->RecordState(snapshotStateID, networkTime);
+		}
+	}
+	for (int peerID = 0; peerID < server->GetMaxClients(); ++peerID) {
+		PeerSlot* peer = server->GetPeer(peerID);
+		if (!peer) {
+			continue;
+		}
 		for (auto i = first; i != last; ++i) {
 			NetworkObject* o = (*i)->GetNetworkObject();
 			if (o) {
 				GamePacket* newPacket = nullptr;
-				if (o->WritePacket(&newPacket, deltaFrame, 0)) {
-					server->SendPacket(*newPacket, playerID);
+				if (o->WritePacket(&newPacket, deltaFrame, peer->GetAckedState(o->GetNetworkID()))) {
+					server->SendPacket(*newPacket, peerID);
 					delete newPacket;
 				}
 			}
@@ -300,17 +526,142 @@ void NetworkedGame::BroadcastSnapshot(bool deltaFrame) {
 	}
 }
 
-void NetworkedGame::UpdateMinimumState() {
-	//Periodically remove old data from the server
-	int minID = INT_MAX;
-	int maxID = 0; //we could use this to see if a player is lagging behind?
+namespace {
+	std::string DescribePeer(const std::string& name, const PeerNetworkStats& p) {
+		return name + ": " + std::to_string(p.roundTripTime) + "ms (+/-" + std::to_string(p.jitter) + "), loss "
+			+ std::to_string((int)(p.packetLoss * 100.0f)) + "%, " + std::to_string((int)p.sendKbps) + "/"
+			+ std::to_string((int)p.receiveKbps) + "kbps out/in, " + std::to_string(p.packetsSentPerTick).substr(0, 4) + "/"
+			+ std::to_string(p.packetsReceivedPerTick).substr(0, 4) + " pkts/tick, snapshot p50 "
+			+ std::to_string(NetworkStats::GetSnapshotPercentile(p, 0.5f)) + "B p95 "
+			+ std::to_string(NetworkStats::GetSnapshotPercentile(p, 0.95f)) + "B, delta hits "
+			+ std::to_string((int)(p.GetDeltaHitRatio() * 100.0f)) + "%";
+	}
+}
+
+//F3 starts and stops writing the same numbers to netstats.csv, and on the
+//server F4 records a replay of its traffic to replay.nrp
+void NetworkedGame::DisplayNetworkStats() {
+	NetworkBase* net = server ? (NetworkBase*)server : (NetworkBase*)client;
+	if (!net) {
+		return;
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyCodes::F3)) {
+		if (recordingNetworkStats) {
+			net->GetStats().StopCSV();
+			recordingNetworkStats = false;
+		}
+		else {
+			recordingNetworkStats = net->GetStats().StartCSV("netstats.csv");
+		}
+	}
+	if (recordingNetworkStats) {
+		Debug::Print("Recording netstats.csv (F3)", Vector2(60, 95), Debug::RED);
+	}
+	if (server && Window::GetKeyboard()->KeyPressed(KeyCodes::F4)) {
+		if (server->IsRecording()) {
+			server->StopRecording();
+		}
+		else {
+			server->StartRecording("replay.nrp");
+		}
+	}
+	if (server && server->IsRecording()) {
+		Debug::Print("Recording replay.nrp (F4): " + std::to_string(server->GetRecorder().GetBytesWritten() / 1024) + "KB",
+			Vector2(60, 90), Debug::RED);
+	}
+	DisplaySnapshotHistogram(net->GetStats());
+
+	if (client) {
+		if (const PeerNetworkStats* p = client->GetStats().GetPeer(0)) {
+			Debug::Print(DescribePeer("Server", *p), Vector2(2, 80), Debug::WHITE);
+		}
+	}
+	if (server) {
+		float line = 80.0f;
+		Debug::Print("Clients: " + std::to_string(server->GetClientCount()) + "/" + std::to_string(server->GetMaxClients()), Vector2(2, line), Debug::WHITE);
+		for (int peerID = 0; peerID < server->GetMaxClients(); ++peerID) {
+			if (const PeerNetworkStats* p = server->GetStats().GetPeer(peerID)) {
+				line -= 5.0f;
+				Debug::Print(DescribePeer("Peer " + std::to_string(peerID), *p), Vector2(2, line), Debug::WHITE);
+			}
+		}
+	}
+	if (!net->IsThreaded()) {
+		return;
+	}
+	NetworkThreadStats stats = net->GetThreadStats();
+	Debug::Print("Net queues in/out: " + std::to_string(stats.incomingDepth) + "/" + std::to_string(stats.outgoingDepth)
+		+ " (max " + std::to_string(stats.maxIncomingDepth) + "/" + std::to_string(stats.maxOutgoingDepth) + ")", Vector2(2, 85), Debug::WHITE);
+	Debug::Print("Net service: " + std::to_string(stats.averageServiceTime * 1000.0f) + "ms, queue delay "
+		+ std::to_string(stats.averageQueueDelay * 1000.0f) + "ms, stale dropped " + std::to_string(stats.droppedStale)
+		+ ", snapshots held " + std::to_string(stats.heldSnapshots), Vector2(2, 90), Debug::WHITE);
+}
+
+//Snapshot bytes per tick summed over every peer, one row per bucket
+void NetworkedGame::DisplaySnapshotHistogram(const NetworkStats& stats) {
+	const int maxBar = 20;
+
+	int counts[PeerNetworkStats::HISTOGRAM_BUCKETS] = {};
+	int highest = 0;
+	int last	= -1;
+	for (int peerID = 0; peerID < stats.GetPeerCount(); ++peerID) {
+		const PeerNetworkStats* p = stats.GetPeer(peerID);
+		if (!p) {
+			continue;
+		}
+		for (int b = 0; b < PeerNetworkStats::HISTOGRAM_BUCKETS; ++b) {
+			counts[b] += p->snapshotHistogram[b];
+		}
+	}
+	for (int b = 0; b < PeerNetworkStats::HISTOGRAM_BUCKETS; ++b) {
+		highest = std::max(highest, counts[b]);
+		if (counts[b] > 0) {
+			last = b;
+		}
+	}
+	if (last < 0) {
+		return;
+	}
+	float line = 50.0f;
+	Debug::Print("Snapshot bytes per tick", Vector2(60, line), Debug::WHITE);
+	for (int b = 0; b <= last; ++b) {
+		line += 3.0f;
+		int bar = counts[b] * maxBar / highest;
+		Debug::Print(std::to_string(b * PeerNetworkStats::BUCKET_BYTES) + (b == PeerNetworkStats::HISTOGRAM_BUCKETS - 1 ? "+ " : " ")
+			+ std::string(bar, '#'), Vector2(60, line), Debug::WHITE);
+	}
+}
+
+//Clients don't snap objects to each packet as it arrives, they play the
+//received states back through each object's interpolation buffer instead
+void NetworkedGame::UpdateNetworkObjects(float dt) {
+	for (NetworkObject* o : replicator->GetNetworkObjects()) {
+		if (o) {
+			o->UpdateInterpolation(dt);
+		}
+	}
+}
 
-	for (auto i : stateIDs) {
-		minID = std::min(minID, i.second);
-		maxID = std::max(maxID, i.second);
+//On the server, G drops a crate or ball over the player and H takes the
+//oldest one away again, to show objects coming and going mid-game
+void NetworkedGame::UpdateSpawnKeys() {
+	if (Window::GetKeyboard()->KeyPressed(KeyCodes::G) && player) {
+		int prefab		= spawnedEntities.size() % 2 ? Prefab_Ball : Prefab_Crate;
+		Vector3 offset	= Vector3((float)(rand() % 10 - 5), 10.0f, (float)(rand() % 10 - 5));
+		GameObject* o	= replicator->Spawn(prefab, player->GetTransform().GetPosition() + offset);
+		if (o) {
+			spawnedEntities.emplace_back(o->GetNetworkObject()->GetNetworkID());
+		}
 	}
-	//every client has acknowledged reaching at least state minID
-	//so we can get rid of any old states!
+	if (Window::GetKeyboard()->KeyPressed(KeyCodes::H) && !spawnedEntities.empty()) {
+		replicator->Despawn(spawnedEntities.front());
+		spawnedEntities.pop_front();
+	}
+	Debug::Print("Networked objects: " + std::to_string(replicator->GetLiveCount()) + " (G/H spawn/despawn)", Vector2(2, 30), Debug::WHITE);
+}
+
+void NetworkedGame::UpdateMinimumState() {
+	//Periodically remove old data from the server
 	std::vector<GameObject*>::const_iterator first;
 	std::vector<GameObject*>::const_iterator last;
 	world->GetObjectIterators(first, last);
@@ -320,7 +671,12 @@ void NetworkedGame::UpdateMinimumState() {
 		if (!o) {
 			continue;
 		}
-		o->UpdateStateHistory(minID); //clear out old states so they arent taking up memory...
+		//every client has acknowledged reaching at least state minID
+		//of this object, so we can get rid of any older ones!
+		int minID = server->GetMinimumAckedState(o->GetNetworkID());
+		if (minID >= 0) {
+			o->UpdateStateHistory(minID); //clear out old states so they arent taking up memory...
+		}
 	}
 }
 
@@ -338,7 +694,10 @@ void NetworkedGame::TestPathfinding() {
 	Vector3 startPos(80, 0, 10);
 	Vector3 endPos(80, 0, 80);
 
-	bool found = grid.FindPath(startPos, endPos, outPath);
+	if (!grid.FindPath(startPos, endPos, outPath)) {
+		std::cout << "No path found for test grid!" << std::endl;
+		return;
+	}
 
 	Vector3 pos;
 	while (outPath.PopWaypoint(pos)) {
@@ -352,39 +711,65 @@ void NetworkedGame::DisplayPathfinding() {
 		Vector3 b = testNodes[i];
 		Debug::DrawLine(a, b, Vector4(0, 1, 0, 1));
 	}
+	for (int i = 1; i < navMeshNodes.size(); ++i) {
+		Debug::DrawLine(navMeshNodes[i - 1], navMeshNodes[i], Vector4(0, 1, 1, 1));
+	}
 }
 
+const int FLOW_GOAL_PLAYER = 0;
+
 void NetworkedGame::SetupEnemyPath() {
-	NavigationGrid grid("TestGrid1.txt");
+	if (!pathfinding) {
+		pathfinding = new PathfindingService();
+	}
+	pathfinding->Cancel(enemyPathRequest); //from the last level, if it never came back
+	angryGoose = nullptr;
+
+	delete flowFields;
+	gridForMaze = std::make_shared<NavigationGrid>("TestGrid1.txt");
+	flowFields	= new FlowFieldCache(*gridForMaze);
 
 	// Generate maze and find path
-	game->GenerateMaze(grid);
+	game->GenerateMaze(*gridForMaze);
+	pathfinding->SetNavigationData(gridForMaze);
 
-	NavigationPath outPath;
 	Vector3 startPos(80, 0, 10); // Starting position
 	Vector3 endPos(80, 0, 80);   // End position
 
-	bool found = grid.FindPath(startPos, endPos, outPath);
+	//The goose turns up once its patrol route has been found
+	enemyPathRequest = pathfinding->RequestPath(startPos, endPos, [this, startPos](bool found, const NavigationPath& outPath) {
+		enemyPathRequest = -1;
 
-	std::vector<Vector3> path;
-	Vector3 pos;
-	while (outPath.PopWaypoint(pos)) {
-		path.push_back(pos);
-	}
+		if (!found) {
+			std::cout << "No path found for enemy!" << std::endl;
+			return;
+		}
 
-	if (path.empty()) {
-		std::cout << "No path found for enemy!" << std::endl;
-		return;
-	}
+		NavigationPath route = outPath;
+		std::vector<Vector3> path;
+		Vector3 pos;
+		while (route.PopWaypoint(pos)) {
+			path.push_back(pos);
+		}
 
-	// Add the enemy to the world
-	angryGoose = AddAngryGooseToWorld(startPos, path, player, world);
+		// Add the enemy to the world
+		angryGoose = AddAngryGooseToWorld(startPos, path, player, world);
+		angryGoose->SetFlowField(flowFields, FLOW_GOAL_PLAYER);
+	});
 }
 
+//Over the mesh generated from the level, so it goes round the maze as it
+//is now, and is found again whenever part of the mesh is rebuilt
 void NetworkedGame::NavMeshPathFinding() {
-	NavigationMesh navMesh("test.navmesh");
+	if (!navMeshBuilder) {
+		return;
+	}
+	std::shared_ptr<const NavigationMesh> mesh = navMeshBuilder->GetMesh();
+	if (!mesh) {
+		return;
+	}
+	const NavigationMesh& navMesh = *mesh;
 
-	std::cout << "Visualizing Navigation Mesh:" << std::endl;
 	for (const auto& tri : navMesh.GetTriangles()) { // Assuming GetTriangles() is implemented
 		// Retrieve vertices of the triangle
 		Vector3 v0 = navMesh.GetVertex(tri.indices[0]);
@@ -404,45 +789,21 @@ void NetworkedGame::NavMeshPathFinding() {
 
 	NavigationPath outPath;
 
-	/* I could not find a startPos and endPos for the navmesh. I tried
-	logging the data vertices to the console and finding a start pos
-	but the program wouldn't load at all, so I couldn't demonstrate it.
-	Please provide me some feedback regarding this while grading, on how
-	I could have chosen startpos and endPos
-	*/
-
-	// This is the commented out startPos and endPos I tried to use which made it crash
-	//Vector3 startPos(64.0, 15.7834, 46.5556);   // Centroid of a triangle in the positive region
-	//Vector3 endPos(-21.7222, 21.0334, -45.1111); // Centroid of a triangle in the negative region
-
-	// This is tutorial's startPos and endPos for the navigation grid
+	// This is tutorial's startPos and endPos for the navigation grid, which
+	// the generated mesh covers too
 	Vector3 startPos(80, 0, 10);
 	Vector3 endPos(80, 0, 80);
 
-	bool found = navMesh.FindPath(startPos, endPos, outPath);
+	navMeshNodes.clear();
+	bool found = navMesh.FindPath(startPos, endPos, outPath, navMeshScratch);
 
-	std::vector<Vector3> path;
 	Vector3 pos;
 	while (outPath.PopWaypoint(pos)) {
-		path.push_back(pos);
+		navMeshNodes.push_back(pos);
 	}
 
-	if (path.empty()) {
+	if (!found || navMeshNodes.empty()) {
 		std::cout << "No path found for NavMesh!" << std::endl;
-		return;
-	}
-
-	std::cout << "NavMesh Path Found:" << std::endl;
-	for (const auto& waypoint : path) {
-		std::cout << "Waypoint: " << waypoint << std::endl;
-	}
-
-	// Display the path
-	for (int i = 1; i < navMeshNodes.size(); ++i) {
-		Vector3 a = navMeshNodes[i - 1];
-		Vector3 b = navMeshNodes[i];
-		std::cout << "Drawing line from " << a << " to " << b << std::endl;
-		Debug::DrawLine(a, b, Vector4(0, 1, 0, 1));
 	}
 }
 
@@ -585,9 +946,13 @@ NetworkPlayer* NetworkedGame::SpawnPlayer(Vector3 playerSpawnPosition, std::stri
 }
 
 void NetworkedGame::StartLevel() {
+	if (lagCompensator) {
+		lagCompensator->Reset();
+	}
 	world->ClearAndErase();
 	physics->Clear();
-	networkObjects.clear();
+	replicator->Reset();
+	spawnedEntities.clear();
 
 	AddFloorToWorld(Vector3(0, -2, 0));
 	AddFlyingStairs();
@@ -606,14 +971,10 @@ void NetworkedGame::StartLevel() {
 	kitten2 = AddKittenToWorld(Vector3(-110, 2, -30), player, world, home);
 	kitten3 = AddKittenToWorld(Vector3(10, 2, 30), player, world, home);
 
-	// local player
-	NetworkObject* networkObj = new NetworkObject(*player, 1);
-	player->SetNetworkObject(networkObj);
-	networkObjects.insert(std::make_pair(1, networkObj));
-
-	NetworkObject* networkObj2 = new NetworkObject(*player2, 2);
-	player2->SetNetworkObject(networkObj2);
-	networkObjects.insert(std::make_pair(2, networkObj2));
+	//Both players are part of every level, so they keep fixed IDs rather
+	//than being spawned by the server
+	replicator->AddStatic(*player, 1);
+	NetworkObject* networkObj2 = replicator->AddStatic(*player2, 2);
 
 	PositionBridgeConstraint();
 	OrientedBridgeConstraint();
@@ -630,19 +991,34 @@ void NetworkedGame::StartLevel() {
 
 	PenaltyMethodOnSphere();
 
-	// Add the nav mesh pathfinding
-	NavMeshPathFinding();
-
 	if (server) {
 		player->controllerByServer = true; // Server controller by player
 	}
 
 	if (client) {
 		player2->controllerByServer = false; // Client controller by player2
+
+		//player2 is ours, so it's moved by prediction rather than snapshots
+		localPlayer = player2;
+		networkObj2->SetPredicted(true);
+
+		delete prediction;
+		prediction = new ClientPrediction(*physics, *player2,
+			[](GameObject& o, const PlayerInput& input, bool isNewInput) {
+				((NetworkPlayer&)o).ApplyInput(input, isNewInput);
+			}
+		);
 	}
 
 	SetupEnemyPath();
 	door = AddDoorToWorld(Vector3(-110, 2, -10));
+
+	// Add the nav mesh pathfinding, once everything that blocks it is in
+	delete navMeshBuilder;
+	navMeshBuilder = new NavMeshBuilder();
+	navMeshBuilder->Build(*world);
+	navMeshUpdateTimer = navMeshUpdateInterval;
+	NavMeshPathFinding();
 }
 
 
@@ -660,23 +1036,35 @@ void NetworkedGame::OnPlayerCollision(NetworkPlayer* a, NetworkPlayer* b) {
 }
 
 void NetworkedGame::OnPlayerConnected(int playerID) {
-	std::cout << "This is player ID: " << playerID << " connected!" << std::endl;
-	newPlayer = new NetworkPlayer();
+	NET_LOG_INFO("Player " << playerID << " connected! (" << server->GetClientCount() << "/" << server->GetMaxClients() << ")");
+
+	//Spectators need to see what's been spawned too
+	replicator->SendExisting(*server, playerID);
 
-	if (playerPeerMap.empty()) {
-		// First connection is player
+	//Both players are already in the world, connections just claim them
+	bool hasPlayer	= false;
+	bool hasPlayer2 = false;
+	for (auto& [id, p] : playerPeerMap) {
+		hasPlayer	|= p == player;
+		hasPlayer2	|= p == player2;
+	}
+	if (!hasPlayer) {
 		newPlayer = player;
 		player->controllerByServer = true;
 	}
-	else {
-		// Second connection is player2
+	else if (!hasPlayer2) {
 		newPlayer = player2;
 		player2->controllerByServer = false;
 	}
-
-	world->AddGameObject(newPlayer);
+	else {
+		NET_LOG_INFO("Player " << playerID << " has joined as a spectator");
+		return;
+	}
 	playerPeerMap[playerID] = newPlayer;
-	std::cout << "Player " << playerID << " connected!" << std::endl;
+}
+
+void NetworkedGame::OnPlayerDisconnected(int playerID) {
+	playerPeerMap.erase(playerID);
 }
 
 void NetworkedGame::TestBehaviourTree() {
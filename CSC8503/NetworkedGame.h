@@ -2,8 +2,11 @@
 #include "TutorialGame.h"
 #include "NetworkBase.h"
 #include "Player.h"
+#include "NodeHeap.h"
 
 #include <vector>
+#include <deque>
+#include <memory>
 
 
 namespace NCL {
@@ -14,9 +17,30 @@ namespace NCL {
 		class Player;
 		class NetworkObject;
 		class TestPacketReceiver;
+		class ClientPrediction;
+		class LagCompensator;
+		class EntityReplicator;
+		struct ClientPacket;
+		struct AckPacket;
+		struct PlayerStatePacket;
+		struct RaycastRequestPacket;
+
+		class FlowFieldCache;
+		class PathfindingService;
+		class NavMeshBuilder;
+
+		//Objects the server can spawn at runtime, registered the same on both ends
+		enum NetworkPrefab {
+			Prefab_Crate,
+			Prefab_Ball,
+			Prefab_Bonus
+		};
 
 		class NetworkedGame : public TutorialGame {
 		public:
+			static const int MAX_CLIENTS = 8;
+			static const int FIRST_DYNAMIC_ID = 3; //1 and 2 are the players
+
 			NetworkedGame();
 			NetworkedGame(bool isServer);
 			~NetworkedGame();
@@ -33,6 +57,12 @@ namespace NCL {
 			void OnPlayerCollision(NetworkPlayer* a, NetworkPlayer* b);
 
 			void OnPlayerConnected(int playerID);
+			void OnPlayerDisconnected(int playerID);
+			void OnStateAcknowledged(int playerID, AckPacket& packet);
+
+			void OnPlayerInput(int playerID, ClientPacket& packet);
+			void OnPlayerState(PlayerStatePacket& packet);
+			void OnRaycastRequest(int playerID, RaycastRequestPacket& packet);
 
 			void TestBehaviourTree();
 
@@ -67,7 +97,7 @@ namespace NCL {
 			TestPacketReceiver* clientReceiver;
 			TestPacketReceiver* serverReceiver;
 
-			std::unordered_map<int, NetworkObject*> networkObjects;
+			NetworkObject* GetNetworkObject(int id) const;
 
 		protected:
 			void UpdateAsServer(float dt);
@@ -76,15 +106,39 @@ namespace NCL {
 			void BroadcastSnapshot(bool deltaFrame);
 			void UpdateMinimumState();
 
-			std::map<int, int> stateIDs;
+			void UpdateNetworkObjects(float dt);
+			void RegisterPrefabs();
+			void UpdateSpawnKeys();
+			void DisplayNetworkStats();
+			void DisplaySnapshotHistogram(const NetworkStats& stats);
+
+			void UpdateLocalInput(float dt);
+			void ApplyClientInputs(float dt);
+			void SendPlayerStates();
+			void SendRaycastRequest();
 
 			float timeToNextPacket;
 			int packetsToSnapshot;
 
+			float networkTime;		//server clock, used to stamp outgoing states
+			float packetInterval;	//time between server/client updates
+
 			
 
 			std::map<int, GameObject*> serverPlayers;
-			GameObject* localPlayer;
+			GameObject* localPlayer = nullptr;
+
+			ClientPrediction* prediction = nullptr;
+			float timeToNextInput = 0.0f;
+			std::vector<int> sentAcks;	//by network ID, the newest full state acknowledged to the server
+			int snapshotStateID = 0;	//shared by every object's state in a snapshot
+			float inputInterval;	//time between client input packets
+			float shotImpulse;		//given to anything a confirmed shot hits
+
+			LagCompensator* lagCompensator = nullptr;
+			EntityReplicator* replicator = nullptr;
+			std::deque<int> spawnedEntities; //oldest first, for the despawn key
+			bool recordingNetworkStats = false;
 
 			std::map<int, Player*> players;
 			
@@ -92,7 +146,14 @@ namespace NCL {
 			vector<Vector3> testNodes;
 			vector<Vector3> navMeshNodes;
 
-			NavigationGrid* gridForMaze;
+			std::shared_ptr<NavigationGrid> gridForMaze;	//shared with any searches still running on it
+			FlowFieldCache*		flowFields	= nullptr;		//over gridForMaze, shared by everything chasing the player
+			PathfindingService*	pathfinding	= nullptr;
+			int					enemyPathRequest = -1;
+			NavMeshBuilder*		navMeshBuilder	= nullptr;	//from the level's static boxes, kept up to date as they move
+			float				navMeshUpdateTimer		= 0.0f;
+			float				navMeshUpdateInterval	= 0.5f;	//between looks for boxes that have moved
+			GridSearchScratch	navMeshScratch;	//for searches over navMeshBuilder's mesh
 			TutorialGame* game = new TutorialGame();
 
 			StateGameObject* gooseEnemy;
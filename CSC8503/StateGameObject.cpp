@@ -7,6 +7,7 @@
 #include "NetworkPlayer.h"
 #include "Window.h"
 #include "TutorialGame.h"
+#include "FlowField.h"
 
 using namespace NCL;
 using namespace CSC8503;
@@ -45,6 +46,9 @@ StateGameObject::StateGameObject(const std::vector<Vector3>& path, GameObject* p
 }
 
 StateGameObject::StateGameObject(GameObject* playerObj, GameWorld* world, GameObject* kittenHome) {
+	counter = 0.0f;
+	waypointIndex = 0;
+	movingForward = true;
 	player = playerObj;
 	gameWorld = world;
 	home = kittenHome;
@@ -60,6 +64,13 @@ StateGameObject::StateGameObject(GameObject* playerObj, GameWorld* world, GameOb
 
 StateGameObject::StateGameObject()
 {
+	stateMachine = nullptr;
+	counter = 0.0f;
+	waypointIndex = 0;
+	movingForward = true;
+	player = nullptr;
+	gameWorld = nullptr;
+	home = nullptr;
 }
 
 StateGameObject::~StateGameObject() {
@@ -114,6 +125,14 @@ void StateGameObject::ChasePlayer(float dt) {
 	Vector3 direction = playerPos - currentPos;
 	Vector::Normalise(direction);
 
+	if (flowFields) {
+		//Off the grid, or already next to the player, it's straight at them
+		Vector3 flow = flowFields->Track(flowGoalID, playerPos).GetDirection(currentPos);
+		if (flow.x != 0.0f || flow.z != 0.0f) {
+			direction = flow;
+		}
+	}
+
 	GetPhysicsObject()->AddForce(direction * 5.0f); // Faster speed when chasing
 }
 
@@ -207,6 +226,30 @@ bool StateGameObject::DetectPlayer() {
 }
 
 
+size_t StateGameObject::GetSnapshotSize() const {
+	return sizeof(SavedState);
+}
+
+void StateGameObject::WriteSnapshot(char* out) const {
+	SavedState state;
+	state.activeState = stateMachine ? stateMachine->GetActiveStateIndex() : -1;
+	state.counter = counter;
+	state.waypointIndex = waypointIndex;
+	state.movingForward = movingForward;
+	memcpy(out, &state, sizeof(SavedState));
+}
+
+void StateGameObject::ReadSnapshot(const char* in) {
+	SavedState state;
+	memcpy(&state, in, sizeof(SavedState));
+	if (stateMachine) {
+		stateMachine->SetActiveStateIndex(state.activeState);
+	}
+	counter = state.counter;
+	waypointIndex = state.waypointIndex;
+	movingForward = state.movingForward;
+}
+
 void StateGameObject::Idle(float dt) {
 	// Optional idle behavior, not interested in this for now
 	std::cout << "Idle State" << std::endl;
@@ -7,6 +7,7 @@ namespace NCL {
 		class GameWorld;
 		class GameObject;
 		class NetworkPlayer;
+		class FlowFieldCache;
         class StateGameObject : public GameObject  {
         public:
             StateGameObject();
@@ -28,9 +29,27 @@ namespace NCL {
 
             void TogglePlayerWithDelay(NetworkPlayer* player);
 
+            //Chases along a shared flow field to the player, instead of
+            //straight at them through whatever's in the way
+            void SetFlowField(FlowFieldCache* cache, int goalID) {
+                flowFields  = cache;
+                flowGoalID  = goalID;
+            }
+
             void Idle(float dt);
 
+            size_t GetSnapshotSize() const override;
+            void WriteSnapshot(char* out) const override;
+            void ReadSnapshot(const char* in) override;
+
         protected:
+            struct SavedState {
+                int     activeState;
+                float   counter;
+                int     waypointIndex;
+                bool    movingForward;
+            };
+
             void MoveLeft(float dt);
             void MoveRight(float dt);
 
@@ -45,6 +64,9 @@ namespace NCL {
 			GameObject* player;
 			GameWorld* gameWorld;
             GameObject* home;
+
+            FlowFieldCache* flowFields = nullptr;
+            int             flowGoalID = 0;
             
         };
     }
@@ -289,6 +289,7 @@ void TutorialGame::UpdateGame(float dt) {
 
 	world->UpdateWorld(dt);
 	renderer->Update(dt);
+	physics->HandleDebugKeys();
 	physics->Update(dt);
 
 	renderer->Render();
@@ -0,0 +1,132 @@
+#include "ClientPrediction.h"
+#include "GameObject.h"
+#include "PhysicsObject.h"
+#include "PhysicsSystem.h"
+
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+PredictedState PredictedState::FromObject(GameObject& o) {
+	PredictedState s;
+	s.position		= o.GetTransform().GetPosition();
+	s.orientation	= o.GetTransform().GetOrientation();
+	if (PhysicsObject* phys = o.GetPhysicsObject()) {
+		s.linearVelocity	= phys->GetLinearVelocity();
+		s.angularVelocity	= phys->GetAngularVelocity();
+	}
+	return s;
+}
+
+void PredictedState::ApplyToObject(GameObject& o) const {
+	o.GetTransform().SetPosition(position);
+	o.GetTransform().SetOrientation(orientation);
+	if (PhysicsObject* phys = o.GetPhysicsObject()) {
+		phys->SetLinearVelocity(linearVelocity);
+		phys->SetAngularVelocity(angularVelocity);
+	}
+}
+
+ClientPrediction::ClientPrediction(PhysicsSystem& physics, GameObject& object, InputFunc applyInput)
+	: physics(physics), object(object), applyInput(applyInput) {
+	currentElapsed		= 0.0f;
+	currentIsNew		= false;
+	nextSequence		= 0;
+	lastAcknowledged	= -1;
+	correctionCount		= 0;
+	correctionThreshold = 0.5f;
+	lastError			= 0.0f;
+}
+
+const PlayerInput* ClientPrediction::BeginInput(const char buttons[8]) {
+	const PlayerInput* finished = nullptr;
+	if (current.sequence >= 0) {
+		InputRecord& r = GetRecord(current.sequence);
+		r.input				= current;
+		r.input.duration	= currentElapsed;
+		r.result			= PredictedState::FromObject(object);
+		r.hasResult			= true;
+		finished			= &r.input;
+	}
+	current.sequence = nextSequence++;
+	for (int i = 0; i < 8; ++i) {
+		current.buttons[i] = buttons[i];
+	}
+	current.duration	= 0.0f;
+	currentElapsed		= 0.0f;
+	currentIsNew		= true;
+
+	GetRecord(current.sequence).hasResult = false;
+	return finished;
+}
+
+const PlayerInput* ClientPrediction::GetUnacknowledged(int sequence) const {
+	if (sequence <= lastAcknowledged || sequence >= current.sequence || sequence < 0) {
+		return nullptr;
+	}
+	const InputRecord& r = GetRecord(sequence);
+	return (r.hasResult && r.input.sequence == sequence) ? &r.input : nullptr;
+}
+
+void ClientPrediction::ApplyCurrentInput(float dt) {
+	if (current.sequence < 0) {
+		return;
+	}
+	applyInput(object, current, currentIsNew);
+	currentIsNew	= false;
+	currentElapsed += dt;
+}
+
+bool ClientPrediction::Reconcile(int sequence, float heldFor, const PredictedState& serverState) {
+	if (sequence <= lastAcknowledged || sequence >= current.sequence) {
+		return false; //old news, or an input we haven't finished yet
+	}
+	lastAcknowledged = sequence;
+
+	InputRecord& r = GetRecord(sequence);
+	if (!r.hasResult || r.input.sequence != sequence) {
+		return false; //fell out of the buffer
+	}
+
+	//The server's state won't be from exactly the end of the input, so it's
+	//taken back (or on) to there along its velocity before comparing
+	float overrun		= heldFor - r.input.duration;
+	Vector3 serverEnd	= serverState.position - serverState.linearVelocity * overrun;
+
+	lastError = Vector::Length(r.result.position - serverEnd);
+	if (lastError <= correctionThreshold) {
+		return false; //close enough, leave the prediction alone
+	}
+
+	//Rewind to what the server says happened, then run the rest of the
+	//input and every one after it back through the physics step. Time the
+	//server held this input on for comes off the next ones, as it will
+	//when they reach it.
+	serverState.ApplyToObject(object);
+	if (overrun < 0.0f) {
+		applyInput(object, r.input, false);
+		physics.StepObject(object, -overrun);
+		object.GetPhysicsObject()->ClearForces();
+		overrun = 0.0f;
+	}
+	r.result = PredictedState::FromObject(object);
+
+	for (int s = sequence + 1; s <= current.sequence; ++s) {
+		bool isCurrent			= s == current.sequence;
+		InputRecord& replay		= GetRecord(s);
+		const PlayerInput& in	= isCurrent ? current : replay.input;
+
+		float held	= (isCurrent ? currentElapsed : in.duration) - overrun;
+		overrun		= std::max(-held, 0.0f);
+
+		applyInput(object, in, true);
+		physics.StepObject(object, std::max(held, 0.0f));
+		object.GetPhysicsObject()->ClearForces();
+		if (!isCurrent) {
+			replay.result = PredictedState::FromObject(object);
+		}
+	}
+	correctionCount++;
+	return true;
+}
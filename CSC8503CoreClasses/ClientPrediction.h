@@ -0,0 +1,118 @@
+#pragma once
+#include "Vector.h"
+#include "Quaternion.h"
+#include <functional>
+
+namespace NCL::CSC8503 {
+	using namespace NCL::Maths;
+
+	class GameObject;
+	class PhysicsSystem;
+
+	struct PlayerInput {
+		int		sequence	= -1;
+		char	buttons[8]	= { 0 };
+		float	duration	= 0.0f; //how long this input was held for on the client
+	};
+
+	struct PredictedState {
+		Vector3		position;
+		Quaternion	orientation;
+		Vector3		linearVelocity;
+		Vector3		angularVelocity;
+
+		static PredictedState FromObject(GameObject& o);
+		void ApplyToObject(GameObject& o) const;
+	};
+
+	/*
+	Runs the local player's inputs straight away on the client rather than
+	waiting for the server, keeping a ring buffer of every input sent along
+	with where it left the player. When the server's state for an input comes
+	back and disagrees by more than the threshold, the player is rewound to it
+	and the inputs the server hasn't seen yet are replayed on top.
+
+	Inputs are only sent once they're finished, so the server can hold each
+	one for exactly as long as it was held here, and are sent again until the
+	server acknowledges them.
+	*/
+	class ClientPrediction {
+	public:
+		//Adds the forces for an input. isNewInput is true the first time an
+		//input is applied, so one-off actions like jumping only happen once.
+		typedef std::function<void(GameObject&, const PlayerInput&, bool isNewInput)> InputFunc;
+
+		ClientPrediction(PhysicsSystem& physics, GameObject& object, InputFunc applyInput);
+		~ClientPrediction() {}
+
+		//Finishes the current input, recording where it left the player, and
+		//starts a new one. Returns the finished input, with how long it was
+		//held, to send to the server - or nullptr if this is the first.
+		const PlayerInput* BeginInput(const char buttons[8]);
+
+		//A finished input the server hasn't acknowledged yet, to send again
+		//in case it was lost, or nullptr if it has been or is out of the buffer
+		const PlayerInput* GetUnacknowledged(int sequence) const;
+
+		//Called every frame before the physics update
+		void ApplyCurrentInput(float dt);
+
+		//The server's state is from after it had held input sequence for
+		//heldFor seconds, which runs past the end of it if it's still waiting
+		//on the next. Returns true if the player had to be corrected.
+		bool Reconcile(int sequence, float heldFor, const PredictedState& serverState);
+
+		void SetCorrectionThreshold(float distance) {
+			correctionThreshold = distance;
+		}
+
+		int GetCorrectionCount() const {
+			return correctionCount;
+		}
+
+		int GetLastAcknowledged() const {
+			return lastAcknowledged;
+		}
+
+		//How many inputs the server hasn't confirmed yet
+		int GetPendingInputs() const {
+			return current.sequence - lastAcknowledged;
+		}
+
+		float GetLastError() const {
+			return lastError;
+		}
+
+		static const int INPUT_BUFFER_SIZE = 128;
+
+	protected:
+		struct InputRecord {
+			PlayerInput		input;
+			PredictedState	result;
+			bool			hasResult = false;
+		};
+
+		InputRecord& GetRecord(int sequence) {
+			return history[sequence % INPUT_BUFFER_SIZE];
+		}
+
+		const InputRecord& GetRecord(int sequence) const {
+			return history[sequence % INPUT_BUFFER_SIZE];
+		}
+
+		PhysicsSystem&	physics;
+		GameObject&		object;
+		InputFunc		applyInput;
+
+		InputRecord	history[INPUT_BUFFER_SIZE];
+		PlayerInput	current;
+		float		currentElapsed;
+		bool		currentIsNew;
+
+		int		nextSequence;
+		int		lastAcknowledged;
+		int		correctionCount;
+		float	correctionThreshold;
+		float	lastError;
+	};
+}
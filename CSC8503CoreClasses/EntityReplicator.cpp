@@ -0,0 +1,237 @@
+#include "EntityReplicator.h"
+#include "GameServer.h"
+#include "GameWorld.h"
+#include "GameObject.h"
+#include "PhysicsSystem.h"
+#include "NetworkObject.h"
+
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+NetworkIDAllocator::NetworkIDAllocator(int firstID, int reuseDelay) {
+	this->firstID		= firstID;
+	this->reuseDelay	= reuseDelay;
+	Reset();
+}
+
+void NetworkIDAllocator::Reset() {
+	freeIDs.clear();
+	nextID	= firstID;
+	tick	= 0;
+}
+
+int NetworkIDAllocator::Allocate() {
+	if (!freeIDs.empty() && tick - freeIDs.front().freedTick >= reuseDelay) {
+		int id = freeIDs.front().id;
+		freeIDs.pop_front();
+		return id;
+	}
+	return nextID++;
+}
+
+void NetworkIDAllocator::Free(int id) {
+	if (id < firstID || id >= nextID) {
+		return; //not one of ours
+	}
+	freeIDs.push_back({ id, tick });
+}
+
+EntityReplicator::EntityReplicator(GameWorld& world, PhysicsSystem& physics, int firstDynamicID)
+	: world(world), physics(physics), allocator(firstDynamicID) {
+	liveCount		= 0;
+	spawnsSent		= 0;
+	despawnsSent	= 0;
+	packetsSent		= 0;
+}
+
+EntityReplicator::~EntityReplicator() {
+}
+
+void EntityReplicator::RegisterPrefab(int prefabID, const PrefabFactory& factory) {
+	if (prefabID >= (int)prefabs.size()) {
+		prefabs.resize(prefabID + 1);
+	}
+	prefabs[prefabID] = factory;
+}
+
+void EntityReplicator::Reset() {
+	networkObjects.clear();
+	entities.clear();
+	pendingSpawns.clear();
+	pendingDespawns.clear();
+	allocator.Reset();
+	liveCount = 0;
+}
+
+void EntityReplicator::Track(NetworkObject* o, int networkID, int prefabID) {
+	if (networkID >= (int)networkObjects.size()) {
+		networkObjects.resize(networkID + 1, nullptr);
+		entities.resize(networkID + 1);
+	}
+	if (!networkObjects[networkID]) {
+		liveCount++;
+	}
+	networkObjects[networkID]		= o;
+	entities[networkID].prefabID	= prefabID;
+}
+
+NetworkObject* EntityReplicator::AddStatic(GameObject& o, int networkID) {
+	NetworkObject* n = new NetworkObject(o, networkID);
+	o.SetNetworkObject(n);
+	Track(n, networkID, -1);
+	return n;
+}
+
+GameObject* EntityReplicator::CreateEntity(int networkID, int prefabID, const Vector3& position, const Quaternion& orientation) {
+	if (prefabID < 0 || prefabID >= (int)prefabs.size() || !prefabs[prefabID]) {
+		NET_LOG_ERROR("No prefab registered with ID " << prefabID);
+		return nullptr;
+	}
+	GameObject* o = prefabs[prefabID](position, orientation);
+	if (!o) {
+		return nullptr;
+	}
+	o->GetTransform().SetPositionAndOrientation(position, orientation);
+
+	NetworkObject* n = new NetworkObject(*o, networkID);
+	o->SetNetworkObject(n);
+	Track(n, networkID, prefabID);
+	return o;
+}
+
+void EntityReplicator::RemoveEntity(int networkID) {
+	NetworkObject* n = GetNetworkObject(networkID);
+	if (!n) {
+		return;
+	}
+	GameObject* o = &n->GetGameObject();
+	networkObjects[networkID]	= nullptr;
+	entities[networkID]			= EntityInfo();
+	liveCount--;
+
+	physics.RemoveObject(o);
+	world.RemoveGameObject(o, true); //takes the network object with it
+}
+
+GameObject* EntityReplicator::Spawn(int prefabID, const Vector3& position, const Quaternion& orientation) {
+	int id = allocator.Allocate();
+	GameObject* o = CreateEntity(id, prefabID, position, orientation);
+	if (!o) {
+		allocator.Free(id);
+		return nullptr;
+	}
+	entities[id].pendingSpawn = true;
+	pendingSpawns.emplace_back(id);
+	return o;
+}
+
+void EntityReplicator::Despawn(int networkID) {
+	if (networkID < 0 || networkID >= (int)entities.size() || !networkObjects[networkID] || entities[networkID].prefabID < 0) {
+		return; //static objects live as long as the level does
+	}
+	//Clients that were never told about it don't need telling it's gone
+	if (entities[networkID].pendingSpawn) {
+		pendingSpawns.erase(std::remove(pendingSpawns.begin(), pendingSpawns.end(), networkID), pendingSpawns.end());
+	}
+	else {
+		pendingDespawns.emplace_back(networkID);
+	}
+	RemoveEntity(networkID);
+	allocator.Free(networkID);
+}
+
+//Despawns go first, so a client never holds more objects than the server did
+void EntityReplicator::Flush(GameServer& server) {
+	if (!pendingDespawns.empty()) {
+		EntityDespawnPacket packet;
+		for (int id : pendingDespawns) {
+			packet.Add(id);
+			if (packet.IsFull()) {
+				server.SendGlobalPacket(packet);
+				packetsSent++;
+				packet = EntityDespawnPacket();
+			}
+		}
+		if (packet.count > 0) {
+			server.SendGlobalPacket(packet);
+			packetsSent++;
+		}
+		despawnsSent += (int)pendingDespawns.size();
+		pendingDespawns.clear();
+	}
+	if (!pendingSpawns.empty()) {
+		EntitySpawnPacket packet;
+		for (int id : pendingSpawns) {
+			GameObject& o = networkObjects[id]->GetGameObject();
+			packet.Add({ id, entities[id].prefabID, o.GetTransform().GetPosition(), o.GetTransform().GetOrientation() });
+			entities[id].pendingSpawn = false;
+			if (packet.IsFull()) {
+				server.SendGlobalPacket(packet);
+				packetsSent++;
+				packet = EntitySpawnPacket();
+			}
+		}
+		if (packet.count > 0) {
+			server.SendGlobalPacket(packet);
+			packetsSent++;
+		}
+		spawnsSent += (int)pendingSpawns.size();
+		pendingSpawns.clear();
+	}
+	allocator.AdvanceTick();
+}
+
+//Anything still waiting on a Flush is left for it, so it isn't sent twice
+void EntityReplicator::SendExisting(GameServer& server, int peer) {
+	EntitySpawnPacket packet;
+	for (int id = 0; id < (int)networkObjects.size(); ++id) {
+		if (!networkObjects[id] || entities[id].prefabID < 0 || entities[id].pendingSpawn) {
+			continue;
+		}
+		GameObject& o = networkObjects[id]->GetGameObject();
+		packet.Add({ id, entities[id].prefabID, o.GetTransform().GetPosition(), o.GetTransform().GetOrientation() });
+		if (packet.IsFull()) {
+			server.SendPacket(packet, peer);
+			packetsSent++;
+			packet = EntitySpawnPacket();
+		}
+	}
+	if (packet.count > 0) {
+		server.SendPacket(packet, peer);
+		packetsSent++;
+	}
+}
+
+void EntityReplicator::ReceivePacket(int type, GamePacket* payload, int) {
+	if (type == Entity_Spawn) {
+		EntitySpawnPacket* packet = (EntitySpawnPacket*)payload;
+		int count = packet->GetReceivedCount();
+		for (int i = 0; i < count; ++i) {
+			const EntitySpawn& e = packet->entities[i];
+			if (e.networkID < 0 || e.networkID > MAX_NETWORK_ID) {
+				NET_LOG_ERROR("Server spawned an object with bad ID " << e.networkID);
+				continue;
+			}
+			if (e.networkID < (int)entities.size() && networkObjects[e.networkID]) {
+				if (entities[e.networkID].prefabID < 0) {
+					NET_LOG_ERROR("Server spawned object " << e.networkID << " over a static one");
+					continue;
+				}
+				RemoveEntity(e.networkID); //we somehow missed it going
+			}
+			CreateEntity(e.networkID, e.prefabID, e.position, e.orientation);
+		}
+	}
+	else if (type == Entity_Despawn) {
+		EntityDespawnPacket* packet = (EntityDespawnPacket*)payload;
+		int count = packet->GetReceivedCount();
+		for (int i = 0; i < count; ++i) {
+			int id = packet->networkIDs[i];
+			if (id >= 0 && id < (int)entities.size() && entities[id].prefabID >= 0) {
+				RemoveEntity(id);
+			}
+		}
+	}
+}
@@ -0,0 +1,218 @@
+#pragma once
+#include "NetworkBase.h"
+#include "Vector.h"
+#include "Quaternion.h"
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <algorithm>
+
+namespace NCL::CSC8503 {
+	using namespace NCL::Maths;
+
+	class GameObject;
+	class GameWorld;
+	class GameServer;
+	class PhysicsSystem;
+	class NetworkObject;
+
+	const int ENTITY_BATCH_SIZE = 64;
+
+	//IDs from the wire above this are refused, rather than growing the
+	//tables to fit whatever a bad packet says
+	const int MAX_NETWORK_ID = 1 << 16;
+
+	struct EntitySpawn {
+		int			networkID;
+		int			prefabID;
+		Vector3		position;
+		Quaternion	orientation;
+	};
+
+	//Only the entries in use are sent, so the size is set from the count
+	struct EntitySpawnPacket : public GamePacket {
+		int			count = 0;
+		EntitySpawn	entities[ENTITY_BATCH_SIZE];
+
+		EntitySpawnPacket() {
+			type = Entity_Spawn;
+			size = sizeof(int);
+		}
+
+		void Add(const EntitySpawn& e) {
+			entities[count++] = e;
+			size = (short)(sizeof(int) + count * sizeof(EntitySpawn));
+		}
+
+		bool IsFull() const {
+			return count == ENTITY_BATCH_SIZE;
+		}
+
+		//How many entries a received packet really holds - the count can't
+		//be trusted past what the size, checked against the length, covers
+		int GetReceivedCount() const {
+			if (size < (short)sizeof(int)) {
+				return 0;
+			}
+			int fits = (int)((size - sizeof(int)) / sizeof(EntitySpawn));
+			return std::clamp(count, 0, std::min(fits, ENTITY_BATCH_SIZE));
+		}
+	};
+
+	struct EntityDespawnPacket : public GamePacket {
+		int	count = 0;
+		int	networkIDs[ENTITY_BATCH_SIZE];
+
+		EntityDespawnPacket() {
+			type = Entity_Despawn;
+			size = sizeof(int);
+		}
+
+		void Add(int networkID) {
+			networkIDs[count++] = networkID;
+			size = (short)(sizeof(int) * (1 + count));
+		}
+
+		int GetReceivedCount() const {
+			if (size < (short)sizeof(int)) {
+				return 0;
+			}
+			int fits = (int)(size / sizeof(int)) - 1;
+			return std::clamp(count, 0, std::min(fits, ENTITY_BATCH_SIZE));
+		}
+
+		bool IsFull() const {
+			return count == ENTITY_BATCH_SIZE;
+		}
+	};
+
+	/*
+	Hands out network IDs so they stay small and dense enough to index a
+	flat array. Freed IDs go on the back of a queue and aren't given out
+	again until reuseDelay ticks have passed, so a snapshot for an old
+	object that turns up late can't be mistaken for the one that replaced
+	it. IDs below firstID are left alone for objects every level has.
+	*/
+	class NetworkIDAllocator {
+	public:
+		NetworkIDAllocator(int firstID = 0, int reuseDelay = 60);
+		~NetworkIDAllocator() {}
+
+		int		Allocate();
+		void	Free(int id);
+
+		//Called once per server tick, ages the freed IDs
+		void	AdvanceTick() {
+			tick++;
+		}
+
+		void	Reset();
+
+		//One past the highest ID ever given out, for sizing tables
+		int GetHighWater() const {
+			return nextID;
+		}
+
+		int GetFreeCount() const {
+			return (int)freeIDs.size();
+		}
+
+	protected:
+		struct FreedID {
+			int id;
+			int freedTick;
+		};
+		std::deque<FreedID> freeIDs;
+
+		int firstID;
+		int nextID;
+		int reuseDelay;
+		int tick;
+	};
+
+	/*
+	Keeps the table of networked objects on both ends, and on the server
+	tells clients when objects come and go, rather than every client
+	having to build an identical copy of the level up front.
+
+	Objects are built from prefabs - a factory registered under the same
+	ID on both sides that adds an object to the world at a transform. The
+	server's Spawn and Despawn calls are queued up and sent by Flush once
+	per tick, batched into as few reliable packets as fit. Someone joining
+	later is sent everything that's alive with SendExisting.
+
+	Objects that every level places itself (the players, say) can still be
+	given fixed IDs below the first dynamic one with AddStatic.
+	*/
+	class EntityReplicator : public PacketReceiver {
+	public:
+		using PrefabFactory = std::function<GameObject*(const Vector3& position, const Quaternion& orientation)>;
+
+		EntityReplicator(GameWorld& world, PhysicsSystem& physics, int firstDynamicID = 0);
+		~EntityReplicator();
+
+		void RegisterPrefab(int prefabID, const PrefabFactory& factory);
+
+		//For objects both sides create themselves, with an ID below firstDynamicID
+		NetworkObject* AddStatic(GameObject& o, int networkID);
+
+		//Server side. Spawn builds the object straight away, the clients
+		//hear about it on the next Flush.
+		GameObject*	Spawn(int prefabID, const Vector3& position, const Quaternion& orientation = Quaternion());
+		void		Despawn(int networkID);
+		void		Flush(GameServer& server);
+		void		SendExisting(GameServer& server, int peer);
+
+		//Client side
+		void ReceivePacket(int type, GamePacket* payload, int source) override;
+
+		//Forgets every object without deleting them, for when the world
+		//they were in has been cleared
+		void Reset();
+
+		NetworkObject* GetNetworkObject(int id) const {
+			return (id >= 0 && id < (int)networkObjects.size()) ? networkObjects[id] : nullptr;
+		}
+
+		//Indexed by network ID, with gaps left as nullptr
+		const std::vector<NetworkObject*>& GetNetworkObjects() const {
+			return networkObjects;
+		}
+
+		int GetLiveCount() const {
+			return liveCount;
+		}
+
+		const NetworkIDAllocator& GetAllocator() const {
+			return allocator;
+		}
+
+		int spawnsSent;
+		int despawnsSent;
+		int packetsSent;
+
+	protected:
+		struct EntityInfo {
+			int		prefabID		= -1;	//-1 for static objects
+			bool	pendingSpawn	= false;
+		};
+
+		GameObject*	CreateEntity(int networkID, int prefabID, const Vector3& position, const Quaternion& orientation);
+		void		RemoveEntity(int networkID);
+		void		Track(NetworkObject* o, int networkID, int prefabID);
+
+		GameWorld&		world;
+		PhysicsSystem&	physics;
+
+		NetworkIDAllocator			allocator;
+		std::vector<PrefabFactory>	prefabs;
+
+		std::vector<NetworkObject*>	networkObjects;
+		std::vector<EntityInfo>		entities;	//alongside networkObjects
+		int							liveCount;
+
+		std::vector<int>	pendingSpawns;
+		std::vector<int>	pendingDespawns;
+	};
+}
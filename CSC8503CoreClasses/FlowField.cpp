@@ -0,0 +1,204 @@
+#include "FlowField.h"
+
+#include <cfloat>
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	const uint8_t	NO_DIRECTION	= 255;
+	const float		DIAGONAL_UNIT	= 0.70710678f;
+
+	//Each offset's opposite is the one next to it, so k ^ 1 turns round
+	const int OFFSETS[8][2] = {
+		{ 0, -1 }, { 0, 1 }, { -1, 0 }, { 1, 0 },
+		{ -1, -1 }, { 1, 1 }, { 1, -1 }, { -1, 1 }
+	};
+}
+
+FlowField::FlowField(const NavigationGrid& grid) : grid(grid) {
+	front			= 0;
+	buildGoal		= -1;
+	pendingGoal		= -1;
+	buildDiagonal	= false;
+	open.Resize(grid.GetGridWidth() * grid.GetGridHeight());
+}
+
+FlowField::~FlowField() {
+}
+
+void FlowField::SetGoal(const Vector3& goal) {
+	int node = grid.GetNodeIndex(goal);
+	if (node < 0 || !grid.IsWalkable(node % grid.GetGridWidth(), node / grid.GetGridWidth())) {
+		return; //keep following the old one, the goal's probably just brushing a wall
+	}
+	if (IsBuilding()) {
+		pendingGoal = node == buildGoal ? -1 : node;
+		return;
+	}
+	if (node != layers[front].goal) {
+		StartBuild(node);
+	}
+}
+
+//The half built field was worked out on the old grid, so this one does
+//start again, towards the newest goal it's been given
+void FlowField::Refresh() {
+	int goal = pendingGoal >= 0 ? pendingGoal : (IsBuilding() ? buildGoal : layers[front].goal);
+	if (goal >= 0) {
+		StartBuild(goal);
+	}
+}
+
+void FlowField::StartBuild(int goalNode) {
+	int nodeCount = grid.GetGridWidth() * grid.GetGridHeight();
+
+	Layer& back = layers[1 - front];
+	back.distance.assign(nodeCount, FLT_MAX);
+	back.direction.assign(nodeCount, NO_DIRECTION);
+	back.goal = goalNode;
+
+	open.Clear();
+	back.distance[goalNode] = 0.0f;
+	open.Push(goalNode, 0.0f);
+
+	buildGoal		= goalNode;
+	pendingGoal		= -1;
+	buildDiagonal	= grid.HasDiagonalMoves();
+}
+
+int FlowField::Update(int nodeBudget) {
+	if (!IsBuilding()) {
+		return 0;
+	}
+	Layer& back		= layers[1 - front];
+	int gridWidth	= grid.GetGridWidth();
+	int directions	= buildDiagonal ? 8 : 4;
+
+	int used = 0;
+	while (used < nodeBudget && !open.IsEmpty()) {
+		int node = open.Pop();
+		used++;
+
+		int x = node % gridWidth;
+		int y = node / gridWidth;
+		float distance = back.distance[node];
+
+		for (int k = 0; k < directions; ++k) {
+			int nx = x + OFFSETS[k][0];
+			int ny = y + OFFSETS[k][1];
+			if (!grid.IsWalkable(nx, ny)) {
+				continue;
+			}
+			float step = 1.0f;
+			if (k >= 4) {
+				if (!grid.IsWalkable(nx, y) || !grid.IsWalkable(x, ny)) {
+					continue; //no cutting corners, the same as the grid's own searches
+				}
+				step = DIAGONAL_COST;
+			}
+			int neighbour = ny * gridWidth + nx;
+			if (distance + step < back.distance[neighbour]) {
+				back.distance[neighbour]	= distance + step;
+				back.direction[neighbour]	= (uint8_t)(k ^ 1); //back the way we came
+				open.Push(neighbour, distance + step);
+			}
+		}
+	}
+	if (open.IsEmpty()) {
+		front		= 1 - front;
+		buildGoal	= -1;
+
+		//The goal has moved on while this was being built
+		if (pendingGoal >= 0 && pendingGoal != layers[front].goal) {
+			StartBuild(pendingGoal);
+		}
+		pendingGoal = -1;
+	}
+	return used;
+}
+
+Vector3 FlowField::GetDirection(const Vector3& position) const {
+	const Layer& layer = layers[front];
+	int node = grid.GetNodeIndex(position);
+	if (node < 0 || layer.goal < 0 || layer.direction[node] == NO_DIRECTION) {
+		return Vector3();
+	}
+	int k = layer.direction[node];
+	float scale = k >= 4 ? DIAGONAL_UNIT : 1.0f;
+	return Vector3(OFFSETS[k][0] * scale, 0.0f, OFFSETS[k][1] * scale);
+}
+
+float FlowField::GetDistance(const Vector3& position) const {
+	const Layer& layer = layers[front];
+	int node = grid.GetNodeIndex(position);
+	if (node < 0 || layer.goal < 0 || layer.distance[node] == FLT_MAX) {
+		return -1.0f;
+	}
+	return layer.distance[node];
+}
+
+FlowFieldCache::FlowFieldCache(const NavigationGrid& grid, int maxFields, int nodesPerUpdate) : grid(grid) {
+	this->maxFields			= std::max(maxFields, 1);
+	this->nodesPerUpdate	= nodesPerUpdate;
+	frame					= 0;
+}
+
+FlowFieldCache::~FlowFieldCache() {
+	Clear();
+}
+
+void FlowFieldCache::Clear() {
+	for (Entry& e : entries) {
+		delete e.field;
+	}
+	entries.clear();
+}
+
+const FlowField& FlowFieldCache::Track(int goalID, const Vector3& goalPosition) {
+	Entry* entry = nullptr;
+	for (Entry& e : entries) {
+		if (e.goalID == goalID) {
+			entry = &e;
+			break;
+		}
+	}
+	if (!entry) {
+		if ((int)entries.size() < maxFields) {
+			entries.push_back({ goalID, new FlowField(grid), frame });
+			entry = &entries.back();
+		}
+		else {
+			entry = &entries[0];
+			for (Entry& e : entries) {
+				if (e.lastUsed < entry->lastUsed) {
+					entry = &e;
+				}
+			}
+			delete entry->field; //the old field would lead somewhere else entirely
+			entry->field	= new FlowField(grid);
+			entry->goalID	= goalID;
+		}
+	}
+	entry->lastUsed = frame;
+	entry->field->SetGoal(goalPosition);
+	return *entry->field;
+}
+
+void FlowFieldCache::Update() {
+	int budget = nodesPerUpdate;
+	for (Entry& e : entries) {
+		if (budget <= 0) {
+			break;
+		}
+		budget -= e.field->Update(budget);
+	}
+	frame++;
+}
+
+void FlowFieldCache::RefreshAll() {
+	for (Entry& e : entries) {
+		e.field->Refresh();
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include "NavigationGrid.h"
+#include <climits>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Every node's way to one goal, worked out in one go, for when lots of
+		agents are heading to the same place. The field is a Dijkstra search
+		outwards from the goal over the whole grid, leaving each node with
+		its distance to the goal and which neighbour to step to next, so an
+		agent only has to look up the node it's standing on.
+
+		There are two copies of the field. When the goal moves, the new one
+		is built in the back copy a few thousand nodes at a time with
+		Update, while agents carry on following the front one - which still
+		leads to where the goal just was, next door - and the two are
+		swapped once it's done. A goal that moves again mid-build doesn't
+		throw that work away, or a goal that keeps moving would never get a
+		field at all. It's remembered, and built next once the swap is done.
+		*/
+		class FlowField {
+		public:
+			FlowField(const NavigationGrid& grid);
+			~FlowField();
+
+			//Starts building towards a new goal, if it's on a different node
+			//to the last one, or queues it up if a build is already running.
+			//A goal inside a wall is ignored.
+			void SetGoal(const Vector3& goal);
+
+			//Starts again towards the same goal, after the grid has changed
+			void Refresh();
+
+			//Carries on with any build, for up to nodeBudget nodes, and
+			//returns how many it used
+			int Update(int nodeBudget);
+
+			//Finishes any build straight away
+			void Complete() {
+				while (IsBuilding()) {
+					Update(INT_MAX);
+				}
+			}
+
+			//Unit length, flat on the XZ plane. Zero at the goal, off the
+			//grid, or anywhere the goal can't be reached from.
+			Vector3 GetDirection(const Vector3& position) const;
+
+			//In nodes, or -1 if the goal can't be reached from here
+			float GetDistance(const Vector3& position) const;
+
+			bool HasField() const {
+				return layers[front].goal >= 0;
+			}
+
+			bool IsBuilding() const {
+				return buildGoal >= 0;
+			}
+
+			//The node the field being followed leads to, or -1
+			int GetGoalNode() const {
+				return layers[front].goal;
+			}
+
+		protected:
+			struct Layer {
+				std::vector<float>		distance;
+				std::vector<uint8_t>	direction;	//into the neighbour offsets, or NO_DIRECTION
+				int						goal = -1;
+			};
+
+			void StartBuild(int goalNode);
+
+			const NavigationGrid& grid;
+
+			Layer	layers[2];
+			int		front;
+
+			NodeHeap	open;
+			int			buildGoal;		//-1 when not building
+			int			pendingGoal;	//built once the current one is done, or -1
+			bool		buildDiagonal;	//taken from the grid when the build starts
+		};
+
+		/*
+		Keeps a field for each goal agents are currently heading to, so any
+		number of them asking for the same goal share one. Goals are named
+		by an ID of the caller's choosing, and asked for again each frame
+		with where that goal is now. Only a handful are kept, with the one
+		asked for least recently given over to a new goal when they run out.
+		*/
+		class FlowFieldCache {
+		public:
+			FlowFieldCache(const NavigationGrid& grid, int maxFields = 8, int nodesPerUpdate = 16384);
+			~FlowFieldCache();
+
+			//Valid until the next Track for a different goal. It may not have
+			//a field yet, if this is a goal it's only just heard of.
+			const FlowField& Track(int goalID, const Vector3& goalPosition);
+
+			//Once a frame, shares nodesPerUpdate out between the fields still
+			//being built
+			void Update();
+
+			//After the grid has changed
+			void RefreshAll();
+
+			void Clear();
+
+		protected:
+			struct Entry {
+				int			goalID;
+				FlowField*	field;
+				int			lastUsed;
+			};
+
+			const NavigationGrid& grid;
+
+			std::vector<Entry> entries;
+
+			int maxFields;
+			int nodesPerUpdate;
+			int frame;
+		};
+	}
+}
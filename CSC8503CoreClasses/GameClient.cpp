@@ -1,14 +1,20 @@
 #include "GameClient.h"
+#include "NetworkObject.h"
 #include "./enet/enet.h"
+#include <cfloat>
+#include <climits>
 using namespace NCL;
 using namespace CSC8503;
 
 GameClient::GameClient()	{
-	netHandle = enet_host_create(nullptr, 1, 1, 0, 0);
+	netHandle = enet_host_create(nullptr, 1, Channel_Count, 0, 0);
+	SetPeerCount(1);
 }
 
 GameClient::~GameClient()	{
+	StopNetworkThread();
 	enet_host_destroy(netHandle);
+	netHandle = nullptr;
 }
 
 bool GameClient::Connect(uint8_t a, uint8_t b, uint8_t c, uint8_t d, int portNum) {
@@ -16,34 +22,102 @@ bool GameClient::Connect(uint8_t a, uint8_t b, uint8_t c, uint8_t d, int portNum
 	address.port = portNum;
 	address.host = (d << 24) | (c << 16) | (b << 8) | (a);
 
-	netPeer = enet_host_connect(netHandle, &address, 2, 0);
+	netPeer = enet_host_connect(netHandle, &address, Channel_Count, 0);
+
+	newestSnapshot.clear();
+	newestPlayerState.clear();
 
 	return netPeer != nullptr;
 }
 
 void GameClient::UpdateClient() {
-	if (!netHandle)
-		return;
-
-	// Handle all incoming packets
-	ENetEvent event;
-	while (enet_host_service(netHandle, &event, 0) > 0) {
-		if (event.type == ENET_EVENT_TYPE_CONNECT) {
-			std::cout << "Client: Connected to server!" << std::endl;
-			GamePacket p;
-			p.type = Server_Connected;
-			ProcessPacket(&p);
+	PollEvents();
+	CollectSent();
+	stats.EndTick();
+}
+
+void GameClient::HandleEvent(const NetworkEvent& e) {
+	if (e.type == ENET_EVENT_TYPE_CONNECT) {
+		NET_LOG_INFO("Client: Connected to server!");
+		stats.Connect(0);
+		stats.UpdateLink(0, e.roundTripTime, e.jitter, e.packetLoss);
+		GamePacket p;
+		p.type = Server_Connected;
+		ProcessPacket(&p);
+	}
+	else if (e.type == ENET_EVENT_TYPE_RECEIVE) {
+		//Anything too short to have a header still counts as traffic, but
+		//its type can't be read
+		GamePacket* packet	= (GamePacket*)e.packet->data;
+		bool hasHeader		= e.packet->dataLength >= sizeof(GamePacket);
+		stats.RecordReceived(0, hasHeader ? packet->type : -1, (int)e.packet->dataLength);
+		stats.UpdateLink(0, e.roundTripTime, e.jitter, e.packetLoss);
+		ProcessPacket(packet, -1, e.packet->dataLength);
+	}
+	else if (e.type == ENET_EVENT_TYPE_DISCONNECT) {
+		stats.Disconnect(0);
+	}
+}
+
+void GameClient::SendPacket(GamePacket& payload, int channel) {
+	if (channel < 0) {
+		channel = GetChannelForMessage(payload.type);
+	}
+	QueueOutgoing(CreatePacket(payload, channel), 0, channel);
+	stats.RecordQueued(0, payload.type, payload.GetTotalSize());
+}
+
+//Runs on the network thread if there is one
+void GameClient::SendOutgoing(const OutgoingPacket& p) {
+	size_t bytes = p.packet->dataLength;
+	if (enet_peer_send(netPeer, p.channel, p.packet) == 0) {
+		CountSent(0, bytes);
+	}
+	else {
+		enet_packet_destroy(p.packet); //not connected, so enet never took it
+	}
+}
+
+namespace {
+	const int MAX_TRACKED_OBJECTS = 1 << 16;
+
+	//Returns true if value is older than the newest one seen for id, and
+	//keeps track of the newest otherwise
+	template<typename T>
+	bool OlderThanNewest(std::vector<T>& newest, int id, T value, T none) {
+		if (id < 0 || id >= MAX_TRACKED_OBJECTS) {
+			return false;
+		}
+		if (id >= (int)newest.size()) {
+			newest.resize(id + 1, none);
 		}
-		else if (event.type == ENET_EVENT_TYPE_RECEIVE) {
-			std::cout << "Client: Packet received!" << std::endl;
-			GamePacket* packet = (GamePacket*)event.packet->data;
-			ProcessPacket(packet);
+		if (value < newest[id]) {
+			return true;
 		}
-		enet_packet_destroy(event.packet);
+		newest[id] = value;
+		return false;
 	}
 }
 
-void GameClient::SendPacket(GamePacket& payload) {
-	ENetPacket* dataPacket = enet_packet_create(&payload, payload.GetTotalSize(), 0);
-	enet_peer_send(netPeer, 0, dataPacket);
+bool GameClient::IsStale(const GamePacket& packet, size_t length) {
+	//Nothing's read until the packet is known to hold all of its struct.
+	//Anything shorter is left for ProcessPacket to throw away.
+	if (length < (size_t)((GamePacket&)packet).GetTotalSize() || packet.size < GetMinimumPayload(packet.type)) {
+		return false;
+	}
+	switch (packet.type) {
+		case Full_State: {
+			const FullPacket& p = (const FullPacket&)packet;
+			return OlderThanNewest(newestSnapshot, p.objectID, p.fullState.timeStamp, -FLT_MAX);
+		}
+		case Delta_State: {
+			const DeltaPacket& p = (const DeltaPacket&)packet;
+			return OlderThanNewest(newestSnapshot, p.objectID, p.timeStamp, -FLT_MAX);
+		}
+		case Player_State: {
+			const PlayerStatePacket& p = (const PlayerStatePacket&)packet;
+			return OlderThanNewest(newestPlayerState, p.objectID, p.lastSequence, INT_MIN);
+		}
+	}
+	return false;
 }
@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <thread>
 #include <atomic>
+#include <vector>
 
 namespace NCL {
 	namespace CSC8503 {
@@ -14,7 +15,8 @@ namespace NCL {
 
 			bool Connect(uint8_t a, uint8_t b, uint8_t c, uint8_t d, int portNum);
 
-			void SendPacket(GamePacket&  payload);
+			//Leaving the channel as -1 picks one from the message type
+			void SendPacket(GamePacket&  payload, int channel = -1);
 
 			GamePacket* GetPacket(GamePacket& payload) {
 				return &payload;
@@ -22,7 +24,18 @@ namespace NCL {
 
 			void UpdateClient();
 		protected:	
+			void HandleEvent(const NetworkEvent& e) override;
+			void SendOutgoing(const OutgoingPacket& p) override;
+
+			//Snapshots arrive unsequenced, so anything older than what we've
+			//already had for that object is thrown away here
+			bool IsStale(const GamePacket& packet, size_t length) override;
+
 			_ENetPeer*	netPeer;
+
+			//Indexed by network ID, only touched by whichever thread receives
+			std::vector<float>	newestSnapshot;
+			std::vector<int>	newestPlayerState;
 		};
 	}
 }
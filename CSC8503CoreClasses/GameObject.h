@@ -18,7 +18,7 @@ namespace NCL::CSC8503 {
 	class GameObject	{
 	public:
 		GameObject(const std::string& name = "");
-		~GameObject();
+		virtual ~GameObject();
 
 		void SetNetworkObject(NetworkObject* obj) {
 			this->networkObject = obj;
@@ -150,6 +150,16 @@ namespace NCL::CSC8503 {
 
 		virtual void GameObjectUpdate(float dt);
 
+		//Anything a subclass needs saved in a WorldSnapshot beyond its
+		//transform and physics, e.g. where an AI is in its state machine.
+		//Written as raw bytes, so keep it to plain values.
+		virtual size_t GetSnapshotSize() const {
+			return 0;
+		}
+
+		virtual void WriteSnapshot(char*) const {}
+		virtual void ReadSnapshot(const char*) {}
+
 	protected:
 		Transform			transform;
 
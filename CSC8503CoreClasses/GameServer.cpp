@@ -1,5 +1,7 @@
 #include "GameServer.h"
 #include "GameWorld.h"
+#include "NetworkObject.h"
+#include "EntityReplicator.h"
 #include "./enet/enet.h"
 using namespace NCL;
 using namespace CSC8503;
@@ -9,6 +11,9 @@ GameServer::GameServer(int onPort, int maxClients)	{
 	clientMax	= maxClients;
 	clientCount = 0;
 	netHandle	= nullptr;
+	peerID		= -1;
+	peers.resize(maxClients);
+	SetPeerCount(maxClients);
 	Initialise();
 }
 
@@ -17,6 +22,10 @@ GameServer::~GameServer()	{
 }
 
 void GameServer::Shutdown() {
+	StopNetworkThread();
+	if (!netHandle) {
+		return;
+	}
 	SendGlobalPacket(BasicNetworkMessages::Shutdown);
 	enet_host_destroy(netHandle);
 	netHandle = nullptr;
@@ -27,10 +36,10 @@ bool GameServer::Initialise() {
 	address.host = ENET_HOST_ANY;
 	address.port = port;
 
-	netHandle = enet_host_create(&address, clientMax, 1, 0, 0);
+	netHandle = enet_host_create(&address, clientMax, Channel_Count, 0, 0);
 
 	if (!netHandle) {
-		std::cout << "Server failed to create handle!" << std::endl;
+		NET_LOG_ERROR("Server failed to create handle!");
 		return false;
 	}
 
@@ -44,60 +53,203 @@ bool GameServer::SendGlobalPacket(int msgID) {
 	return SendGlobalPacket(packet);
 }
 
-bool GameServer::SendGlobalPacket(GamePacket& packet) {
-	ENetPacket* dataPacket = enet_packet_create(&packet, packet.GetTotalSize(), 0);
-	enet_host_broadcast(netHandle, 0, dataPacket);
+bool GameServer::SendGlobalPacket(GamePacket& packet, int channel) {
+	if (channel < 0) {
+		channel = GetChannelForMessage(packet.type);
+	}
+	QueueOutgoing(CreatePacket(packet, channel), -1, channel);
+	Record(-1, Replay_Outgoing, channel, packet);
+
+	for (int i = 0; i < (int)peers.size(); ++i) {
+		if (peers[i].connected) {
+			stats.RecordQueued(i, packet.type, packet.GetTotalSize());
+		}
+	}
 
 	return true;
 }
 
-bool GameServer::SendPacket(GamePacket& packet, int peerId)
+bool GameServer::SendPacket(GamePacket& packet, int peerId, int channel)
 {
-	ENetPacket* dataPacket = enet_packet_create(&packet, packet.GetTotalSize(), 0);
-	enet_peer_send(netHandle->peers + peerId, 0, dataPacket);
+	if (channel < 0) {
+		channel = GetChannelForMessage(packet.type);
+	}
+	QueueOutgoing(CreatePacket(packet, channel), peerId, channel);
+	Record(peerId, Replay_Outgoing, channel, packet);
+
+	stats.RecordQueued(peerId, packet.type, packet.GetTotalSize());
 
 	return true;
 	
 }
 
+//Runs on the network thread if there is one. Traffic is counted here, as
+//it's only now that the packet is sure to have gone to enet.
+void GameServer::SendOutgoing(const OutgoingPacket& p) {
+	size_t bytes = p.packet->dataLength;
+	if (p.peerID < 0) {
+		//Broadcasting can free the packet, so its size is read first
+		for (int i = 0; i < (int)netHandle->peerCount; ++i) {
+			if (netHandle->peers[i].state == ENET_PEER_STATE_CONNECTED) {
+				CountSent(i, bytes);
+			}
+		}
+		enet_host_broadcast(netHandle, p.channel, p.packet);
+	}
+	else if (enet_peer_send(netHandle->peers + p.peerID, p.channel, p.packet) == 0) {
+		CountSent(p.peerID, bytes);
+	}
+	else {
+		enet_packet_destroy(p.packet); //enet never took it
+	}
+}
+
 int GameServer::GetPeerID(int peerID) {
 	return peerID;
 }
 
 void GameServer::UpdateServer() {
-	if (!netHandle)
+	PollEvents();
+	CollectSent();
+	stats.EndTick();
+}
+
+void GameServer::HandleEvent(const NetworkEvent& e) {
+	int peer = e.peerID;
+	this->peerID = GetPeerID(peer);
+
+	if (peer < 0 || peer >= clientMax) {
+		return;
+	}
+	PeerSlot& slot = peers[peer];
+
+	if (e.type == ENetEventType::ENET_EVENT_TYPE_CONNECT) {
+		NET_LOG_INFO("Server: New client connected");
+		slot = PeerSlot();
+		slot.connected = true;
+		clientCount++;
+		stats.Connect(peer);
+		stats.UpdateLink(peer, e.roundTripTime, e.jitter, e.packetLoss);
+
+		GamePacket p;
+		p.type = BasicNetworkMessages::Client_Connected;
+		ProcessPacket(&p, peer);
+	}
+	else if (e.type == ENetEventType::ENET_EVENT_TYPE_DISCONNECT) {
+		NET_LOG_INFO("Server: Client disconnected");
+		GamePacket p;
+		p.type = BasicNetworkMessages::Client_Disconnected;
+		ProcessPacket(&p, peer);
+
+		if (slot.connected) {
+			slot.connected = false;
+			clientCount--;
+		}
+		stats.Disconnect(peer);
+	}
+	else if (e.type == ENetEventType::ENET_EVENT_TYPE_RECEIVE) {
+		//Anything too short to have a header still counts as traffic, but
+		//its type can't be read
+		GamePacket* packet	= (GamePacket*)e.packet->data;
+		bool hasHeader		= e.packet->dataLength >= sizeof(GamePacket);
+		stats.RecordReceived(peer, hasHeader ? packet->type : -1, (int)e.packet->dataLength);
+		stats.UpdateLink(peer, e.roundTripTime, e.jitter, e.packetLoss);
+
+		if (hasHeader && (size_t)packet->GetTotalSize() <= e.packet->dataLength) {
+			Record(peer, Replay_Incoming, GetChannelForMessage(packet->type), *packet);
+		}
+		ProcessPacket(packet, peer, e.packet->dataLength);
+	}
+}
+
+void GameServer::AcknowledgeStates(int peerID, const AckPacket& packet) {
+	PeerSlot* slot = GetPeer(peerID);
+	if (!slot) {
 		return;
+	}
+	for (int i = 0; i < packet.GetReceivedCount(); ++i) {
+		int id = packet.acks[i].objectID;
+		if (id < 0 || id > MAX_NETWORK_ID) {
+			continue;
+		}
+		if (id >= (int)slot->ackedStates.size()) {
+			slot->ackedStates.resize(id + 1, -1);
+		}
+		slot->ackedStates[id] = std::max(slot->ackedStates[id], packet.acks[i].stateID);
+	}
+}
+
+bool GameServer::QueueInput(int peerID, const PlayerInput& input) {
+	PeerSlot* slot = GetPeer(peerID);
+	return slot ? slot->inputs.Push(input) : false;
+}
+
+void GameServer::QueueInputs(int peerID, const ClientPacket& packet) {
+	PlayerInput input;
+	for (int i = packet.GetReceivedOlderCount() - 1; i >= 0; --i) {
+		input.sequence = packet.sequence - 1 - i;
+		input.duration = packet.older[i].duration;
+		memcpy(input.buttons, packet.older[i].buttonstates, sizeof(input.buttons));
+		QueueInput(peerID, input);
+	}
+	input.sequence = packet.sequence;
+	input.duration = packet.duration;
+	memcpy(input.buttons, packet.buttonstates, sizeof(input.buttons));
+	QueueInput(peerID, input);
+}
 
-	ENetEvent event;
-	while (enet_host_service(netHandle, &event, 0) > 0) {
-		int type = event.type;
-		ENetPeer* p = event.peer;
-		int peer = p->incomingPeerID;
-		
-		this->peerID = GetPeerID(peer);
-
-		if (type == ENetEventType::ENET_EVENT_TYPE_CONNECT) {
-			std::cout << "Server: New client connected" << std::endl;
-			GamePacket p;
-			p.type = BasicNetworkMessages::Client_Connected;
-			ProcessPacket(&p, peer);
-			// client count not integrated (just using 1 client for now)
-			clientCount++; // Increment the client count
+void PeerInputQueue::Play(float dt, const ApplyFunc& apply) {
+	float remaining = dt;
+	while (remaining > 0.0f) {
+		PlayerInput next;
+		while (timeLeft <= 0.0f && Pop(next)) {
+			current		= next;
+			timeLeft	= std::max(timeLeft, -MAX_HELD_OVER) + next.duration;
+			if (timeLeft > 0.0f) {
+				currentIsNew = true;
+			}
+			else {
+				apply(current, true, 0.0f); //its time has already gone, but a jump in it still happens
+			}
 		}
-		else if (type == ENetEventType::ENET_EVENT_TYPE_DISCONNECT) {
-			std::cout << "Server: Client disconnected" << std::endl;
-			GamePacket p;
-			p.type = BasicNetworkMessages::Client_Disconnected;
-			ProcessPacket(&p, peer);
-			// client count not integrated (just using 1 client for now)
-			clientCount--; // Decrement the client count
+		if (current.sequence < 0) {
+			return; //nothing from this client yet
 		}
-		else if (type == ENetEventType::ENET_EVENT_TYPE_RECEIVE) {
-			GamePacket* packet = (GamePacket*)event.packet->data;
-			ProcessPacket(packet, peer);
+		float share = timeLeft > 0.0f ? std::min(remaining, timeLeft) : remaining;
+		apply(current, currentIsNew, share / dt);
+		currentIsNew = false;
+		timeLeft	-= share;
+		remaining	-= share;
+	}
+}
+
+int GameServer::GetMinimumAckedState(int networkID) const {
+	int minID = INT_MAX;
+	for (const PeerSlot& slot : peers) {
+		if (slot.connected) {
+			minID = std::min(minID, slot.GetAckedState(networkID));
 		}
-		enet_packet_destroy(event.packet);
 	}
+	return minID == INT_MAX ? -1 : minID;
+}
+
+bool GameServer::StartRecording(const std::string& filename) {
+	recordingStart = std::chrono::steady_clock::now();
+	return recorder.Open(filename);
+}
+
+void GameServer::StopRecording() {
+	recorder.Close();
+}
+
+//Only the snapshot channel goes out often enough to be worth replaying,
+//but everything a client sends us is kept
+void GameServer::Record(int peer, ReplayDirection direction, int channel, GamePacket& packet) {
+	if (!recorder.IsOpen() || (direction == Replay_Outgoing && channel != Channel_Snapshot)) {
+		return;
+	}
+	float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - recordingStart).count();
+	recorder.Record(time, peer, direction, channel, packet);
 }
 
 void GameServer::SetGameWorld(GameWorld &g) {
@@ -1,9 +1,105 @@
 #pragma once
 #include "NetworkBase.h"
+#include "ClientPrediction.h"
+#include "ReplayLog.h"
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <cmath>
 
 namespace NCL {
 	namespace CSC8503 {
 		class GameWorld;
+		struct ClientPacket;
+		struct AckPacket;
+
+		//Inputs a client has sent that the game hasn't used yet, oldest first.
+		//Anything older than the newest input already queued is ignored.
+		struct PeerInputQueue {
+			static const int SIZE = 32;
+
+			//How far ahead of the client holding on to its last input can get
+			//before the time stops being taken back off its next inputs
+			static constexpr float MAX_HELD_OVER = 0.25f;
+
+			//Longest a client can say it held one input for. Anything longer,
+			//or negative, is clamped, and inputs with no real duration at
+			//all are thrown away, so a bad packet can't stall the queue.
+			static constexpr float MAX_INPUT_DURATION = 0.25f;
+
+			//Called with an input and the share of the frame it was held for
+			typedef std::function<void(const PlayerInput&, bool isNewInput, float share)> ApplyFunc;
+
+			bool Push(PlayerInput input) {
+				if (input.sequence <= newestSequence || !std::isfinite(input.duration)) {
+					return false;
+				}
+				input.duration = std::clamp(input.duration, 0.0f, MAX_INPUT_DURATION);
+				if (count == SIZE) {
+					head = (head + 1) % SIZE; //drop the oldest
+					count--;
+				}
+				inputs[(head + count) % SIZE] = input;
+				count++;
+				newestSequence = input.sequence;
+				return true;
+			}
+
+			bool Pop(PlayerInput& out) {
+				if (count == 0) {
+					return false;
+				}
+				out		= inputs[head];
+				head	= (head + 1) % SIZE;
+				count--;
+				return true;
+			}
+
+			void Clear() {
+				head			= 0;
+				count			= 0;
+				newestSequence	= -1;
+				current			= PlayerInput();
+				timeLeft		= 0.0f;
+				currentIsNew	= false;
+			}
+
+			//Plays the queue back for dt seconds, holding each input for as
+			//long as it was held on the client - so one frame can take in the
+			//end of one input and the start of the next. If the queue runs dry
+			//the last input is held on, and that time is taken back off the
+			//ones after so we don't end up ahead of the client.
+			void Play(float dt, const ApplyFunc& apply);
+
+			//How long the input being played back has been held for, which
+			//the client needs to line a player's state up with its own
+			float GetHeldTime() const {
+				return current.duration - timeLeft;
+			}
+
+			PlayerInput	inputs[SIZE];
+			int			head			= 0;
+			int			count			= 0;
+			int			newestSequence	= -1;
+
+			PlayerInput	current;				//the one being played back
+			float		timeLeft		= 0.0f;	//below zero when it's been held over
+			bool		currentIsNew	= false;
+		};
+
+		//Everything the server tracks about one connection for the game.
+		//Traffic and link quality are in GetStats(), under the same index.
+		struct PeerSlot {
+			bool	connected			= false;
+			std::vector<int> ackedStates;	//by network ID, the newest full state the client has, for deltas
+			PeerInputQueue inputs;
+
+			int GetAckedState(int networkID) const {
+				return (networkID >= 0 && networkID < (int)ackedStates.size()) ? ackedStates[networkID] : -1;
+			}
+		};
+
 		class GameServer : public NetworkBase {
 		public:
 			GameServer(int onPort, int maxClients);
@@ -14,23 +110,68 @@ namespace NCL {
 
 			void SetGameWorld(GameWorld &g);
 
+			//Leaving the channel as -1 picks one from the message type
 			bool SendGlobalPacket(int msgID);
-			bool SendGlobalPacket(GamePacket& packet);
+			bool SendGlobalPacket(GamePacket& packet, int channel = -1);
 
-			bool SendPacket(GamePacket& packet, int peerId);
+			bool SendPacket(GamePacket& packet, int peerId, int channel = -1);
 
 			virtual void UpdateServer();
 
 			int GetPeerID(int peerID);
 
+			int GetClientCount() const {
+				return clientCount;
+			}
+
+			int GetMaxClients() const {
+				return clientMax;
+			}
+
+			//Slots are indexed by enet peer ID, and stay put while connected
+			PeerSlot* GetPeer(int peerID) {
+				return (peerID >= 0 && peerID < (int)peers.size() && peers[peerID].connected) ? &peers[peerID] : nullptr;
+			}
+
+			void AcknowledgeStates(int peerID, const AckPacket& packet);
+			bool QueueInput(int peerID, const PlayerInput& input);
+			//Queues the inputs resent in a client packet, oldest first, then its
+			//newest. Ones already queued are skipped.
+			void QueueInputs(int peerID, const ClientPacket& packet);
+
+			//The oldest state of an object any connected client still needs as
+			//a baseline, or -1 if one of them hasn't acknowledged any yet
+			int GetMinimumAckedState(int networkID) const;
+
+			//Logs every snapshot sent and every packet received from then on,
+			//for playing back later through a ReplayPlayer
+			bool StartRecording(const std::string& filename);
+			void StopRecording();
+
+			bool IsRecording() const {
+				return recorder.IsOpen();
+			}
+
+			const ReplayRecorder& GetRecorder() const {
+				return recorder;
+			}
+
 		protected:
+			void Record(int peer, ReplayDirection direction, int channel, GamePacket& packet);
+
+			void HandleEvent(const NetworkEvent& e) override;
+			void SendOutgoing(const OutgoingPacket& p) override;
+
 			int			port;
 			int			clientMax;
 			int			clientCount;
 			GameWorld*	gameWorld;
 
-			int incomingDataRate;
-			int outgoingDataRate;
+			std::vector<PeerSlot> peers;
+
+			ReplayRecorder recorder;
+			std::chrono::steady_clock::time_point recordingStart;
+
 			int peerID;
 		};
 	}
@@ -3,6 +3,7 @@
 #include "Constraint.h"
 #include "CollisionDetection.h"
 #include "Camera.h"
+#include "PhysicsObject.h"
 
 
 using namespace NCL;
@@ -13,6 +14,7 @@ GameWorld::GameWorld()	{
 	shuffleObjects		= false;
 	worldIDCounter		= 0;
 	worldStateCounter	= 0;
+	shuffleRandom.seed(std::random_device{}());
 }
 
 GameWorld::~GameWorld()	{
@@ -67,17 +69,14 @@ void GameWorld::UpdateWorld(float dt) {
 	for (auto& i : gameObjects) {
 		i->GameObjectUpdate(dt);
 	}
-	auto rng = std::default_random_engine{};
-
-	unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-	std::default_random_engine e(seed);
-
+	//Seeded once rather than from the clock every frame, so a world given
+	//the same seed shuffles the same way every time
 	if (shuffleObjects) {
-		std::shuffle(gameObjects.begin(), gameObjects.end(), e);
+		std::shuffle(gameObjects.begin(), gameObjects.end(), shuffleRandom);
 	}
 
 	if (shuffleConstraints) {
-		std::shuffle(constraints.begin(), constraints.end(), e);
+		std::shuffle(constraints.begin(), constraints.end(), shuffleRandom);
 	}
 }
 
@@ -143,4 +142,134 @@ void GameWorld::GetConstraintIterators(
 	std::vector<Constraint*>::const_iterator& last) const {
 	first	= constraints.begin();
 	last	= constraints.end();
-}
\ No newline at end of file
+}
+void GameWorld::SaveState(WorldSnapshot& snapshot) const {
+	int count = (int)gameObjects.size();
+
+	size_t extraBytes = 0;
+	for (GameObject* o : gameObjects) {
+		extraBytes += o->GetSnapshotSize();
+	}
+	snapshot.Reserve(count, extraBytes);
+
+	float* px = snapshot.GetChannel(WorldSnapshot::PositionX);
+	float* py = snapshot.GetChannel(WorldSnapshot::PositionY);
+	float* pz = snapshot.GetChannel(WorldSnapshot::PositionZ);
+	float* ox = snapshot.GetChannel(WorldSnapshot::OrientationX);
+	float* oy = snapshot.GetChannel(WorldSnapshot::OrientationY);
+	float* oz = snapshot.GetChannel(WorldSnapshot::OrientationZ);
+	float* ow = snapshot.GetChannel(WorldSnapshot::OrientationW);
+	float* lx = snapshot.GetChannel(WorldSnapshot::LinearX);
+	float* ly = snapshot.GetChannel(WorldSnapshot::LinearY);
+	float* lz = snapshot.GetChannel(WorldSnapshot::LinearZ);
+	float* ax = snapshot.GetChannel(WorldSnapshot::AngularX);
+	float* ay = snapshot.GetChannel(WorldSnapshot::AngularY);
+	float* az = snapshot.GetChannel(WorldSnapshot::AngularZ);
+	float* fx = snapshot.GetChannel(WorldSnapshot::ForceX);
+	float* fy = snapshot.GetChannel(WorldSnapshot::ForceY);
+	float* fz = snapshot.GetChannel(WorldSnapshot::ForceZ);
+	float* tx = snapshot.GetChannel(WorldSnapshot::TorqueX);
+	float* ty = snapshot.GetChannel(WorldSnapshot::TorqueY);
+	float* tz = snapshot.GetChannel(WorldSnapshot::TorqueZ);
+
+	uint32_t extraOffset = 0;
+	for (int i = 0; i < count; ++i) {
+		GameObject* o = gameObjects[i];
+		snapshot.objects[i] = o;
+
+		Vector3		position	= o->GetTransform().GetPosition();
+		Quaternion	orientation = o->GetTransform().GetOrientation();
+		px[i] = position.x;
+		py[i] = position.y;
+		pz[i] = position.z;
+		ox[i] = orientation.x;
+		oy[i] = orientation.y;
+		oz[i] = orientation.z;
+		ow[i] = orientation.w;
+
+		uint8_t flags = o->IsActive() ? WorldSnapshot::Flag_Active : 0;
+		if (PhysicsObject* phys = o->GetPhysicsObject()) {
+			flags |= WorldSnapshot::Flag_Physics;
+
+			Vector3 linear	= phys->GetLinearVelocity();
+			Vector3 angular = phys->GetAngularVelocity();
+			Vector3 force	= phys->GetForce();
+			Vector3 torque	= phys->GetTorque();
+			lx[i] = linear.x;
+			ly[i] = linear.y;
+			lz[i] = linear.z;
+			ax[i] = angular.x;
+			ay[i] = angular.y;
+			az[i] = angular.z;
+			fx[i] = force.x;
+			fy[i] = force.y;
+			fz[i] = force.z;
+			tx[i] = torque.x;
+			ty[i] = torque.y;
+			tz[i] = torque.z;
+		}
+		snapshot.flags[i] = flags;
+
+		snapshot.extraOffsets[i] = extraOffset;
+		size_t extraSize = o->GetSnapshotSize();
+		if (extraSize > 0) {
+			o->WriteSnapshot(&snapshot.extra[extraOffset]);
+			extraOffset += (uint32_t)extraSize;
+		}
+	}
+	snapshot.extraOffsets[count] = extraOffset;
+
+	snapshot.constraints.assign(constraints.begin(), constraints.end());
+	snapshot.random			= shuffleRandom;
+	snapshot.objectCount	= count;
+	snapshot.worldState		= worldStateCounter;
+}
+
+bool GameWorld::RestoreState(const WorldSnapshot& snapshot) {
+	if (snapshot.worldState != worldStateCounter || snapshot.objectCount != (int)gameObjects.size()) {
+		return false;
+	}
+	int count = snapshot.objectCount;
+
+	const float* px = snapshot.GetChannel(WorldSnapshot::PositionX);
+	const float* py = snapshot.GetChannel(WorldSnapshot::PositionY);
+	const float* pz = snapshot.GetChannel(WorldSnapshot::PositionZ);
+	const float* ox = snapshot.GetChannel(WorldSnapshot::OrientationX);
+	const float* oy = snapshot.GetChannel(WorldSnapshot::OrientationY);
+	const float* oz = snapshot.GetChannel(WorldSnapshot::OrientationZ);
+	const float* ow = snapshot.GetChannel(WorldSnapshot::OrientationW);
+	const float* lx = snapshot.GetChannel(WorldSnapshot::LinearX);
+	const float* ly = snapshot.GetChannel(WorldSnapshot::LinearY);
+	const float* lz = snapshot.GetChannel(WorldSnapshot::LinearZ);
+	const float* ax = snapshot.GetChannel(WorldSnapshot::AngularX);
+	const float* ay = snapshot.GetChannel(WorldSnapshot::AngularY);
+	const float* az = snapshot.GetChannel(WorldSnapshot::AngularZ);
+	const float* fx = snapshot.GetChannel(WorldSnapshot::ForceX);
+	const float* fy = snapshot.GetChannel(WorldSnapshot::ForceY);
+	const float* fz = snapshot.GetChannel(WorldSnapshot::ForceZ);
+	const float* tx = snapshot.GetChannel(WorldSnapshot::TorqueX);
+	const float* ty = snapshot.GetChannel(WorldSnapshot::TorqueY);
+	const float* tz = snapshot.GetChannel(WorldSnapshot::TorqueZ);
+
+	for (int i = 0; i < count; ++i) {
+		GameObject* o	= snapshot.objects[i];
+		gameObjects[i]	= o; //undoes any shuffling since
+
+		o->GetTransform().SetPositionAndOrientation(Vector3(px[i], py[i], pz[i]), Quaternion(ox[i], oy[i], oz[i], ow[i]));
+		o->SetActive((snapshot.flags[i] & WorldSnapshot::Flag_Active) != 0);
+
+		PhysicsObject* phys = o->GetPhysicsObject();
+		if (phys && (snapshot.flags[i] & WorldSnapshot::Flag_Physics)) {
+			phys->SetLinearVelocity(Vector3(lx[i], ly[i], lz[i]));
+			phys->SetAngularVelocity(Vector3(ax[i], ay[i], az[i]));
+			phys->SetForce(Vector3(fx[i], fy[i], fz[i]));
+			phys->SetTorque(Vector3(tx[i], ty[i], tz[i]));
+		}
+		if (snapshot.extraOffsets[i + 1] > snapshot.extraOffsets[i]) {
+			o->ReadSnapshot(&snapshot.extra[snapshot.extraOffsets[i]]);
+		}
+	}
+	constraints.assign(snapshot.constraints.begin(), snapshot.constraints.end());
+	shuffleRandom = snapshot.random;
+	return true;
+}
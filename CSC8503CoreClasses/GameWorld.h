@@ -4,6 +4,7 @@
 #include "Ray.h"
 #include "CollisionDetection.h"
 #include "QuadTree.h"
+#include "WorldSnapshot.h"
 
 namespace NCL {
 		class Camera;
@@ -18,7 +19,7 @@ namespace NCL {
 		class GameWorld	{
 		public:
 			GameWorld();
-			~GameWorld();
+			virtual ~GameWorld();
 
 			void Clear();
 			void ClearAndErase();
@@ -41,6 +42,11 @@ namespace NCL {
 				shuffleObjects = state;
 			}
 
+			//Worlds sharing a seed (and the same objects) shuffle identically
+			void SetRandomSeed(unsigned int seed) {
+				shuffleRandom.seed(seed);
+			}
+
 			bool Raycast(Ray& r, RayCollision& closestCollision, bool closestObject = false, GameObject* ignore = nullptr, LayerMask layermask = -1) const;
 
 			virtual void UpdateWorld(float dt);
@@ -59,6 +65,14 @@ namespace NCL {
 				return worldStateCounter;
 			}
 
+			//Copies every object's transform, physics and extra state into
+			//the snapshot. Fast enough to do every frame for rollback.
+			void SaveState(WorldSnapshot& snapshot) const;
+
+			//Puts everything back as it was when saved. Fails if objects
+			//have been added or removed since.
+			bool RestoreState(const WorldSnapshot& snapshot);
+
 		protected:
 			std::vector<GameObject*> gameObjects;
 			std::vector<Constraint*> constraints;
@@ -67,6 +81,7 @@ namespace NCL {
 
 			bool shuffleConstraints;
 			bool shuffleObjects;
+			std::mt19937 shuffleRandom;
 			int		worldIDCounter;
 			int		worldStateCounter;
 		};
@@ -0,0 +1,652 @@
+#include "HierarchicalGrid.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	const int BORDER_TOP	= 0;
+	const int BORDER_BOTTOM = 1;
+	const int BORDER_LEFT	= 2;
+	const int BORDER_RIGHT	= 3;
+
+	//As on the grid, prefers whichever of two equally good nodes is
+	//further along, so open ground doesn't fan out into a wide search
+	const float TIE_BREAK = 0.0001f;
+
+	const uint16_t NO_AREA = 0xFFFF;
+
+	//The four steps a path can take, in the order moves are stored as
+	const int STEPS[4][2] = { { 0, -1 }, { 0, 1 }, { -1, 0 }, { 1, 0 } };
+
+	int OppositeBorder(int border) {
+		return border ^ 1;
+	}
+
+	void NextLocalSearch(HierarchicalScratch& s) {
+		if (++s.localGeneration == 0) {
+			std::fill(s.localSeen.begin(), s.localSeen.end(), 0);
+			s.localGeneration = 1;
+		}
+	}
+
+	uint8_t StepBetween(int fromX, int fromY, int toX, int toY) {
+		if (toY < fromY) return 0;
+		if (toY > fromY) return 1;
+		if (toX < fromX) return 2;
+		return 3;
+	}
+}
+
+HierarchicalGrid::HierarchicalGrid(NavigationGrid& grid, int clusterSize) : grid(grid) {
+	this->clusterSize	= std::clamp(clusterSize, 2, 256); //areas are counted in 16 bits
+	clustersWide		= (grid.GetGridWidth() + this->clusterSize - 1) / this->clusterSize;
+	clustersHigh		= (grid.GetGridHeight() + this->clusterSize - 1) / this->clusterSize;
+	version				= 0;
+	areas.resize(grid.GetGridWidth() * grid.GetGridHeight());
+
+	clusters.resize(clustersWide * clustersHigh);
+	for (int cy = 0; cy < clustersHigh; ++cy) {
+		for (int cx = 0; cx < clustersWide; ++cx) {
+			Cluster& c	= clusters[cy * clustersWide + cx];
+			c.x			= cx * this->clusterSize;
+			c.y			= cy * this->clusterSize;
+			c.width		= std::min(this->clusterSize, grid.GetGridWidth() - c.x);
+			c.height	= std::min(this->clusterSize, grid.GetGridHeight() - c.y);
+		}
+	}
+	Build();
+}
+
+HierarchicalGrid::~HierarchicalGrid() {
+}
+
+void HierarchicalGrid::Build() {
+	PrepareScratch(scratch);
+	for (int i = 0; i < (int)clusters.size(); ++i) {
+		LabelAreas(i);
+		BuildEntrances(i);
+	}
+	for (int i = 0; i < (int)clusters.size(); ++i) {
+		LinkPartners(i);
+		BuildIntraEdges(i, scratch);
+	}
+	BuildGraph();
+}
+
+void HierarchicalGrid::PrepareScratch(HierarchicalScratch& s) const {
+	int localSize = clusterSize * clusterSize;
+	if ((int)s.localSeen.size() != localSize) {
+		s.localDistance.resize(localSize);
+		s.localParent.resize(localSize);
+		s.localSeen.assign(localSize, 0);
+		s.localQueue.resize(localSize);
+		s.localOpen.Resize(localSize);
+		s.localGeneration = 0;
+	}
+}
+
+void HierarchicalGrid::SetTileType(int x, int y, char type) {
+	if (x < 0 || y < 0 || x >= grid.GetGridWidth() || y >= grid.GetGridHeight()) {
+		return;
+	}
+	grid.SetTileType(x, y, type);
+
+	int changed[5];
+	int count	= 0;
+	int home	= ClusterAt(x, y);
+	const Cluster& c = clusters[home];
+	changed[count++] = home;
+
+	//On a border, the entrances shared with the cluster across it can move too
+	if (y == c.y && c.y > 0)										changed[count++] = home - clustersWide;
+	if (y == c.y + c.height - 1 && c.y + c.height < grid.GetGridHeight())	changed[count++] = home + clustersWide;
+	if (x == c.x && c.x > 0)										changed[count++] = home - 1;
+	if (x == c.x + c.width - 1 && c.x + c.width < grid.GetGridWidth())	changed[count++] = home + 1;
+
+	PrepareScratch(scratch);
+	LabelAreas(home); //only its tiles have changed
+	for (int i = 0; i < count; ++i) {
+		BuildEntrances(changed[i]);
+	}
+	//Nodes in a rebuilt cluster may have shifted, so whatever links to
+	//them from next door has to be found again
+	for (int i = 0; i < count; ++i) {
+		int cx = changed[i] % clustersWide;
+		int cy = changed[i] / clustersWide;
+		LinkPartners(changed[i]);
+		if (cy > 0)					LinkPartners(changed[i] - clustersWide);
+		if (cy < clustersHigh - 1)	LinkPartners(changed[i] + clustersWide);
+		if (cx > 0)					LinkPartners(changed[i] - 1);
+		if (cx < clustersWide - 1)	LinkPartners(changed[i] + 1);
+	}
+	for (int i = 0; i < count; ++i) {
+		BuildIntraEdges(changed[i], scratch);
+	}
+	BuildGraph();
+}
+
+//Floods each open area of the cluster in turn with its own number. A
+//cluster can't have more areas than half its nodes, so a uint16 does for
+//any cluster up to 256 across.
+void HierarchicalGrid::LabelAreas(int cluster) {
+	const Cluster& c	= clusters[cluster];
+	int gridWidth		= grid.GetGridWidth();
+	for (int y = c.y; y < c.y + c.height; ++y) {
+		std::fill(areas.begin() + y * gridWidth + c.x, areas.begin() + y * gridWidth + c.x + c.width, NO_AREA);
+	}
+	std::vector<int>& queue = scratch.localQueue;
+	uint16_t next = 0;
+	for (int y = c.y; y < c.y + c.height; ++y) {
+		for (int x = c.x; x < c.x + c.width; ++x) {
+			if (areas[y * gridWidth + x] != NO_AREA || !grid.IsWalkable(x, y)) {
+				continue;
+			}
+			int head = 0;
+			int tail = 0;
+			queue[tail++] = y * gridWidth + x;
+			areas[y * gridWidth + x] = next;
+			while (head < tail) {
+				int cell	= queue[head++];
+				int cx		= cell % gridWidth;
+				int cy		= cell / gridWidth;
+				for (const auto& o : STEPS) {
+					int nx = cx + o[0];
+					int ny = cy + o[1];
+					if (nx < c.x || ny < c.y || nx >= c.x + c.width || ny >= c.y + c.height) {
+						continue;
+					}
+					int n = ny * gridWidth + nx;
+					if (areas[n] == NO_AREA && grid.IsWalkable(nx, ny)) {
+						areas[n] = next;
+						queue[tail++] = n;
+					}
+				}
+			}
+			next++;
+		}
+	}
+}
+
+void HierarchicalGrid::BuildEntrances(int cluster) {
+	Cluster& c = clusters[cluster];
+	c.nodes.clear();
+	for (int border = 0; border < 4; ++border) {
+		AddBorderEntrances(c, border);
+	}
+}
+
+//Walks along one border, finding the runs where both this side and the
+//other are open, and puts an entrance in the middle of each. The cluster
+//across does exactly the same walk from its side, so both agree on where
+//the entrances are. One per run keeps the graph small - a path along a
+//wide opening has to bend through its middle, but only by a few nodes.
+void HierarchicalGrid::AddBorderEntrances(Cluster& c, int border) {
+	int gridWidth = grid.GetGridWidth();
+
+	int startX, startY, stepX, stepY, acrossX, acrossY, length;
+	switch (border) {
+		case BORDER_TOP:	startX = c.x;				startY = c.y;					stepX = 1; stepY = 0; acrossX = 0;	acrossY = -1;	length = c.width;	break;
+		case BORDER_BOTTOM: startX = c.x;				startY = c.y + c.height - 1;	stepX = 1; stepY = 0; acrossX = 0;	acrossY = 1;	length = c.width;	break;
+		case BORDER_LEFT:	startX = c.x;				startY = c.y;					stepX = 0; stepY = 1; acrossX = -1; acrossY = 0;	length = c.height;	break;
+		default:			startX = c.x + c.width - 1; startY = c.y;					stepX = 0; stepY = 1; acrossX = 1;	acrossY = 0;	length = c.height;	break;
+	}
+	if (startX + acrossX < 0 || startY + acrossY < 0 || startX + acrossX >= gridWidth || startY + acrossY >= grid.GetGridHeight()) {
+		return; //the edge of the map, nothing across it
+	}
+	auto emit = [&](int t) {
+		AbstractNode n;
+		n.cell		= (startY + stepY * t) * gridWidth + (startX + stepX * t);
+		n.border	= border;
+		n.partner	= -1;
+		c.nodes.emplace_back(n);
+	};
+	int runStart = -1;
+	for (int t = 0; t <= length; ++t) {
+		int x = startX + stepX * t;
+		int y = startY + stepY * t;
+		bool open = t < length && grid.IsWalkable(x, y) && grid.IsWalkable(x + acrossX, y + acrossY);
+		if (open && runStart < 0) {
+			runStart = t;
+		}
+		else if (!open && runStart >= 0) {
+			emit(runStart + (t - 1 - runStart) / 2);
+			runStart = -1;
+		}
+	}
+}
+
+int HierarchicalGrid::ClusterAcross(int cluster, int border) const {
+	switch (border) {
+		case BORDER_TOP:	return cluster - clustersWide;
+		case BORDER_BOTTOM: return cluster + clustersWide;
+		case BORDER_LEFT:	return cluster - 1;
+		default:			return cluster + 1;
+	}
+}
+
+void HierarchicalGrid::LinkPartners(int cluster) {
+	int gridWidth = grid.GetGridWidth();
+	for (AbstractNode& n : clusters[cluster].nodes) {
+		int across = n.cell;
+		switch (n.border) {
+			case BORDER_TOP:	across -= gridWidth;	break;
+			case BORDER_BOTTOM: across += gridWidth;	break;
+			case BORDER_LEFT:	across -= 1;			break;
+			default:			across += 1;			break;
+		}
+		n.partner = -1;
+		const std::vector<AbstractNode>& otherNodes = clusters[ClusterAcross(cluster, n.border)].nodes;
+		for (int i = 0; i < (int)otherNodes.size(); ++i) {
+			if (otherNodes[i].cell == across && otherNodes[i].border == OppositeBorder(n.border)) {
+				n.partner = i;
+				break;
+			}
+		}
+	}
+}
+
+//Links every pair of entrances that can reach each other inside the
+//cluster, keeping the steps between them from the search's parents
+void HierarchicalGrid::BuildIntraEdges(int cluster, HierarchicalScratch& s) {
+	Cluster& c		= clusters[cluster];
+	int gridWidth	= grid.GetGridWidth();
+	c.moves.clear();
+	for (int i = 0; i < (int)c.nodes.size(); ++i) {
+		c.nodes[i].edges.clear();
+		SearchCluster(cluster, c.nodes[i].cell, s);
+		for (int j = 0; j < (int)c.nodes.size(); ++j) {
+			if (i == j) {
+				continue;
+			}
+			int cell	= c.nodes[j].cell;
+			int local	= (cell / gridWidth - c.y) * c.width + (cell % gridWidth - c.x);
+			if (s.localSeen[local] != s.localGeneration) {
+				continue;
+			}
+			Edge e;
+			e.to		= j;
+			e.cost		= (float)s.localDistance[local];
+			e.firstMove = (int)c.moves.size();
+			e.moveCount = s.localDistance[local];
+			for (int n = local; s.localParent[n] >= 0; n = s.localParent[n]) {
+				int p = s.localParent[n];
+				c.moves.emplace_back(StepBetween(p % c.width, p / c.width, n % c.width, n / c.width));
+			}
+			std::reverse(c.moves.begin() + e.firstMove, c.moves.end());
+			c.nodes[i].edges.emplace_back(e);
+		}
+	}
+}
+
+//Lays every cluster's nodes, edges and steps end to end. Cheap next to
+//rebuilding even one cluster, so it's just done again after every change.
+void HierarchicalGrid::BuildGraph() {
+	int gridWidth = grid.GetGridWidth();
+	firstNode.resize(clusters.size());
+	int nodeCount = 0;
+	for (int i = 0; i < (int)clusters.size(); ++i) {
+		firstNode[i] = nodeCount;
+		nodeCount += (int)clusters[i].nodes.size();
+	}
+	graph.resize(nodeCount);
+	graphEdges.clear();
+	graphMoves.clear();
+	for (int i = 0; i < (int)clusters.size(); ++i) {
+		const Cluster& c	= clusters[i];
+		int movesFrom		= (int)graphMoves.size();
+		graphMoves.insert(graphMoves.end(), c.moves.begin(), c.moves.end());
+
+		for (int j = 0; j < (int)c.nodes.size(); ++j) {
+			const AbstractNode& n	= c.nodes[j];
+			GraphNode& g			= graph[NodeID(i, j)];
+			g.cell		= n.cell;
+			g.x			= n.cell % gridWidth;
+			g.y			= n.cell / gridWidth;
+			g.cluster	= i;
+			g.partner	= n.partner >= 0 ? NodeID(ClusterAcross(i, n.border), n.partner) : -1;
+			g.firstEdge = (int)graphEdges.size();
+			g.edgeCount = (int)n.edges.size();
+			for (const Edge& e : n.edges) {
+				graphEdges.push_back({ NodeID(i, e.to), e.cost, movesFrom + e.firstMove, e.moveCount });
+			}
+		}
+	}
+	version++;
+}
+
+void HierarchicalGrid::SearchCluster(int cluster, int fromCell, HierarchicalScratch& s) const {
+	const Cluster& c	= clusters[cluster];
+	int gridWidth		= grid.GetGridWidth();
+
+	NextLocalSearch(s);
+	int fromLocal = (fromCell / gridWidth - c.y) * c.width + (fromCell % gridWidth - c.x);
+	s.localSeen[fromLocal]		= s.localGeneration;
+	s.localDistance[fromLocal]	= 0;
+	s.localParent[fromLocal]	= -1;
+
+	int head = 0;
+	int tail = 0;
+	s.localQueue[tail++] = fromLocal;
+	while (head < tail) {
+		int local = s.localQueue[head++];
+		int lx = local % c.width;
+		int ly = local / c.width;
+		for (const auto& o : STEPS) {
+			int nx = lx + o[0];
+			int ny = ly + o[1];
+			if (nx < 0 || ny < 0 || nx >= c.width || ny >= c.height || !grid.IsWalkable(nx + c.x, ny + c.y)) {
+				continue;
+			}
+			int n = ny * c.width + nx;
+			if (s.localSeen[n] == s.localGeneration) {
+				continue;
+			}
+			s.localSeen[n]		= s.localGeneration;
+			s.localDistance[n]	= s.localDistance[local] + 1;
+			s.localParent[n]	= local;
+			s.localQueue[tail++] = n;
+		}
+	}
+}
+
+int HierarchicalGrid::SearchClusterTo(int cluster, int fromCell, int toCell, HierarchicalScratch& s) const {
+	const Cluster& c	= clusters[cluster];
+	int gridWidth		= grid.GetGridWidth();
+	int toX				= toCell % gridWidth - c.x;
+	int toY				= toCell / gridWidth - c.y;
+	if (toX < 0 || toY < 0 || toX >= c.width || toY >= c.height) {
+		return -1;
+	}
+	int toLocal		= toY * c.width + toX;
+	int fromLocal	= (fromCell / gridWidth - c.y) * c.width + (fromCell % gridWidth - c.x);
+
+	NextLocalSearch(s);
+	s.localOpen.Clear();
+	s.localSeen[fromLocal]		= s.localGeneration;
+	s.localDistance[fromLocal]	= 0;
+	s.localParent[fromLocal]	= -1;
+	s.localOpen.Push(fromLocal, 0.0f);
+
+	//Steps all cost the same, so the first time a node comes off the open
+	//list is the shortest way to it
+	while (!s.localOpen.IsEmpty()) {
+		int local = s.localOpen.Pop();
+		if (local == toLocal) {
+			return s.localDistance[local];
+		}
+		int ly = local / c.width;
+		int lx = local - ly * c.width;
+		int g  = s.localDistance[local] + 1;
+		for (const auto& o : STEPS) {
+			int nx = lx + o[0];
+			int ny = ly + o[1];
+			if (nx < 0 || ny < 0 || nx >= c.width || ny >= c.height || !grid.IsWalkable(nx + c.x, ny + c.y)) {
+				continue;
+			}
+			int n = ny * c.width + nx;
+			if (s.localSeen[n] == s.localGeneration && s.localDistance[n] <= g) {
+				continue;
+			}
+			s.localSeen[n]		= s.localGeneration;
+			s.localDistance[n]	= g;
+			s.localParent[n]	= local;
+			float h = (float)(std::abs(nx - toX) + std::abs(ny - toY));
+			s.localOpen.Push(n, g + h - g * TIE_BREAK);
+		}
+	}
+	return -1;
+}
+
+float HierarchicalGrid::Heuristic(int cell, int goalCell) const {
+	int gridWidth = grid.GetGridWidth();
+	return (float)(std::abs(cell % gridWidth - goalCell % gridWidth) + std::abs(cell / gridWidth - goalCell / gridWidth));
+}
+
+bool HierarchicalGrid::FindAbstractPath(const Vector3& from, const Vector3& to, HierarchicalPath& outPath, HierarchicalScratch& s) const {
+	outPath.Clear();
+	int startCell	= grid.GetNodeIndex(from);
+	int goalCell	= grid.GetNodeIndex(to);
+	if (startCell < 0 || goalCell < 0) {
+		return false; //outside of map region!
+	}
+	int gridWidth		= grid.GetGridWidth();
+	if (!grid.IsWalkable(startCell % gridWidth, startCell / gridWidth) || !grid.IsWalkable(goalCell % gridWidth, goalCell / gridWidth)) {
+		return false; //the entrance distances are only between open nodes
+	}
+	PrepareScratch(s);
+	int startCluster	= ClusterAt(startCell % gridWidth, startCell / gridWidth);
+	int goalCluster		= ClusterAt(goalCell % gridWidth, goalCell / gridWidth);
+
+	//The start is linked to every entrance of its cluster that's in the
+	//same open area, and to the goal if that is too. How far each is only
+	//needs to be near enough to choose between them, so it's taken as the
+	//straight 4-way distance rather than searched for - the leg is found
+	//properly when it's refined.
+	float directCost = -1.0f;
+	s.startEdges.clear();
+	{
+		const Cluster& c	= clusters[startCluster];
+		uint16_t area		= areas[startCell];
+		for (int i = 0; i < (int)c.nodes.size(); ++i) {
+			if (areas[c.nodes[i].cell] == area) {
+				s.startEdges.emplace_back(NodeID(startCluster, i), Heuristic(startCell, c.nodes[i].cell));
+			}
+		}
+		if (goalCluster == startCluster && areas[goalCell] == area) {
+			directCost = Heuristic(startCell, goalCell);
+		}
+	}
+	//...and the goal to those of its own cluster the same way
+	{
+		const Cluster& c	= clusters[goalCluster];
+		uint16_t area		= areas[goalCell];
+		s.goalDistance.resize(c.nodes.size());
+		for (int i = 0; i < (int)c.nodes.size(); ++i) {
+			s.goalDistance[i] = areas[c.nodes[i].cell] == area ? Heuristic(goalCell, c.nodes[i].cell) : -1.0f;
+		}
+	}
+	int total		= (int)graph.size();
+	int startNode	= total;
+	int goalNode	= total + 1;
+	int goalX		= goalCell % gridWidth;
+	int goalY		= goalCell / gridWidth;
+	int goalFirst	= firstNode[goalCluster];
+
+	GridSearchScratch& a = s.abstract;
+	a.Begin(total + 2);
+	s.parentEdge.resize(total + 2);
+
+	auto relax = [&](int id, int parent, int edge, float g) {
+		if (a.IsClosed(id)) {
+			return;
+		}
+		if (!a.IsSeen(id) || g < a.g[id]) {
+			a.seen[id]			= a.generation;
+			a.g[id]				= g;
+			a.parent[id]		= parent;
+			s.parentEdge[id]	= edge;
+			float h = id == goalNode ? 0.0f : (float)(std::abs(graph[id].x - goalX) + std::abs(graph[id].y - goalY));
+			a.open.Push(id, g + h - g * TIE_BREAK);
+		}
+	};
+	a.g[startNode]		= 0.0f;
+	a.parent[startNode] = -1;
+	a.seen[startNode]	= a.generation;
+	a.open.Push(startNode, 0.0f);
+
+	bool found = false;
+	while (!a.open.IsEmpty()) {
+		int id = a.open.Pop();
+		a.closed[id] = a.generation;
+		a.expanded++;
+
+		if (id == goalNode) {
+			found = true;
+			break;
+		}
+		float g = a.g[id];
+		if (id == startNode) {
+			for (const auto& [node, cost] : s.startEdges) {
+				relax(node, id, -1, g + cost);
+			}
+			if (directCost >= 0.0f) {
+				relax(goalNode, id, -1, g + directCost);
+			}
+			continue;
+		}
+		const GraphNode& n = graph[id];
+		for (int e = n.firstEdge; e < n.firstEdge + n.edgeCount; ++e) {
+			relax(graphEdges[e].to, id, e, g + graphEdges[e].cost);
+		}
+		if (n.partner >= 0) {
+			relax(n.partner, id, -1, g + 1.0f);
+		}
+		if (n.cluster == goalCluster && s.goalDistance[id - goalFirst] >= 0.0f) {
+			relax(goalNode, id, -1, g + s.goalDistance[id - goalFirst]);
+		}
+	}
+	s.expanded = a.expanded;
+	if (!found) {
+		return false;
+	}
+	//Walked back from the goal, each node with the edge that reached it
+	for (int id = goalNode; id >= 0; id = a.parent[id]) {
+		int cell = id == startNode ? startCell : (id == goalNode ? goalCell : graph[id].cell);
+		int edge = id == startNode ? -1 : s.parentEdge[id];
+		if (!outPath.cells.empty() && outPath.cells.back() == cell) { //corner entrances can share a node
+			outPath.edges.back() = edge;
+			continue;
+		}
+		outPath.cells.emplace_back(cell);
+		outPath.edges.emplace_back(edge);
+	}
+	outPath.edges.pop_back(); //nothing leads to the start
+	std::reverse(outPath.cells.begin(), outPath.cells.end());
+	std::reverse(outPath.edges.begin(), outPath.edges.end());
+	outPath.version = version;
+	return true;
+}
+
+//A leg along a stored edge just follows its steps. The rest stay inside
+//one cluster, or step across a border, so are filled in with an A* that
+//doesn't leave the cluster.
+bool HierarchicalGrid::RefineLeg(int fromCell, int toCell, int edge, std::vector<int>& out, HierarchicalScratch& s) const {
+	if (fromCell == toCell) {
+		return true;
+	}
+	int gridWidth = grid.GetGridWidth();
+	if (edge >= 0) {
+		const Edge& e	= graphEdges[edge];
+		int cell		= fromCell;
+		for (int i = e.firstMove; i < e.firstMove + e.moveCount; ++i) {
+			const int* step = STEPS[graphMoves[i]];
+			cell += step[1] * gridWidth + step[0];
+			out.emplace_back(cell);
+		}
+		return true;
+	}
+	if (WalkDirect(fromCell, toCell, out)) {
+		return true;
+	}
+	int cluster = ClusterAt(fromCell % gridWidth, fromCell / gridWidth);
+	const Cluster& c = clusters[cluster];
+	if (SearchClusterTo(cluster, fromCell, toCell, s) < 0) {
+		return false; //the grid must have changed since the route was found
+	}
+	int toLocal = (toCell / gridWidth - c.y) * c.width + (toCell % gridWidth - c.x);
+	size_t first = out.size();
+	for (int local = toLocal; s.localParent[local] >= 0; local = s.localParent[local]) {
+		out.emplace_back((local / c.width + c.y) * gridWidth + local % c.width + c.x);
+	}
+	std::reverse(out.begin() + first, out.end());
+	return true;
+}
+
+//Tries the most direct way there first, stepping along whichever axis
+//is furthest behind the line between the two. That's as short as any
+//4-way path can be, so on open ground there's nothing to search for.
+bool HierarchicalGrid::WalkDirect(int fromCell, int toCell, std::vector<int>& out) const {
+	int gridWidth	= grid.GetGridWidth();
+	int x			= fromCell % gridWidth;
+	int y			= fromCell / gridWidth;
+	int toX			= toCell % gridWidth;
+	int toY			= toCell / gridWidth;
+	int stepX		= toX > x ? 1 : -1;
+	int stepY		= toY > y ? 1 : -1;
+	int dx			= std::abs(toX - x);
+	int dy			= std::abs(toY - y);
+
+	size_t first = out.size();
+	for (int movedX = 0, movedY = 0; movedX < dx || movedY < dy; ) {
+		if (movedY == dy || (movedX < dx && (2 * movedX + 1) * dy < (2 * movedY + 1) * dx)) {
+			x += stepX;
+			movedX++;
+		}
+		else {
+			y += stepY;
+			movedY++;
+		}
+		if (!grid.IsWalkable(x, y)) {
+			out.resize(first);
+			return false;
+		}
+		out.emplace_back(y * gridWidth + x);
+	}
+	return true;
+}
+
+bool HierarchicalGrid::RefineNextLeg(HierarchicalPath& path, NavigationPath& outPath, HierarchicalScratch& s) const {
+	if (path.IsFinished()) {
+		return false;
+	}
+	PrepareScratch(s);
+	s.cells.clear();
+	if (path.nextLeg == 0) {
+		s.cells.emplace_back(path.cells[0]);
+	}
+	//If the graph has been rebuilt since, the stored edge may be gone
+	int edge		= path.version == version ? path.edges[path.nextLeg] : -1;
+	bool refined	= RefineLeg(path.cells[path.nextLeg], path.cells[path.nextLeg + 1], edge, s.cells, s);
+	path.nextLeg++;
+	if (!refined) {
+		return false;
+	}
+	outPath.Clear();
+	for (auto i = s.cells.rbegin(); i != s.cells.rend(); ++i) {
+		outPath.PushWaypoint(grid.GetNodePosition(*i));
+	}
+	return true;
+}
+
+bool HierarchicalGrid::FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) {
+	return FindPath(from, to, outPath, scratch);
+}
+
+bool HierarchicalGrid::FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath, HierarchicalScratch& s) const {
+	HierarchicalPath route;
+	if (!FindAbstractPath(from, to, route, s)) {
+		return false;
+	}
+	s.cells.clear();
+	s.cells.emplace_back(route.cells[0]);
+	for (int i = 0; i + 1 < (int)route.cells.size(); ++i) {
+		if (!RefineLeg(route.cells[i], route.cells[i + 1], route.edges[i], s.cells, s)) {
+			return false;
+		}
+	}
+	for (auto i = s.cells.rbegin(); i != s.cells.rend(); ++i) {
+		outPath.PushWaypoint(grid.GetNodePosition(*i)); // build up the path from the end
+	}
+	return true;
+}
+
+int HierarchicalGrid::GetAbstractEdgeCount() const {
+	int count = (int)graphEdges.size();
+	for (const GraphNode& n : graph) {
+		count += n.partner >= 0 ? 1 : 0;
+	}
+	return count;
+}
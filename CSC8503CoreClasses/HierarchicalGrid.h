@@ -0,0 +1,215 @@
+#pragma once
+#include "NavigationGrid.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		//A route across the abstract graph - the start, each entrance passed
+		//through and the goal - that can be turned into nodes a leg at a
+		//time as it's followed, rather than all up front
+		class HierarchicalPath {
+		public:
+			HierarchicalPath() {}
+			~HierarchicalPath() {}
+
+			void Clear() {
+				cells.clear();
+				edges.clear();
+				nextLeg = 0;
+			}
+
+			bool IsFinished() const {
+				return nextLeg + 1 >= (int)cells.size();
+			}
+
+			int GetLegCount() const {
+				return std::max(0, (int)cells.size() - 1);
+			}
+
+		protected:
+			friend class HierarchicalGrid;
+
+			std::vector<int>	cells;	//grid node indices
+			std::vector<int>	edges;	//the stored edge each leg follows, or -1 where it has to be searched for
+			int					nextLeg = 0;
+			int					version = -1; //of the graph it was found on, as the edges only mean anything there
+		};
+
+		//Working state for one query, so queries can run side by side
+		struct HierarchicalScratch {
+			GridSearchScratch	abstract;
+
+			//Searches inside one cluster, indexed locally
+			std::vector<int>		localDistance;
+			std::vector<int>		localParent;
+			std::vector<uint32_t>	localSeen;
+			std::vector<int>		localQueue;
+			NodeHeap				localOpen;
+			uint32_t				localGeneration = 0;
+
+			std::vector<std::pair<int, float>>	startEdges;		//abstract node, cost from the start
+			std::vector<float>					goalDistance;	//per node in the goal's cluster, or -1
+
+			std::vector<int> parentEdge;	//the edge each abstract node was reached by, or -1
+			std::vector<int> cells;
+
+			int expanded = 0; //abstract nodes taken off the open list, last query
+		};
+
+		/*
+		HPA* over a NavigationGrid. The grid is cut into square clusters,
+		and wherever two neighbouring clusters share an open stretch of
+		border, an entrance is placed in the middle of it. The entrances of
+		a cluster are linked by how far apart they are without leaving it,
+		so a long query is a search over a few entrances per cluster
+		rather than every node.
+
+		Each link also keeps the steps it was measured along, so filling a
+		route back in is a matter of following them - only the legs from
+		the start and to the goal need searching for. Every cluster's open
+		nodes are also labelled by which of its separate areas they're in,
+		so the start and goal can be linked to the entrances they're able
+		to reach without searching the cluster at all. How far away those
+		entrances are is estimated rather than measured, which only costs
+		anything when a wall inside the start or goal cluster is in the way.
+
+		The entrances a cluster gets are worked out the same way from the
+		tiles every time, so when a tile changes only the cluster it's in
+		(and the one across the border, if it's on one) are rebuilt.
+
+		Moves are 4-way, whatever the grid is set to, and both ends of a
+		query have to be on open nodes.
+
+		Clusters are 64 nodes across by default. Smaller ones make the
+		abstract graph bigger, and every query slower for it, while bigger
+		ones make the start and goal slower to connect and tile changes
+		slower to rebuild.
+		*/
+		class HierarchicalGrid : public NavigationMap {
+		public:
+			HierarchicalGrid(NavigationGrid& grid, int clusterSize = 64);
+			~HierarchicalGrid();
+
+			//Rebuilds everything, after the grid has changed a lot
+			void Build();
+
+			//Changes a tile through here, instead of on the grid, and only
+			//the clusters it touches are rebuilt. A door opening or closing
+			//is a tile going between floor and wall.
+			void SetTileType(int x, int y, char type);
+
+			bool FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) override;
+			bool FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath, HierarchicalScratch& scratch) const;
+
+			//Just the abstract route, for refining leg by leg with RefineNextLeg
+			bool FindAbstractPath(const Vector3& from, const Vector3& to, HierarchicalPath& outPath, HierarchicalScratch& scratch) const;
+
+			//Fills outPath with the nodes of the next leg of the route.
+			//Returns false once there are no legs left.
+			bool RefineNextLeg(HierarchicalPath& path, NavigationPath& outPath, HierarchicalScratch& scratch) const;
+
+			int GetClusterSize() const {
+				return clusterSize;
+			}
+
+			int GetClusterCount() const {
+				return clustersWide * clustersHigh;
+			}
+
+			int GetAbstractNodeCount() const {
+				return (int)graph.size();
+			}
+
+			int GetAbstractEdgeCount() const;
+
+			int GetLastExpandedCount() const {
+				return scratch.expanded;
+			}
+
+		protected:
+			struct Edge {
+				int		to;
+				float	cost;
+				int		firstMove;	//the steps along it, in moves
+				int		moveCount;
+			};
+
+			//As each cluster builds them. Edges and partners are by index
+			//into a cluster's nodes, as the IDs of the whole graph can
+			//shift whenever any cluster is rebuilt.
+			struct AbstractNode {
+				int					cell;
+				int					border;		//which side of its cluster it's on
+				int					partner;	//the node across the border, or -1
+				std::vector<Edge>	edges;		//to the other nodes of the same cluster
+			};
+
+			struct Cluster {
+				int x, y, width, height;
+				std::vector<AbstractNode>	nodes;
+				std::vector<uint8_t>		moves;	//one direction per step, for all of the edges
+			};
+
+			//What's searched - every cluster's nodes end to end, with the
+			//edges and steps gathered up the same way
+			struct GraphNode {
+				int cell;
+				int x, y;
+				int cluster;
+				int partner;
+				int firstEdge;
+				int edgeCount;
+			};
+
+			int	ClusterAt(int x, int y) const {
+				return (y / clusterSize) * clustersWide + (x / clusterSize);
+			}
+
+			int ClusterAcross(int cluster, int border) const;
+
+			int NodeID(int cluster, int index) const {
+				return firstNode[cluster] + index;
+			}
+
+			void LabelAreas(int cluster);
+			void BuildEntrances(int cluster);
+			void AddBorderEntrances(Cluster& c, int border);
+			void LinkPartners(int cluster);
+			void BuildIntraEdges(int cluster, HierarchicalScratch& scratch);
+			void BuildGraph();
+
+			//Breadth first from a node over the whole of one cluster, leaving
+			//distances and parents in the scratch
+			void SearchCluster(int cluster, int fromCell, HierarchicalScratch& scratch) const;
+
+			//A* between two nodes without leaving the cluster. Leaves the
+			//route in the scratch's parents, and returns its length, or -1.
+			int SearchClusterTo(int cluster, int fromCell, int toCell, HierarchicalScratch& scratch) const;
+			bool RefineLeg(int fromCell, int toCell, int edge, std::vector<int>& out, HierarchicalScratch& scratch) const;
+			bool WalkDirect(int fromCell, int toCell, std::vector<int>& out) const;
+
+			float Heuristic(int cell, int goalCell) const;
+
+			void PrepareScratch(HierarchicalScratch& scratch) const;
+
+			NavigationGrid& grid;
+
+			int clusterSize;
+			int clustersWide;
+			int clustersHigh;
+
+			std::vector<Cluster> clusters;
+
+			//Per grid node, which open area of its cluster it's in. Two nodes
+			//of a cluster can reach each other inside it if these match.
+			std::vector<uint16_t>	areas;
+
+			std::vector<int>		firstNode;	//per cluster
+			std::vector<GraphNode>	graph;
+			std::vector<Edge>		graphEdges;	//to graph nodes, with moves into graphMoves
+			std::vector<uint8_t>	graphMoves;
+			int						version;	//bumped every time the graph is put back together
+
+			HierarchicalScratch scratch; //for builds, and the NavigationMap FindPath
+		};
+	}
+}
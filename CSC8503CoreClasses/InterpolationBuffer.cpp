@@ -0,0 +1,188 @@
+#include "InterpolationBuffer.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	//Quaternion::Slerp doesn't take the short way round, or cope with nearly
+	//identical rotations, both of which happen every frame here
+	Quaternion ShortestSlerp(const Quaternion& from, const Quaternion& to, float t) {
+		Quaternion target = to;
+		float dot = Quaternion::Dot(from, to);
+		if (dot < 0.0f) {
+			target	= -to;
+			dot		= -dot;
+		}
+		if (dot > 0.9995f) {
+			Quaternion q = from + (target - from) * t;
+			q.Normalise();
+			return q;
+		}
+		return Quaternion::Slerp(from, target, t);
+	}
+
+	Vector3 Hermite(const Vector3& p0, const Vector3& m0, const Vector3& p1, const Vector3& m1, float t) {
+		float t2 = t * t;
+		float t3 = t2 * t;
+
+		float h00 = 2.0f * t3 - 3.0f * t2 + 1.0f;
+		float h10 = t3 - 2.0f * t2 + t;
+		float h01 = -2.0f * t3 + 3.0f * t2;
+		float h11 = t3 - t2;
+
+		return p0 * h00 + m0 * h10 + p1 * h01 + m1 * h11;
+	}
+}
+
+InterpolationBuffer::InterpolationBuffer() {
+	minDelay			= 0.05f;
+	maxDelay			= 0.5f;
+	maxExtrapolation	= 0.25f;
+	Reset();
+}
+
+void InterpolationBuffer::Reset() {
+	head				= 0;
+	count				= 0;
+	localTime			= 0.0f;
+	transitTime			= 0.0f;
+	jitter				= 0.0f;
+	snapshotInterval	= 0.0f;
+	playoutDelay		= minDelay;
+	targetDelay			= minDelay;
+	extrapolating		= false;
+}
+
+bool InterpolationBuffer::AddSnapshot(const Vector3& position, const Quaternion& orientation, float serverTime) {
+	Snapshot s;
+	s.position		= position;
+	s.orientation	= orientation;
+	s.serverTime	= serverTime;
+	s.arrivalTime	= localTime;
+
+	float transit = s.arrivalTime - s.serverTime;
+
+	if (count == 0) {
+		transitTime = transit;
+	}
+	else {
+		const Snapshot& newest = GetSnapshot(count - 1);
+		if (serverTime <= newest.serverTime) {
+			return false; //stale or duplicate, we've already moved past it
+		}
+		float serverDelta	= s.serverTime - newest.serverTime;
+		float arrivalDelta	= s.arrivalTime - newest.arrivalTime;
+
+		jitter += (std::abs(arrivalDelta - serverDelta) - jitter) / 16.0f;
+
+		if (snapshotInterval == 0.0f) {
+			snapshotInterval = serverDelta;
+		}
+		else {
+			snapshotInterval += (serverDelta - snapshotInterval) * 0.125f;
+		}
+		//Track the fastest packet we've seen, but let it creep back up slowly
+		//so clock drift or a route change doesn't leave us stuck
+		if (transit < transitTime) {
+			transitTime = transit;
+		}
+		else {
+			transitTime += (transit - transitTime) * 0.01f;
+		}
+	}
+
+	if (count == MAX_SNAPSHOTS) {
+		head = (head + 1) % MAX_SNAPSHOTS;
+		count--;
+	}
+	snapshots[(head + count) % MAX_SNAPSHOTS] = s;
+	count++;
+
+	UpdateTargetDelay();
+	if (count == 2) {
+		playoutDelay = targetDelay; //nothing on screen yet, so no need to ease in
+	}
+	return true;
+}
+
+void InterpolationBuffer::UpdateTargetDelay() {
+	//Enough to always have the next snapshot in hand, plus a margin for
+	//packets turning up late
+	targetDelay = std::clamp(snapshotInterval + jitter * 3.0f, minDelay, maxDelay);
+}
+
+bool InterpolationBuffer::Update(float dt, Vector3& outPosition, Quaternion& outOrientation) {
+	localTime += dt;
+
+	//Ease towards the new delay by speeding up or slowing down playback a
+	//little, rather than jumping the object backwards or forwards
+	float maxChange = dt * 0.1f;
+	playoutDelay += std::clamp(targetDelay - playoutDelay, -maxChange, maxChange);
+
+	float renderTime = GetRenderTime();
+
+	//Keep one snapshot behind the current segment for the tangent
+	while (count > 3 && GetSnapshot(2).serverTime <= renderTime) {
+		head = (head + 1) % MAX_SNAPSHOTS;
+		count--;
+	}
+	return Sample(renderTime, outPosition, outOrientation);
+}
+
+bool InterpolationBuffer::Sample(float atServerTime, Vector3& outPosition, Quaternion& outOrientation) const {
+	extrapolating = false;
+	if (count == 0) {
+		return false;
+	}
+	const Snapshot& oldest = GetSnapshot(0);
+	const Snapshot& newest = GetSnapshot(count - 1);
+
+	if (count == 1 || atServerTime <= oldest.serverTime) {
+		const Snapshot& s = (count == 1) ? newest : oldest;
+		outPosition		= s.position;
+		outOrientation	= s.orientation;
+		return true;
+	}
+
+	if (atServerTime >= newest.serverTime) {
+		//We've run out of data - carry on along the last known velocity for a
+		//little while, then hold position until the stream recovers
+		const Snapshot& prev = GetSnapshot(count - 2);
+		float span	= newest.serverTime - prev.serverTime;
+		float ahead = std::min(atServerTime - newest.serverTime, maxExtrapolation);
+
+		Vector3 velocity = (newest.position - prev.position) / span;
+
+		outPosition		= newest.position + velocity * ahead;
+		outOrientation	= ShortestSlerp(prev.orientation, newest.orientation, 1.0f + (ahead / span));
+		extrapolating	= ahead > 0.0f;
+		return true;
+	}
+
+	int i = count - 2;
+	while (i > 0 && GetSnapshot(i).serverTime > atServerTime) {
+		--i;
+	}
+	const Snapshot& a = GetSnapshot(i);
+	const Snapshot& b = GetSnapshot(i + 1);
+
+	float span	= b.serverTime - a.serverTime;
+	float t		= (atServerTime - a.serverTime) / span;
+
+	//Catmull-Rom style tangents from the neighbouring snapshots, falling back
+	//to the segment itself at either end of the buffer
+	Vector3 velA = (b.position - a.position) / span;
+	Vector3 velB = velA;
+	if (i > 0) {
+		const Snapshot& before = GetSnapshot(i - 1);
+		velA = (b.position - before.position) / (b.serverTime - before.serverTime);
+	}
+	if (i + 2 < count) {
+		const Snapshot& after = GetSnapshot(i + 2);
+		velB = (after.position - a.position) / (after.serverTime - a.serverTime);
+	}
+
+	outPosition		= Hermite(a.position, velA * span, b.position, velB * span, t);
+	outOrientation	= ShortestSlerp(a.orientation, b.orientation, t);
+	return true;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "Vector.h"
+#include "Quaternion.h"
+
+namespace NCL::CSC8503 {
+	using namespace NCL::Maths;
+
+	/*
+	Holds the last few snapshots received for a networked object, stamped with
+	the server time they were written at, and plays them back a little behind
+	the newest one so there's always a pair to interpolate between.
+
+	The playout delay adapts to the measured arrival jitter (RFC 3550 style),
+	and short gaps in the stream are covered by extrapolating from the last
+	two snapshots.
+	*/
+	class InterpolationBuffer {
+	public:
+		struct Snapshot {
+			Vector3		position;
+			Quaternion	orientation;
+			float		serverTime	= 0.0f;	//server clock when the state was written
+			float		arrivalTime = 0.0f;	//local clock when we received it
+		};
+
+		InterpolationBuffer();
+		~InterpolationBuffer() {}
+
+		void Reset();
+
+		//Returns false if the snapshot is older than one we already have
+		bool AddSnapshot(const Vector3& position, const Quaternion& orientation, float serverTime);
+
+		//Advances the local clock and samples the buffer at the current playout time
+		bool Update(float dt, Vector3& outPosition, Quaternion& outOrientation);
+
+		bool Sample(float atServerTime, Vector3& outPosition, Quaternion& outOrientation) const;
+
+		void SetMaxExtrapolation(float seconds) {
+			maxExtrapolation = seconds;
+		}
+
+		void SetDelayLimits(float minSeconds, float maxSeconds) {
+			minDelay = minSeconds;
+			maxDelay = maxSeconds;
+		}
+
+		//How far behind the newest snapshot we are currently rendering
+		float GetPlayoutDelay() const {
+			return playoutDelay;
+		}
+
+		float GetJitter() const {
+			return jitter;
+		}
+
+		float GetSnapshotInterval() const {
+			return snapshotInterval;
+		}
+
+		//The point on the server's timeline that is currently being displayed
+		float GetRenderTime() const {
+			return localTime - transitTime - playoutDelay;
+		}
+
+		int GetSnapshotCount() const {
+			return count;
+		}
+
+		bool IsExtrapolating() const {
+			return extrapolating;
+		}
+
+		static const int MAX_SNAPSHOTS = 32;
+
+	protected:
+		const Snapshot& GetSnapshot(int index) const {
+			return snapshots[(head + index) % MAX_SNAPSHOTS];
+		}
+
+		void UpdateTargetDelay();
+
+		Snapshot snapshots[MAX_SNAPSHOTS];
+		int		head;	//oldest snapshot
+		int		count;
+
+		float	localTime;
+		float	transitTime;		//smallest seen arrival - server time, includes clock offset
+		float	jitter;
+		float	snapshotInterval;	//smoothed server time between snapshots
+
+		float	playoutDelay;
+		float	targetDelay;
+		float	minDelay;
+		float	maxDelay;
+		float	maxExtrapolation;
+
+		mutable bool extrapolating;
+	};
+}
@@ -0,0 +1,215 @@
+#include "LagCompensator.h"
+#include "GameWorld.h"
+#include "GameObject.h"
+#include "PhysicsObject.h"
+#include "CollisionDetection.h"
+#include "CapsuleVolume.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	//The broadphase AABB isn't filled in for every volume type, so fall back
+	//to something that's at least big enough to contain the object
+	Vector3 GetRecordedSize(GameObject& o) {
+		const CollisionVolume* volume = o.GetBoundingVolume();
+		if (volume->type == VolumeType::Capsule) {
+			const CapsuleVolume& capsule = (const CapsuleVolume&)*volume;
+			float r = capsule.GetHalfHeight() + capsule.GetRadius();
+			return Vector3(r, r, r);
+		}
+		o.UpdateBroadphaseAABB();
+		Vector3 size;
+		o.GetBroadphaseAABB(size);
+		return size;
+	}
+}
+
+LagCompensator::LagCompensator(GameWorld& world, int historySize) : world(world), historySize(historySize) {
+	worldState	= -1;
+	head		= 0;
+	frameCount	= 0;
+	maxRewind	= 0.5f;
+	frameTimes.resize(historySize);
+}
+
+void LagCompensator::Reset() {
+	tracked.clear();
+	trackedLookup.clear();
+	head		= 0;
+	frameCount	= 0;
+	worldState	= -1;
+}
+
+void LagCompensator::RebuildTracked() {
+	tracked.clear();
+	trackedLookup.clear();
+
+	GameObjectIterator first;
+	GameObjectIterator last;
+	world.GetObjectIterators(first, last);
+
+	for (auto i = first; i != last; ++i) {
+		GameObject* o = *i;
+		if (!o->GetBoundingVolume() || !o->GetPhysicsObject() || o->GetPhysicsObject()->GetInverseMass() == 0.0f) {
+			continue;
+		}
+		int id = o->GetWorldID();
+		if (id >= (int)trackedLookup.size()) {
+			trackedLookup.resize(id + 1, -1);
+		}
+		trackedLookup[id] = (int)tracked.size();
+		tracked.emplace_back(o);
+	}
+	size_t samples = tracked.size() * historySize;
+	positions.resize(samples);
+	orientations.resize(samples);
+	broadphaseSizes.resize(samples);
+
+	//The old frames don't line up with the new object list any more
+	head		= 0;
+	frameCount	= 0;
+	worldState	= world.GetWorldStateID();
+}
+
+void LagCompensator::RecordFrame(float serverTime) {
+	if (world.GetWorldStateID() != worldState) {
+		RebuildTracked();
+	}
+	int frame;
+	if (frameCount < historySize) {
+		frame = (head + frameCount) % historySize;
+		frameCount++;
+	}
+	else {
+		frame	= head;
+		head	= (head + 1) % historySize;
+	}
+	frameTimes[frame] = serverTime;
+
+	for (int i = 0; i < (int)tracked.size(); ++i) {
+		GameObject& o	= *tracked[i];
+		int index		= SampleIndex(frame, i);
+
+		positions[index]		= o.GetTransform().GetPosition();
+		orientations[index]		= o.GetTransform().GetOrientation();
+		broadphaseSizes[index]	= GetRecordedSize(o);
+	}
+}
+
+float LagCompensator::GetNewestTime() const {
+	return frameCount > 0 ? frameTimes[(head + frameCount - 1) % historySize] : 0.0f;
+}
+
+float LagCompensator::GetOldestTime() const {
+	return frameCount > 0 ? frameTimes[head] : 0.0f;
+}
+
+bool LagCompensator::FindFrames(float time, int& frameA, int& frameB, float& t) const {
+	if (frameCount == 0) {
+		return false;
+	}
+	int newest = (head + frameCount - 1) % historySize;
+	if (time >= frameTimes[newest]) {
+		return false; //nothing to rewind, the world as it is now will do
+	}
+	if (time <= frameTimes[head]) {
+		frameA	= head;
+		frameB	= head;
+		t		= 0.0f;
+		return true;
+	}
+	//Most requests are for the last few ticks, so search back from the newest
+	for (int i = frameCount - 2; i >= 0; --i) {
+		int a = (head + i) % historySize;
+		if (frameTimes[a] <= time) {
+			frameA	= a;
+			frameB	= (a + 1) % historySize;
+			t		= (time - frameTimes[a]) / (frameTimes[frameB] - frameTimes[a]);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool LagCompensator::Raycast(const Ray& r, float viewTime, RayCollision& closestCollision, GameObject* ignoreThis, LayerMask layermask) {
+	if (world.GetWorldStateID() != worldState) {
+		RebuildTracked(); //our indices are stale, so all we can offer is the present
+	}
+	viewTime = std::max(viewTime, GetNewestTime() - maxRewind);
+
+	int		frameA	= 0;
+	int		frameB	= 0;
+	float	t		= 0.0f;
+	bool	rewind	= FindFrames(viewTime, frameA, frameB, t);
+
+	RayCollision collision;
+
+	GameObjectIterator first;
+	GameObjectIterator last;
+	world.GetObjectIterators(first, last);
+
+	for (auto i = first; i != last; ++i) {
+		GameObject* o = *i;
+		if (!o->GetBoundingVolume() || o == ignoreThis) {
+			continue;
+		}
+		if ((1 << static_cast<int>(o->GetLayer()) & layermask) == 0) {
+			continue;
+		}
+		int id		= o->GetWorldID();
+		int index	= (rewind && id < (int)trackedLookup.size()) ? trackedLookup[id] : -1;
+
+		RayCollision thisCollision;
+		if (index < 0) {
+			if (!CollisionDetection::RayIntersection(r, *o, thisCollision)) {
+				continue;
+			}
+		}
+		else {
+			int a = SampleIndex(frameA, index);
+			int b = SampleIndex(frameB, index);
+
+			Vector3 pastPosition = positions[a] + (positions[b] - positions[a]) * t;
+			Vector3 pastSize;
+			for (int j = 0; j < 3; ++j) {
+				pastSize[j] = std::max(broadphaseSizes[a][j], broadphaseSizes[b][j]);
+			}
+
+			//Cheap test against the recorded box first, and skip anything
+			//that can't beat what we've already hit
+			RayCollision boxCollision;
+			if (!CollisionDetection::RayBoxIntersection(r, pastPosition, pastSize, boxCollision) ||
+				boxCollision.rayDistance >= collision.rayDistance) {
+				continue;
+			}
+			Quaternion pastOrientation = Quaternion::Lerp(orientations[a], orientations[b], t);
+			pastOrientation.Normalise();
+
+			//Only the objects that get this far are moved back, and only
+			//for the length of the narrow phase test
+			Transform& transform		= o->GetTransform();
+			Vector3 presentPosition		= transform.GetPosition();
+			Quaternion presentOrientation = transform.GetOrientation();
+
+			transform.SetPosition(pastPosition);
+			transform.SetOrientation(pastOrientation);
+			bool hit = CollisionDetection::RayIntersection(r, *o, thisCollision);
+			transform.SetPosition(presentPosition);
+			transform.SetOrientation(presentOrientation);
+
+			if (!hit) {
+				continue;
+			}
+		}
+		if (thisCollision.rayDistance < collision.rayDistance) {
+			thisCollision.node	= o;
+			collision			= thisCollision;
+		}
+	}
+	if (collision.node) {
+		closestCollision = collision;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "Ray.h"
+#include "Layer.h"
+
+namespace NCL::CSC8503 {
+	using namespace NCL::Maths;
+
+	class GameWorld;
+	class GameObject;
+
+	/*
+	Keeps a short history of where every moving object was on the server, so
+	a raycast from a client can be tested against the world as that client
+	actually saw it, rather than where things have moved to since.
+
+	Only objects with a finite mass are recorded - everything else can't
+	move, so its current transform is already correct for any past time.
+	The history is stored frame-major in flat arrays that are allocated once
+	for the tracked set, so recording a tick is just a few copies.
+	*/
+	class LagCompensator {
+	public:
+		LagCompensator(GameWorld& world, int historySize = 64);
+		~LagCompensator() {}
+
+		//Forgets every object and frame, call when the world is rebuilt
+		void Reset();
+
+		//Called once per server tick, stamped with the same time as the
+		//snapshots being sent out
+		void RecordFrame(float serverTime);
+
+		//As GameWorld::Raycast, but with moving objects put back to where
+		//they were at viewTime. Always returns the closest hit.
+		bool Raycast(const Ray& r, float viewTime, RayCollision& closestCollision, GameObject* ignore = nullptr, LayerMask layermask = DefaultLayerMask);
+
+		//Clients can't ask us to rewind further than this
+		void SetMaxRewind(float seconds) {
+			maxRewind = seconds;
+		}
+
+		float GetNewestTime() const;
+		float GetOldestTime() const;
+
+		int GetTrackedCount() const {
+			return (int)tracked.size();
+		}
+
+		int GetFrameCount() const {
+			return frameCount;
+		}
+
+	protected:
+		void RebuildTracked();
+
+		//Finds the pair of recorded frames either side of a time
+		bool FindFrames(float time, int& frameA, int& frameB, float& t) const;
+
+		int SampleIndex(int frame, int trackedIndex) const {
+			return frame * (int)tracked.size() + trackedIndex;
+		}
+
+		GameWorld&	world;
+		int			worldState;
+
+		std::vector<GameObject*>	tracked;
+		std::vector<int>			trackedLookup; //world ID -> tracked index, or -1
+
+		std::vector<float>		frameTimes;
+		std::vector<Vector3>	positions;
+		std::vector<Quaternion>	orientations;
+		std::vector<Vector3>	broadphaseSizes;
+
+		int		historySize;
+		int		head;		//oldest frame
+		int		frameCount;
+		float	maxRewind;
+	};
+}
@@ -0,0 +1,83 @@
+#include "LinkConditioner.h"
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+LinkConditioner::LinkConditioner(unsigned int seed) : random(seed) {
+	nextOrder	= 0;
+	heldCount	= 0;
+	lost		= 0;
+	reordered	= 0;
+}
+
+void LinkConditioner::SetDefaultSettings(const LinkSettings& s) {
+	std::lock_guard<std::mutex> lock(settingsLock);
+	defaultSettings = s;
+}
+
+void LinkConditioner::SetPeerSettings(int peerID, const LinkSettings& s) {
+	std::lock_guard<std::mutex> lock(settingsLock);
+	peerSettings[peerID] = s;
+}
+
+void LinkConditioner::ClearPeerSettings(int peerID) {
+	std::lock_guard<std::mutex> lock(settingsLock);
+	peerSettings.erase(peerID);
+}
+
+LinkSettings LinkConditioner::GetSettings(int peerID) {
+	std::lock_guard<std::mutex> lock(settingsLock);
+	auto i = peerSettings.find(peerID);
+	return i == peerSettings.end() ? defaultSettings : i->second;
+}
+
+bool LinkConditioner::Hold(_ENetPacket* packet, int peerID, int channel, bool reliable, double now) {
+	LinkSettings s = GetSettings(peerID);
+	std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+
+	double releaseTime = now + s.latency + (s.jitter > 0.0f ? chance(random) * s.jitter : 0.0f);
+
+	if (s.loss > 0.0f && chance(random) < s.loss) {
+		lost++;
+		if (!reliable) {
+			return false;
+		}
+		releaseTime += std::max(s.latency * 2.0f, 0.01f);
+	}
+	double& last = lastRelease[{ peerID, channel }];
+	if (!reliable && s.reorder > 0.0f && chance(random) < s.reorder) {
+		//Held back past whatever gets sent after it. It doesn't move the
+		//peer's ordering on, so later packets can overtake it.
+		releaseTime += std::max(s.jitter, 0.01f);
+		reordered++;
+	}
+	else {
+		releaseTime = std::max(releaseTime, last);
+		last		= releaseTime;
+	}
+	held.push_back({ releaseTime, nextOrder++, packet, peerID, channel });
+	std::push_heap(held.begin(), held.end());
+	heldCount = (int)held.size();
+	return true;
+}
+
+bool LinkConditioner::Release(double now, _ENetPacket*& packet, int& peerID, int& channel) {
+	if (held.empty() || held.front().releaseTime > now) {
+		return false;
+	}
+	return ReleaseAny(packet, peerID, channel);
+}
+
+bool LinkConditioner::ReleaseAny(_ENetPacket*& packet, int& peerID, int& channel) {
+	if (held.empty()) {
+		return false;
+	}
+	std::pop_heap(held.begin(), held.end());
+	packet	= held.back().packet;
+	peerID	= held.back().peerID;
+	channel = held.back().channel;
+	held.pop_back();
+	heldCount = (int)held.size();
+	return true;
+}
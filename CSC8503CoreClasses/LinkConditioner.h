@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <mutex>
+#include <random>
+#include <atomic>
+
+struct _ENetPacket;
+
+namespace NCL::CSC8503 {
+	//How bad a simulated connection should be. Times are in seconds.
+	struct LinkSettings {
+		float latency	= 0.0f;	//added to every packet
+		float jitter	= 0.0f;	//up to this much more, chosen per packet
+		float loss		= 0.0f;	//chance of a packet never arriving, 0 - 1
+		float reorder	= 0.0f;	//chance of a packet being held back behind later ones, 0 - 1
+
+		bool IsPerfect() const {
+			return latency <= 0.0f && jitter <= 0.0f && loss <= 0.0f && reorder <= 0.0f;
+		}
+	};
+
+	/*
+	Sits between a NetworkBase and enet, holding outgoing packets back to
+	make a loopback connection behave like a real one. Conditioning what
+	each end sends covers both directions, so there's no receive side.
+
+	Packets keep their order unless the reorder chance says otherwise, so
+	jitter on its own bunches packets up rather than shuffling them.
+	Reliable packets are never lost or reordered - a loss just holds them
+	back for a round trip, as if enet had had to resend them.
+
+	Settings can be given per peer, and anything without its own settings
+	(including broadcasts) uses the defaults. Held packets belong to
+	whichever thread is doing the sending, only the settings are shared.
+	*/
+	class LinkConditioner {
+	public:
+		LinkConditioner(unsigned int seed = 0);
+		~LinkConditioner() {}
+
+		void SetDefaultSettings(const LinkSettings& s);
+		void SetPeerSettings(int peerID, const LinkSettings& s);
+		void ClearPeerSettings(int peerID);
+
+		LinkSettings GetSettings(int peerID);
+
+		//Takes the packet, or returns false if it's been lost and the
+		//caller should destroy it
+		bool Hold(_ENetPacket* packet, int peerID, int channel, bool reliable, double now);
+
+		//Hands back the next packet that's due to be sent, if any
+		bool Release(double now, _ENetPacket*& packet, int& peerID, int& channel);
+
+		//Hands back held packets whether they're due or not, for shutdown
+		bool ReleaseAny(_ENetPacket*& packet, int& peerID, int& channel);
+
+		//Counters can be read from any thread
+		int GetHeldCount() const {
+			return heldCount;
+		}
+
+		int GetLostCount() const {
+			return lost;
+		}
+
+		int GetReorderedCount() const {
+			return reordered;
+		}
+
+	protected:
+		struct HeldPacket {
+			double			releaseTime;
+			unsigned int	order;		//breaks ties, so equal times stay in order
+			_ENetPacket*	packet;
+			int				peerID;
+			int				channel;
+
+			//Makes the packet due soonest sit at the top of the heap
+			bool operator<(const HeldPacket& other) const {
+				return releaseTime != other.releaseTime ? releaseTime > other.releaseTime : order > other.order;
+			}
+		};
+
+		std::mutex				settingsLock;
+		LinkSettings			defaultSettings;
+		std::map<int, LinkSettings> peerSettings;
+
+		std::vector<HeldPacket>	held;			//a min heap on release time
+		std::map<std::pair<int, int>, double> lastRelease; //per peer and channel, keeps ordered packets in order
+
+		std::mt19937	random;
+		unsigned int	nextOrder;
+		std::atomic<int> heldCount;
+		std::atomic<int> lost;
+		std::atomic<int> reordered;
+	};
+}
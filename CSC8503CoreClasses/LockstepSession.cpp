@@ -0,0 +1,110 @@
+#include "LockstepSession.h"
+#include "GameWorld.h"
+#include "GameObject.h"
+#include "PhysicsObject.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+LockstepSession::LockstepSession(int playerCount, int inputDelay) : playerCount(playerCount), inputDelay(inputDelay) {
+	nextTick		= 0;
+	desyncs			= 0;
+	firstDesyncTick = -1;
+
+	inputTicks.resize(WINDOW * playerCount, -1);
+	inputs.resize(WINDOW * playerCount * LOCKSTEP_BUTTONS, 0);
+	hashTicks.resize(WINDOW, -1);
+	hashes.resize(WINDOW, 0);
+}
+
+bool LockstepSession::SetInput(int tick, int slot, const char* buttons) {
+	if (slot < 0 || slot >= playerCount || tick < nextTick || tick >= nextTick + WINDOW) {
+		return false;
+	}
+	int index = InputIndex(tick, slot);
+	inputTicks[index] = tick;
+	memcpy(&inputs[index * LOCKSTEP_BUTTONS], buttons, LOCKSTEP_BUTTONS);
+	return true;
+}
+
+bool LockstepSession::HasInput(int tick, int slot) const {
+	return inputTicks[InputIndex(tick, slot)] == tick;
+}
+
+const char* LockstepSession::GetInput(int tick, int slot) const {
+	return &inputs[InputIndex(tick, slot) * LOCKSTEP_BUTTONS];
+}
+
+bool LockstepSession::IsNextTickReady() const {
+	int first = InputIndex(nextTick, 0);
+	for (int i = 0; i < playerCount; ++i) {
+		if (inputTicks[first + i] != nextTick) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void LockstepSession::AdvanceTick(uint32_t worldHash) {
+	hashTicks[nextTick % WINDOW]	= nextTick;
+	hashes[nextTick % WINDOW]		= worldHash;
+	nextTick++;
+}
+
+bool LockstepSession::GetHash(int tick, uint32_t& hash) const {
+	if (tick < 0 || hashTicks[tick % WINDOW] != tick) {
+		return false;
+	}
+	hash = hashes[tick % WINDOW];
+	return true;
+}
+
+bool LockstepSession::CheckHash(int tick, uint32_t hash) {
+	uint32_t ours;
+	if (!GetHash(tick, ours) || ours == hash) {
+		return true; //too old or not simulated yet, nothing to say
+	}
+	if (desyncs == 0) {
+		firstDesyncTick = tick;
+	}
+	desyncs++;
+	return false;
+}
+
+namespace {
+	void HashBytes(uint32_t& hash, const void* data, size_t length) {
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < length; ++i) {
+			hash ^= bytes[i];
+			hash *= 16777619u;
+		}
+	}
+}
+
+uint32_t LockstepSession::HashWorld(const GameWorld& world) {
+	uint32_t hash = 2166136261u;
+
+	GameObjectIterator first;
+	GameObjectIterator last;
+	world.GetObjectIterators(first, last);
+
+	for (auto i = first; i != last; ++i) {
+		GameObject* o = *i;
+		PhysicsObject* physics = o->GetPhysicsObject();
+		if (!physics) {
+			continue;
+		}
+		Vector3		position	= o->GetTransform().GetPosition();
+		Quaternion	orientation = o->GetTransform().GetOrientation();
+		Vector3		linear		= physics->GetLinearVelocity();
+		Vector3		angular		= physics->GetAngularVelocity();
+
+		int id = o->GetWorldID();
+		HashBytes(hash, &id, sizeof(id));
+		HashBytes(hash, &position, sizeof(position));
+		HashBytes(hash, &orientation, sizeof(orientation));
+		HashBytes(hash, &linear, sizeof(linear));
+		HashBytes(hash, &angular, sizeof(angular));
+	}
+	return hash;
+}
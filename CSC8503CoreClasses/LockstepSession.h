@@ -0,0 +1,153 @@
+#pragma once
+#include "NetworkBase.h"
+#include <vector>
+#include <cstdint>
+
+namespace NCL::CSC8503 {
+	class GameWorld;
+
+	static const int LOCKSTEP_MAX_PLAYERS	= 64;
+	static const int LOCKSTEP_BUTTONS		= 8;
+	static const int LOCKSTEP_WINDOW		= 256;	//ticks of input and hashes kept
+
+	struct LockstepStartPacket : public GamePacket {
+		int				slot		= -1;
+		int				playerCount = 0;
+		int				inputDelay	= 0;	//ticks between sampling an input and using it
+		int				objectCount = 0;	//the world is built from this and the seed
+		unsigned int	seed		= 0;
+
+		LockstepStartPacket() {
+			type = Lockstep_Start;
+			size = sizeof(LockstepStartPacket) - sizeof(GamePacket);
+		}
+
+		//Whether a received packet covers every field, with a player count
+		//and slot that fit the input tables and a delay inside the window
+		bool IsValid() const {
+			return size >= (short)(sizeof(LockstepStartPacket) - sizeof(GamePacket))
+				&& playerCount > 0 && playerCount <= LOCKSTEP_MAX_PLAYERS
+				&& slot >= 0 && slot < playerCount
+				&& inputDelay >= 0 && inputDelay < LOCKSTEP_WINDOW
+				&& objectCount >= 0;
+		}
+	};
+
+	struct LockstepInputPacket : public GamePacket {
+		int			tick		= -1;
+		char		buttons[LOCKSTEP_BUTTONS];
+		int			hashTick	= -1;	//the newest tick this client has simulated
+		uint32_t	hash		= 0;
+
+		LockstepInputPacket() {
+			type = Lockstep_Input;
+			size = sizeof(LockstepInputPacket) - sizeof(GamePacket);
+			memset(buttons, 0, sizeof(buttons));
+		}
+
+		bool IsValid() const {
+			return size >= (short)(sizeof(LockstepInputPacket) - sizeof(GamePacket));
+		}
+	};
+
+	//Only the buttons for the players in the game are sent, so the size
+	//is set from the player count rather than the whole array
+	struct LockstepTickPacket : public GamePacket {
+		int		tick		= -1;
+		int		playerCount = 0;
+		char	buttons[LOCKSTEP_MAX_PLAYERS][LOCKSTEP_BUTTONS];
+
+		LockstepTickPacket(int players = 0) {
+			type		= Lockstep_Tick;
+			playerCount = players;
+			size		= (short)(sizeof(int) * 2 + players * LOCKSTEP_BUTTONS);
+		}
+
+		//Whether a received packet's size, checked against the length,
+		//really holds the buttons for as many players as it says
+		bool IsValid() const {
+			return playerCount > 0 && playerCount <= LOCKSTEP_MAX_PLAYERS
+				&& size >= (short)(sizeof(int) * 2 + playerCount * LOCKSTEP_BUTTONS);
+		}
+	};
+
+	/*
+	The bookkeeping for lockstep networking, where only inputs go over the
+	network and every machine runs the same simulation from them. Each tick
+	can only be simulated once every player's input for it has turned up,
+	so inputs are sent a few ticks ahead to hide the latency.
+
+	Inputs are stored in a ring of ticks, slot-major within each tick, so
+	checking whether a tick is ready is a walk over one small block.
+
+	Each machine also records a hash of its world after every tick. When a
+	hash for the same tick comes in from somewhere else and doesn't match,
+	the simulations have desynced.
+	*/
+	class LockstepSession {
+	public:
+		static const int WINDOW = LOCKSTEP_WINDOW;
+
+		LockstepSession(int playerCount, int inputDelay);
+		~LockstepSession() {}
+
+		//Returns false if the tick is too far ahead or already simulated
+		bool SetInput(int tick, int slot, const char* buttons);
+		bool HasInput(int tick, int slot) const;
+		const char* GetInput(int tick, int slot) const;
+
+		//Every player's input for the next tick is here
+		bool IsNextTickReady() const;
+
+		int GetNextTick() const {
+			return nextTick;
+		}
+
+		//Call once the next tick has been simulated
+		void AdvanceTick(uint32_t worldHash);
+
+		//Compares against our own hash for that tick, if we still have it.
+		//Returns false on a desync.
+		bool CheckHash(int tick, uint32_t hash);
+
+		bool GetHash(int tick, uint32_t& hash) const;
+
+		int GetPlayerCount() const {
+			return playerCount;
+		}
+
+		int GetInputDelay() const {
+			return inputDelay;
+		}
+
+		int GetDesyncCount() const {
+			return desyncs;
+		}
+
+		int GetFirstDesyncTick() const {
+			return firstDesyncTick;
+		}
+
+		//FNV-1a over the transform and velocities of every physics object,
+		//in world order. Bit exact, so -0 and 0 hash differently.
+		static uint32_t HashWorld(const GameWorld& world);
+
+	protected:
+		int InputIndex(int tick, int slot) const {
+			return (tick % WINDOW) * playerCount + slot;
+		}
+
+		int playerCount;
+		int inputDelay;
+		int nextTick;
+
+		std::vector<int>	inputTicks;	//which tick each input slot currently holds
+		std::vector<char>	inputs;		//LOCKSTEP_BUTTONS per entry
+
+		std::vector<int>		hashTicks;
+		std::vector<uint32_t>	hashes;
+
+		int desyncs;
+		int firstDesyncTick;
+	};
+}
@@ -0,0 +1,99 @@
+#include "LockstepSimulation.h"
+#include "GameObject.h"
+#include "PhysicsObject.h"
+#include "PlayerMovement.h"
+#include "AABBVolume.h"
+#include "SphereVolume.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+LockstepSimulation::LockstepSimulation(int playerCount, unsigned int seed, int objectCount) {
+	world	= new GameWorld();
+	physics = new PhysicsSystem(*world);
+	physics->UseGravity(true);
+	physics->SetFixedTimestep(true);
+	world->SetRandomSeed(seed);
+
+	AddCube(Vector3(0, -2, 0), Vector3(200, 2, 200), 0.0f);
+
+	for (int i = 0; i < playerCount; ++i) {
+		GameObject* player = AddSphere(Vector3((i % 8) * 6.0f - 21.0f, 2.0f, (i / 8) * 6.0f - 40.0f), 1.0f, 0.5f);
+		players.emplace_back(player);
+	}
+	lastJump.resize(playerCount, 0);
+
+	//Integer maths only, so the layout can't differ between machines
+	std::mt19937 random(seed);
+	for (int i = 0; i < objectCount; ++i) {
+		Vector3 position(
+			(float)(int)(random() % 160) - 80.0f,
+			5.0f + (float)(int)(random() % 20),
+			(float)(int)(random() % 160) - 80.0f
+		);
+		if (i % 2) {
+			AddSphere(position, 1.0f, 1.0f);
+		}
+		else {
+			AddCube(position, Vector3(1, 1, 1), 1.0f);
+		}
+	}
+}
+
+LockstepSimulation::~LockstepSimulation() {
+	delete physics;
+	world->ClearAndErase();
+	delete world;
+}
+
+GameObject* LockstepSimulation::AddCube(const Vector3& position, const Vector3& halfSize, float inverseMass) {
+	GameObject* cube = new GameObject("cube");
+
+	cube->SetBoundingVolume((CollisionVolume*)new AABBVolume(halfSize));
+	cube->GetTransform()
+		.SetPosition(position)
+		.SetScale(halfSize * 2.0f);
+
+	cube->SetPhysicsObject(new PhysicsObject(&cube->GetTransform(), cube->GetBoundingVolume()));
+	cube->GetPhysicsObject()->SetInverseMass(inverseMass);
+	cube->GetPhysicsObject()->InitCubeInertia();
+
+	world->AddGameObject(cube);
+	return cube;
+}
+
+GameObject* LockstepSimulation::AddSphere(const Vector3& position, float radius, float inverseMass) {
+	GameObject* sphere = new GameObject("sphere");
+
+	sphere->SetBoundingVolume((CollisionVolume*)new SphereVolume(radius));
+	sphere->GetTransform()
+		.SetPosition(position)
+		.SetScale(Vector3(radius, radius, radius));
+
+	sphere->SetPhysicsObject(new PhysicsObject(&sphere->GetTransform(), sphere->GetBoundingVolume()));
+	sphere->GetPhysicsObject()->SetInverseMass(inverseMass);
+	sphere->GetPhysicsObject()->InitSphereInertia();
+
+	world->AddGameObject(sphere);
+	return sphere;
+}
+
+uint32_t LockstepSimulation::Step(LockstepSession& session) {
+	int tick = session.GetNextTick();
+	for (int slot = 0; slot < (int)players.size(); ++slot) {
+		PlayerInput input;
+		input.sequence = tick;
+		memcpy(input.buttons, session.GetInput(tick, slot), LOCKSTEP_BUTTONS);
+
+		bool jumpPressed = input.buttons[Button_Jump] && !lastJump[slot];
+		lastJump[slot] = input.buttons[Button_Jump];
+
+		PlayerMovement::ApplyInput(*players[slot], input, jumpPressed);
+	}
+	world->UpdateWorld(GetTickDT());
+	physics->FixedUpdate();
+
+	uint32_t hash = LockstepSession::HashWorld(*world);
+	session.AdvanceTick(hash);
+	return hash;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "GameWorld.h"
+#include "PhysicsSystem.h"
+#include "LockstepSession.h"
+
+namespace NCL::CSC8503 {
+	class GameObject;
+
+	/*
+	A small world that every machine in a lockstep game builds from the
+	same seed and steps from the same inputs. Nothing in here reads the
+	clock or the keyboard, and physics only ever takes whole fixed steps,
+	so the same build on any machine ends up in the same place - which
+	the session's state hashes then confirm.
+
+	The level is a floor, one sphere per player and a scattering of
+	crates and balls, so the number of objects can be raised without
+	changing what goes over the network.
+
+	That only holds while every machine runs the same compiled code with
+	the same float rounding - NCLCoreClasses is built with precise
+	floating point and no fused multiply-adds for this, and mixing builds
+	or compilers in one game isn't supported. The hashes will say so if it's tried.
+	*/
+	class LockstepSimulation {
+	public:
+		LockstepSimulation(int playerCount, unsigned int seed, int objectCount);
+		~LockstepSimulation();
+
+		//Applies everyone's input for the session's next tick, steps the
+		//world once and moves the session on. Returns the new state hash.
+		uint32_t Step(LockstepSession& session);
+
+		GameWorld& GetWorld() {
+			return *world;
+		}
+
+		PhysicsSystem& GetPhysics() {
+			return *physics;
+		}
+
+		GameObject* GetPlayer(int slot) const {
+			return players[slot];
+		}
+
+		static float GetTickDT() {
+			return PhysicsSystem::GetFixedDT();
+		}
+
+	protected:
+		GameObject* AddCube(const Vector3& position, const Vector3& halfSize, float inverseMass);
+		GameObject* AddSphere(const Vector3& position, float radius, float inverseMass);
+
+		GameWorld*		world;
+		PhysicsSystem*	physics;
+
+		std::vector<GameObject*>	players;
+		std::vector<char>			lastJump; //per slot, so held jumps only fire once
+	};
+}
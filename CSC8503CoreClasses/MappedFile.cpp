@@ -0,0 +1,198 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace NCL;
+using namespace CSC8503;
+
+MappedFile::MappedFile() {
+	data		= nullptr;
+	mappedSize	= 0;
+	writable	= false;
+#ifdef _WIN32
+	fileHandle		= INVALID_HANDLE_VALUE;
+	mappingHandle	= nullptr;
+#else
+	fileHandle		= -1;
+#endif
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+#ifdef _WIN32
+bool MappedFile::OpenRead(const std::string& filename) {
+	Close();
+	fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(fileHandle, &size) || size.QuadPart == 0) {
+		Close();
+		return false;
+	}
+	writable = false;
+	if (!Map((size_t)size.QuadPart)) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool MappedFile::OpenWrite(const std::string& filename, size_t initialSize) {
+	Close();
+	fileHandle = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	writable = true;
+	if (!Map(initialSize)) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+//Creating a mapping bigger than a writable file extends the file to match
+bool MappedFile::Map(size_t size) {
+	DWORD protect	= writable ? PAGE_READWRITE : PAGE_WRITECOPY;
+	DWORD access	= writable ? FILE_MAP_WRITE : FILE_MAP_COPY;
+
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, protect, (DWORD)((unsigned long long)size >> 32), (DWORD)(size & 0xFFFFFFFF), nullptr);
+	if (!mappingHandle) {
+		return false;
+	}
+	data = (char*)MapViewOfFile(mappingHandle, access, 0, 0, size);
+	if (!data) {
+		CloseHandle(mappingHandle);
+		mappingHandle = nullptr;
+		return false;
+	}
+	mappedSize = size;
+	return true;
+}
+
+void MappedFile::Unmap() {
+	if (data) {
+		UnmapViewOfFile(data);
+		data = nullptr;
+	}
+	if (mappingHandle) {
+		CloseHandle(mappingHandle);
+		mappingHandle = nullptr;
+	}
+	mappedSize = 0;
+}
+
+void MappedFile::Close(size_t usedSize) {
+	Unmap();
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	if (writable && usedSize != (size_t)-1) {
+		LARGE_INTEGER end;
+		end.QuadPart = (LONGLONG)usedSize;
+		SetFilePointerEx(fileHandle, end, nullptr, FILE_BEGIN);
+		SetEndOfFile(fileHandle);
+	}
+	CloseHandle(fileHandle);
+	fileHandle	= INVALID_HANDLE_VALUE;
+	writable	= false;
+}
+#else
+bool MappedFile::OpenRead(const std::string& filename) {
+	Close();
+	fileHandle = open(filename.c_str(), O_RDONLY);
+	if (fileHandle < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(fileHandle, &info) != 0 || info.st_size == 0) {
+		Close();
+		return false;
+	}
+	writable = false;
+	if (!Map((size_t)info.st_size)) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool MappedFile::OpenWrite(const std::string& filename, size_t initialSize) {
+	Close();
+	fileHandle = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fileHandle < 0) {
+		return false;
+	}
+	writable = true;
+	if (!Map(initialSize)) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool MappedFile::Map(size_t size) {
+	if (writable && ftruncate(fileHandle, (off_t)size) != 0) {
+		return false;
+	}
+	int		protect = PROT_READ | PROT_WRITE;
+	int		flags	= writable ? MAP_SHARED : MAP_PRIVATE;
+	void*	mapped	= mmap(nullptr, size, protect, flags, fileHandle, 0);
+	if (mapped == MAP_FAILED) {
+		return false;
+	}
+	data		= (char*)mapped;
+	mappedSize	= size;
+	return true;
+}
+
+void MappedFile::Unmap() {
+	if (data) {
+		munmap(data, mappedSize);
+		data = nullptr;
+	}
+	mappedSize = 0;
+}
+
+void MappedFile::Close(size_t usedSize) {
+	Unmap();
+	if (fileHandle < 0) {
+		return;
+	}
+	if (writable && usedSize != (size_t)-1) {
+		ftruncate(fileHandle, (off_t)usedSize);
+	}
+	close(fileHandle);
+	fileHandle	= -1;
+	writable	= false;
+}
+#endif
+
+bool MappedFile::Reserve(size_t bytes) {
+	if (!writable || !data) {
+		return false;
+	}
+	if (bytes <= mappedSize) {
+		return true;
+	}
+	size_t newSize = mappedSize > 0 ? mappedSize : 4096;
+	while (newSize < bytes) {
+		newSize *= 2;
+	}
+	Unmap();
+	return Map(newSize);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+namespace NCL::CSC8503 {
+	/*
+	A file mapped straight into memory, so reading or writing it is just
+	reading or writing the bytes at GetData(), with the OS doing the actual
+	disk work in the background.
+
+	Files opened for writing start at the given size and can be grown with
+	Reserve, which remaps them - so don't hold on to pointers into the data
+	across a Reserve. Close cuts the file back to the size actually used.
+
+	Files opened for reading are mapped copy-on-write: anything written to
+	them stays in this process and never reaches the disk.
+	*/
+	class MappedFile {
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool OpenRead(const std::string& filename);
+		bool OpenWrite(const std::string& filename, size_t initialSize);
+
+		//Makes sure at least this many bytes are mapped, growing the file
+		//by doubling. Only for files opened for writing.
+		bool Reserve(size_t bytes);
+
+		//Writable files are truncated to usedSize first, if it's given
+		void Close(size_t usedSize = (size_t)-1);
+
+		bool IsOpen() const {
+			return data != nullptr;
+		}
+
+		bool IsWritable() const {
+			return writable;
+		}
+
+		char* GetData() const {
+			return data;
+		}
+
+		size_t GetMappedSize() const {
+			return mappedSize;
+		}
+
+	protected:
+		bool Map(size_t size);
+		void Unmap();
+
+		char*	data;
+		size_t	mappedSize;
+		bool	writable;
+
+#ifdef _WIN32
+		void*	fileHandle;
+		void*	mappingHandle;
+#else
+		int		fileHandle;
+#endif
+	};
+}
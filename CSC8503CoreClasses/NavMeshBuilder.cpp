@@ -0,0 +1,587 @@
+#include "NavMeshBuilder.h"
+#include "GameWorld.h"
+#include "GameObject.h"
+#include "PhysicsObject.h"
+#include "AABBVolume.h"
+#include "OBBVolume.h"
+#include "Maths.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <climits>
+#include <cfloat>
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	//Neighbouring columns, in the order connections are stored in
+	const int DX[4] = { -1, 0, 1, 0 };
+	const int DZ[4] = { 0, 1, 0, -1 };
+
+	const int DIR_LEFT		= 0;
+	const int DIR_FORWARD	= 1;
+	const int DIR_RIGHT		= 2;
+	const int DIR_BACK		= 3;
+
+	const int NO_REGION			= -1;
+	const int OUTSIDE_TILE		= -2;
+
+	struct RawSpan {
+		int		column;
+		int		bottom;
+		int		top;
+		bool	walkable;
+
+		bool operator<(const RawSpan& other) const {
+			if (column != other.column) {
+				return column < other.column;
+			}
+			return bottom != other.bottom ? bottom < other.bottom : top < other.top;
+		}
+	};
+
+	struct Region {
+		int x;
+		int z;
+		int width;
+		int depth;
+		int firstCell; //into regionCells, row by row
+	};
+
+	//Where a vertical line through (x, z) passes through the box, and
+	//whether the face it leaves by at the top is flat enough to stand on
+	bool ColumnThroughBox(const NavMeshBuilder::Obstacle& box, float x, float z, float minNormalY, float& bottom, float& top, bool& walkable) {
+		Vector3 offset(x - box.centre.x, -box.centre.y, z - box.centre.z);
+		float	enter	= -FLT_MAX;
+		float	exit	= FLT_MAX;
+		int		exitAxis = 1;
+		for (int i = 0; i < 3; ++i) {
+			float along		= Vector::Dot(offset, box.axes[i]);
+			float rate		= box.axes[i].y;
+			float half		= box.halfSizes[i];
+			if (fabsf(rate) < 1e-6f) {
+				if (fabsf(along) > half) {
+					return false;
+				}
+				continue;
+			}
+			float a = (-half - along) / rate;
+			float b = (half - along) / rate;
+			if (a > b) {
+				std::swap(a, b);
+			}
+			enter = std::max(enter, a);
+			if (b < exit) {
+				exit		= b;
+				exitAxis	= i;
+			}
+			if (enter > exit) {
+				return false;
+			}
+		}
+		bottom		= enter;
+		top			= exit;
+		walkable	= fabsf(box.axes[exitAxis].y) >= minNormalY;
+		return true;
+	}
+}
+
+NavMeshBuilder::NavMeshBuilder(const NavMeshBuildSettings& settings) : settings(settings) {
+	tilesWide	= 0;
+	tilesDeep	= 0;
+	mesh		= std::make_shared<NavigationMesh>();
+}
+
+NavMeshBuilder::~NavMeshBuilder() {
+}
+
+void NavMeshBuilder::Build(GameWorld& world) {
+	obstacles.clear();
+	CollectObstacles(world, obstacles);
+
+	tiles.clear();
+	dirty.clear();
+	tilesWide = 0;
+	tilesDeep = 0;
+	if (obstacles.empty()) {
+		mesh = std::make_shared<NavigationMesh>();
+		return;
+	}
+	Vector3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vector3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (auto& [object, box] : obstacles) {
+		for (int i = 0; i < 3; ++i) {
+			boundsMin[i] = std::min(boundsMin[i], box.boundsMin[i]);
+			boundsMax[i] = std::max(boundsMax[i], box.boundsMax[i]);
+		}
+	}
+	float tileWidth = settings.cellSize * settings.tileSize;
+
+	origin		= boundsMin;
+	tilesWide	= std::max(1, (int)ceilf((boundsMax.x - boundsMin.x) / tileWidth));
+	tilesDeep	= std::max(1, (int)ceilf((boundsMax.z - boundsMin.z) / tileWidth));
+
+	tiles.resize(tilesWide * tilesDeep);
+	dirty.assign(tilesWide * tilesDeep, true);
+
+	BuildDirtyTiles();
+	AssembleMesh();
+}
+
+int NavMeshBuilder::Update(GameWorld& world) {
+	if (tiles.empty()) {
+		Build(world);
+		return GetTileCount();
+	}
+	std::unordered_map<const GameObject*, Obstacle> current;
+	CollectObstacles(world, current);
+
+	auto moved = [](const Obstacle& a, const Obstacle& b) {
+		const float EPSILON = 0.0001f;
+		auto differs = [&](const Vector3& u, const Vector3& v) {
+			return fabsf(u.x - v.x) > EPSILON || fabsf(u.y - v.y) > EPSILON || fabsf(u.z - v.z) > EPSILON;
+		};
+		return differs(a.centre, b.centre) || differs(a.halfSizes, b.halfSizes) ||
+			differs(a.axes[0], b.axes[0]) || differs(a.axes[1], b.axes[1]) || differs(a.axes[2], b.axes[2]);
+	};
+	for (auto& [object, box] : current) {
+		auto i = obstacles.find(object);
+		if (i == obstacles.end()) {
+			MarkTiles(box.boundsMin, box.boundsMax);
+		}
+		else if (moved(i->second, box)) {
+			MarkTiles(i->second.boundsMin, i->second.boundsMax); //it's gone from here
+			MarkTiles(box.boundsMin, box.boundsMax);
+		}
+	}
+	for (auto& [object, box] : obstacles) {
+		if (!current.count(object)) {
+			MarkTiles(box.boundsMin, box.boundsMax);
+		}
+	}
+	obstacles.swap(current);
+
+	int rebuilt = (int)std::count(dirty.begin(), dirty.end(), true);
+	if (rebuilt > 0) {
+		BuildDirtyTiles();
+		AssembleMesh();
+	}
+	return rebuilt;
+}
+
+void NavMeshBuilder::MarkDirty(const Vector3& boundsMin, const Vector3& boundsMax) {
+	MarkTiles(boundsMin, boundsMax);
+}
+
+void NavMeshBuilder::CollectObstacles(GameWorld& world, std::unordered_map<const GameObject*, Obstacle>& out) const {
+	GameObjectIterator first;
+	GameObjectIterator last;
+	world.GetObjectIterators(first, last);
+
+	for (auto i = first; i != last; ++i) {
+		GameObject* object = *i;
+		const CollisionVolume*	volume	= object->GetBoundingVolume();
+		const PhysicsObject*	physics = object->GetPhysicsObject();
+		if (!object->IsActive() || !volume || !physics || physics->GetInverseMass() != 0.0f) {
+			continue;
+		}
+		Obstacle box;
+		if (volume->type == VolumeType::AABB) {
+			box.halfSizes	= ((const AABBVolume&)*volume).GetHalfDimensions();
+			box.axes[0]		= Vector3(1, 0, 0);
+			box.axes[1]		= Vector3(0, 1, 0);
+			box.axes[2]		= Vector3(0, 0, 1);
+		}
+		else if (volume->type == VolumeType::OBB) {
+			box.halfSizes = ((const OBBVolume&)*volume).GetHalfDimensions();
+			Matrix3 rotation = Quaternion::RotationMatrix<Matrix3>(object->GetTransform().GetOrientation());
+			for (int j = 0; j < 3; ++j) {
+				box.axes[j] = rotation.GetColumn(j);
+			}
+		}
+		else {
+			continue;
+		}
+		box.centre = object->GetTransform().GetPosition();
+
+		Vector3 extent;
+		for (int j = 0; j < 3; ++j) {
+			float half = box.halfSizes[j];
+			extent.x += fabsf(box.axes[j].x) * half;
+			extent.y += fabsf(box.axes[j].y) * half;
+			extent.z += fabsf(box.axes[j].z) * half;
+		}
+		box.boundsMin = box.centre - extent;
+		box.boundsMax = box.centre + extent;
+
+		out[object] = box;
+	}
+}
+
+//Anything within the erosion distance of a change can be affected, so
+//the area is grown by that much first
+void NavMeshBuilder::MarkTiles(const Vector3& boundsMin, const Vector3& boundsMax) {
+	if (tiles.empty()) {
+		return;
+	}
+	float reach		= (ceilf(settings.agentRadius / settings.cellSize) + 1.0f) * settings.cellSize;
+	float tileWidth = settings.cellSize * settings.tileSize;
+
+	int x0 = std::max(0, (int)floorf((boundsMin.x - reach - origin.x) / tileWidth));
+	int z0 = std::max(0, (int)floorf((boundsMin.z - reach - origin.z) / tileWidth));
+	int x1 = std::min(tilesWide - 1, (int)floorf((boundsMax.x + reach - origin.x) / tileWidth));
+	int z1 = std::min(tilesDeep - 1, (int)floorf((boundsMax.z + reach - origin.z) / tileWidth));
+
+	for (int z = z0; z <= z1; ++z) {
+		for (int x = x0; x <= x1; ++x) {
+			dirty[z * tilesWide + x] = true;
+		}
+	}
+}
+
+void NavMeshBuilder::BuildDirtyTiles() {
+	obstacleList.clear();
+	for (auto& [object, box] : obstacles) {
+		obstacleList.emplace_back(box);
+	}
+	std::vector<int> work;
+	for (int i = 0; i < (int)dirty.size(); ++i) {
+		if (dirty[i]) {
+			work.emplace_back(i);
+		}
+	}
+	int threads = settings.threadCount < 0 ? (int)std::thread::hardware_concurrency() : settings.threadCount;
+	threads = std::max(1, std::min(threads, (int)work.size()));
+
+	std::atomic<int> next(0);
+	auto run = [&]() {
+		for (int i = next++; i < (int)work.size(); i = next++) {
+			int tile = work[i];
+			TileMesh built;
+			BuildTile(tile % tilesWide, tile / tilesWide, built);
+			tiles[tile] = std::move(built); //each tile only ever has one thread writing it
+		}
+	};
+	std::vector<std::thread> pool;
+	for (int i = 1; i < threads; ++i) {
+		pool.emplace_back(run);
+	}
+	run();
+	for (std::thread& t : pool) {
+		t.join();
+	}
+	dirty.assign(dirty.size(), false);
+}
+
+/*
+A tile is built from a heightfield a little bigger than itself, by the
+erosion distance and a cell more on each side, so floor near its edges
+is worn away by walls in the tiles next door just the same as by its own.
+Only regions inside the tile itself become triangles.
+*/
+void NavMeshBuilder::BuildTile(int tx, int tz, TileMesh& out) const {
+	const float cellSize	= settings.cellSize;
+	const float cellHeight	= settings.cellHeight;
+
+	const int radius	= (int)ceilf(settings.agentRadius / cellSize);
+	const int climb		= (int)floorf(settings.maxClimb / cellHeight);
+	const int headroom	= (int)ceilf(settings.agentHeight / cellHeight);
+	const int border	= radius + 1;
+	const int size		= settings.tileSize + border * 2;
+	const int coreMin	= border;
+	const int coreMax	= border + settings.tileSize; //one past
+
+	const float minNormalY = cosf(Maths::DegreesToRadians(settings.maxSlope));
+
+	//The heightfield's first cell, counting from the origin
+	const int startX = tx * settings.tileSize - border;
+	const int startZ = tz * settings.tileSize - border;
+
+	const float minX = origin.x + startX * cellSize;
+	const float minZ = origin.z + startZ * cellSize;
+	const float maxX = minX + size * cellSize;
+	const float maxZ = minZ + size * cellSize;
+
+	//Rasterise every box this heightfield overlaps, column by column
+	std::vector<RawSpan> raw;
+	for (const Obstacle& box : obstacleList) {
+		if (box.boundsMax.x < minX || box.boundsMin.x > maxX || box.boundsMax.z < minZ || box.boundsMin.z > maxZ) {
+			continue;
+		}
+		int x0 = std::max(0, (int)floorf((box.boundsMin.x - minX) / cellSize));
+		int z0 = std::max(0, (int)floorf((box.boundsMin.z - minZ) / cellSize));
+		int x1 = std::min(size - 1, (int)floorf((box.boundsMax.x - minX) / cellSize));
+		int z1 = std::min(size - 1, (int)floorf((box.boundsMax.z - minZ) / cellSize));
+
+		for (int z = z0; z <= z1; ++z) {
+			for (int x = x0; x <= x1; ++x) {
+				float bottom;
+				float top;
+				bool walkable;
+				if (!ColumnThroughBox(box, minX + (x + 0.5f) * cellSize, minZ + (z + 0.5f) * cellSize, minNormalY, bottom, top, walkable)) {
+					continue;
+				}
+				int low		= std::max(0, (int)floorf((bottom - origin.y) / cellHeight));
+				int high	= std::max(low + 1, (int)ceilf((top - origin.y) / cellHeight));
+				raw.push_back({ z * size + x, low, high, walkable });
+			}
+		}
+	}
+	std::sort(raw.begin(), raw.end());
+
+	//Merge overlapping solid spans, then keep the floors on top of them
+	//with room to stand. Where two tops are within a step of each other,
+	//either being walkable is enough.
+	std::vector<int> columnStart(size * size + 1, 0);
+	std::vector<int> floors;
+	std::vector<int> ceilings;
+	for (size_t i = 0; i < raw.size();) {
+		int column = raw[i].column;
+		RawSpan merged = raw[i++];
+		while (true) {
+			bool more = i < raw.size() && raw[i].column == column;
+			if (more && raw[i].bottom <= merged.top) {
+				if (raw[i].top > merged.top + climb) {
+					merged.walkable = raw[i].walkable;
+				}
+				else if (raw[i].top >= merged.top - climb) {
+					merged.walkable = merged.walkable || raw[i].walkable;
+				}
+				merged.top = std::max(merged.top, raw[i].top);
+				i++;
+				continue;
+			}
+			int ceiling = more ? raw[i].bottom : INT_MAX;
+			if (merged.walkable && ceiling - merged.top >= headroom) {
+				floors.emplace_back(merged.top);
+				ceilings.emplace_back(ceiling);
+				columnStart[column + 1]++;
+			}
+			if (!more) {
+				break;
+			}
+			merged = raw[i++];
+		}
+	}
+	for (int c = 0; c < size * size; ++c) {
+		columnStart[c + 1] += columnStart[c];
+	}
+	int spanCount = (int)floors.size();
+
+	//Link each floor to the one it can step to in each neighbouring column
+	std::vector<int> links(spanCount * 4, -1);
+	for (int z = 0; z < size; ++z) {
+		for (int x = 0; x < size; ++x) {
+			for (int s = columnStart[z * size + x]; s < columnStart[z * size + x + 1]; ++s) {
+				for (int d = 0; d < 4; ++d) {
+					int nx = x + DX[d];
+					int nz = z + DZ[d];
+					if (nx < 0 || nz < 0 || nx >= size || nz >= size) {
+						continue;
+					}
+					for (int t = columnStart[nz * size + nx]; t < columnStart[nz * size + nx + 1]; ++t) {
+						int gap = std::min(ceilings[s], ceilings[t]) - std::max(floors[s], floors[t]);
+						if (abs(floors[t] - floors[s]) <= climb && gap >= headroom) {
+							links[s * 4 + d] = t;
+							break;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	//Wear the floor away from its edges by the agent's radius, spreading
+	//out from every floor that's missing a neighbour
+	std::vector<int> distance(spanCount, INT_MAX);
+	std::vector<int> open;
+	for (int s = 0; s < spanCount; ++s) {
+		for (int d = 0; d < 4; ++d) {
+			if (links[s * 4 + d] < 0) {
+				distance[s] = 0;
+				open.emplace_back(s);
+				break;
+			}
+		}
+	}
+	for (size_t i = 0; i < open.size(); ++i) {
+		int s = open[i];
+		if (distance[s] + 1 >= radius) {
+			continue; //far enough in already
+		}
+		for (int d = 0; d < 4; ++d) {
+			int t = links[s * 4 + d];
+			if (t >= 0 && distance[t] > distance[s] + 1) {
+				distance[t] = distance[s] + 1;
+				open.emplace_back(t);
+			}
+		}
+	}
+	auto kept = [&](int s) {
+		return s >= 0 && distance[s] >= radius;
+	};
+
+	//Split the tile's floor into rectangles of connected floor, each
+	//grown as far along x as it'll go and then as many rows along z
+	std::vector<int>	regionOf(spanCount, NO_REGION);
+	std::vector<int>	regionCells;
+	std::vector<Region>	regions;
+
+	for (int z = coreMin; z < coreMax; ++z) {
+		for (int x = coreMin; x < coreMax; ++x) {
+			for (int s = columnStart[z * size + x]; s < columnStart[z * size + x + 1]; ++s) {
+				if (!kept(s) || regionOf[s] != NO_REGION) {
+					continue;
+				}
+				auto fits = [&](int t) {
+					return kept(t) && regionOf[t] == NO_REGION && abs(floors[t] - floors[s]) <= climb;
+				};
+				Region region = { x, z, 1, 1, (int)regionCells.size() };
+				regionCells.emplace_back(s);
+				while (x + region.width < coreMax) {
+					int t = links[regionCells.back() * 4 + DIR_RIGHT];
+					if (!fits(t)) {
+						break;
+					}
+					regionCells.emplace_back(t);
+					region.width++;
+				}
+				while (z + region.depth < coreMax) {
+					int rowStart	= (int)regionCells.size();
+					int above		= rowStart - region.width;
+					bool whole		= true;
+					for (int i = 0; i < region.width && whole; ++i) {
+						int t = links[regionCells[above + i] * 4 + DIR_FORWARD];
+						whole = fits(t) && (i == 0 || links[regionCells.back() * 4 + DIR_RIGHT] == t);
+						if (whole) {
+							regionCells.emplace_back(t);
+						}
+					}
+					if (!whole) {
+						regionCells.resize(rowStart);
+						break;
+					}
+					region.depth++;
+				}
+				int regionIndex = (int)regions.size();
+				for (int i = region.firstCell; i < (int)regionCells.size(); ++i) {
+					regionOf[regionCells[i]] = regionIndex;
+				}
+				regions.emplace_back(region);
+			}
+		}
+	}
+
+	//What's across a cell's side - a region, nothing, or another tile
+	auto across = [&](int x, int z, int s, int d) {
+		int nx = x + DX[d];
+		int nz = z + DZ[d];
+		if (nx < coreMin || nz < coreMin || nx >= coreMax || nz >= coreMax) {
+			return OUTSIDE_TILE;
+		}
+		int t = links[s * 4 + d];
+		return kept(t) ? regionOf[t] : NO_REGION;
+	};
+	auto addVertex = [&](int x, int z, int s) {
+		out.vertices.push_back({ (startX + x) * 2, (startZ + z) * 2, origin.y + floors[s] * cellHeight });
+		return (int)out.vertices.size() - 1;
+	};
+
+	//Each region's contour goes round its edges, with a corner wherever
+	//what's across the edge changes, so it meets the regions next door
+	//corner for corner. Along a tile edge there's no telling what the
+	//next tile has done, so there's a corner at every cell.
+	std::vector<int> contour;
+	for (const Region& r : regions) {
+		auto cell = [&](int x, int z) {
+			return regionCells[r.firstCell + (z - r.z) * r.width + (x - r.x)];
+		};
+		contour.clear();
+
+		struct Side {
+			int startX, startZ;	//first cell along it
+			int stepX, stepZ;
+			int length;
+			int cornerX, cornerZ;	//from a cell to the corner it starts at
+			int direction;
+		};
+		const Side sides[4] = {
+			{ r.x,					r.z,				 1,  0, r.width, 0, 0, DIR_BACK },
+			{ r.x + r.width - 1,	r.z,				 0,  1, r.depth, 1, 0, DIR_RIGHT },
+			{ r.x + r.width - 1,	r.z + r.depth - 1,	-1,  0, r.width, 1, 1, DIR_FORWARD },
+			{ r.x,					r.z + r.depth - 1,	 0, -1, r.depth, 0, 1, DIR_LEFT }
+		};
+		for (const Side& side : sides) {
+			int previous = 0;
+			for (int k = 0; k < side.length; ++k) {
+				int x = side.startX + side.stepX * k;
+				int z = side.startZ + side.stepZ * k;
+				int s = cell(x, z);
+				int next = across(x, z, s, side.direction);
+				if (k == 0 || next != previous || next == OUTSIDE_TILE) {
+					contour.emplace_back(addVertex(x + side.cornerX, z + side.cornerZ, s));
+				}
+				previous = next;
+			}
+		}
+
+		//The other way round to the contour, so the triangles face up
+		if (contour.size() == 4) {
+			out.indices.insert(out.indices.end(), { contour[0], contour[2], contour[1], contour[0], contour[3], contour[2] });
+			continue;
+		}
+		//Corners part way along the sides would make slivers of a fan from
+		//one corner, so it goes from the middle instead
+		float middleY = 0.0f;
+		const int corners[4][2] = { { r.x, r.z }, { r.x + r.width - 1, r.z }, { r.x + r.width - 1, r.z + r.depth - 1 }, { r.x, r.z + r.depth - 1 } };
+		for (auto& c : corners) {
+			middleY += floors[cell(c[0], c[1])];
+		}
+		out.vertices.push_back({ (startX + r.x) * 2 + r.width, (startZ + r.z) * 2 + r.depth, origin.y + middleY * 0.25f * cellHeight });
+		int middle = (int)out.vertices.size() - 1;
+
+		for (size_t i = 0; i < contour.size(); ++i) {
+			out.indices.insert(out.indices.end(), { middle, contour[(i + 1) % contour.size()], contour[i] });
+		}
+	}
+}
+
+//Joins the tiles into one mesh, welding vertices that sit on the same
+//cell corner at heights close enough to step between
+void NavMeshBuilder::AssembleMesh() {
+	std::unordered_map<uint64_t, std::vector<int>>	welded;
+	std::vector<Vector3>							vertices;
+	std::vector<int>								indices;
+	std::vector<int>								remap;
+
+	float halfCell = settings.cellSize * 0.5f;
+	for (const TileMesh& tile : tiles) {
+		remap.resize(tile.vertices.size());
+		for (size_t i = 0; i < tile.vertices.size(); ++i) {
+			const TileVertex& v = tile.vertices[i];
+			uint64_t key = ((uint64_t)(uint32_t)v.x << 32) | (uint32_t)v.z;
+
+			std::vector<int>& sameSpot = welded[key];
+			int found = -1;
+			for (int index : sameSpot) {
+				if (fabsf(vertices[index].y - v.y) <= settings.maxClimb) {
+					found = index;
+					break;
+				}
+			}
+			if (found < 0) {
+				found = (int)vertices.size();
+				vertices.emplace_back(origin.x + v.x * halfCell, v.y, origin.z + v.z * halfCell);
+				sameSpot.emplace_back(found);
+			}
+			remap[i] = found;
+		}
+		for (int index : tile.indices) {
+			indices.emplace_back(remap[index]);
+		}
+	}
+	mesh = std::make_shared<NavigationMesh>(vertices, indices);
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "NavigationMesh.h"
+
+#include <memory>
+#include <unordered_map>
+
+namespace NCL::CSC8503 {
+	class GameWorld;
+	class GameObject;
+
+	//Distances are in world units, and the agent sizes are rounded to
+	//whole cells. The defaults suit the maze's 6 unit cubes.
+	struct NavMeshBuildSettings {
+		float	cellSize	= 1.0f;		//across a heightfield column
+		float	cellHeight	= 0.5f;		//up a heightfield column
+		float	agentHeight	= 4.0f;		//room needed above a floor to walk on it
+		float	agentRadius	= 1.0f;		//how far to keep paths away from walls
+		float	maxClimb	= 1.0f;		//the highest step that can be walked up
+		float	maxSlope	= 45.0f;	//in degrees
+		int		tileSize	= 32;		//cells along each side of a tile
+		int		threadCount	= -1;		//to build tiles on, -1 for as many as the machine has
+	};
+
+	/*
+	Builds a navigation mesh from the static boxes in a world - anything
+	with an AABB or OBB volume and a physics object that doesn't move. It
+	works the same way as Recast, a tile at a time:
+
+	- Each box is rasterised into a heightfield: every column of cells
+	  gets the heights where it passes through solid boxes.
+	- The tops of those solid spans are walkable floor if the face they
+	  come from isn't too steep and there's room above for an agent.
+	- Floor within an agent's radius of a wall or drop is taken away.
+	- What's left is split into regions, rectangles of connected floor.
+	- Each region's outline becomes a contour, with a corner wherever the
+	  region next door changes so neighbouring regions meet exactly.
+	- The contours are triangulated and the triangles from every tile are
+	  welded together into the mesh.
+
+	Tiles are built in parallel. After the first build, Update only
+	rebuilds the tiles under boxes that have moved, appeared or gone,
+	which is a few tiles for a door or puzzle piece.
+	*/
+	class NavMeshBuilder {
+	public:
+		NavMeshBuilder(const NavMeshBuildSettings& settings = NavMeshBuildSettings());
+		~NavMeshBuilder();
+
+		//Builds every tile from scratch. The tiles cover the boxes as they
+		//are now - anything moved outside them later is cut off at the edge.
+		void	Build(GameWorld& world);
+
+		//Rebuilds the tiles touched by any box that's changed since the
+		//last build, and returns how many there were
+		int		Update(GameWorld& world);
+
+		//A new mesh after every build or update that changed something, so
+		//searches can carry on with the one they started with
+		std::shared_ptr<const NavigationMesh> GetMesh() const {
+			return mesh;
+		}
+
+		int GetTileCount() const {
+			return tilesWide * tilesDeep;
+		}
+
+		//Marks the tiles under an area to be rebuilt on the next Update,
+		//for changes that aren't a box moving
+		void MarkDirty(const Vector3& boundsMin, const Vector3& boundsMax);
+
+		struct Obstacle {
+			Vector3	centre;
+			Vector3	axes[3];	//unit length, in world space
+			Vector3	halfSizes;
+			Vector3	boundsMin;	//world space box around it
+			Vector3	boundsMax;
+		};
+
+		//One tile's share of the mesh. Vertices are kept on the corners of
+		//the cells, in half cells so region centres fit too.
+		struct TileVertex {
+			int		x;
+			int		z;
+			float	y;
+		};
+
+		struct TileMesh {
+			std::vector<TileVertex>	vertices;
+			std::vector<int>		indices;
+		};
+
+	protected:
+		void	CollectObstacles(GameWorld& world, std::unordered_map<const GameObject*, Obstacle>& out) const;
+		void	MarkTiles(const Vector3& boundsMin, const Vector3& boundsMax);
+		void	BuildDirtyTiles();
+		void	BuildTile(int tx, int tz, TileMesh& out) const;
+		void	AssembleMesh();
+
+		NavMeshBuildSettings settings;
+
+		//Where the heightfield starts, and its size in tiles
+		Vector3	origin;
+		int		tilesWide;
+		int		tilesDeep;
+
+		std::unordered_map<const GameObject*, Obstacle>	obstacles;
+		std::vector<Obstacle>							obstacleList; //the same, for the tile builds to read
+
+		std::vector<TileMesh>	tiles;
+		std::vector<bool>		dirty;
+
+		std::shared_ptr<const NavigationMesh> mesh;
+	};
+}
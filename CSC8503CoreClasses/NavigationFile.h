@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+
+namespace NCL::CSC8503 {
+	/*
+	Binary versions of the navigation mesh and grid files, laid out so they
+	can be mapped straight into memory rather than parsed. A mesh's
+	sections are used right where they're mapped, and a grid's node types
+	are copied out in one go, as tiles can be changed after loading. Every
+	section is found by its offset from the start of the file, and starts
+	on an 8 byte boundary.
+
+	The loaders tell these apart from the text files by the magic at the
+	start, so a converted file can take the place of the text one under
+	the same name. Anything with a different version is refused, rather
+	than guessed at - convert it again from the text file.
+	*/
+	struct NavMeshFileHeader {
+		char		magic[4];
+		uint32_t	version;
+
+		uint32_t	vertexCount;
+		uint32_t	triCount;
+
+		//The spatial index, as NavigationMesh builds it
+		float		indexOriginX;
+		float		indexOriginZ;
+		float		cellSize;
+		uint32_t	cellsWide;
+		uint32_t	cellsDeep;
+		uint32_t	cellTriCount;
+
+		uint64_t	vertexOffset;		//vertexCount Vector3
+		uint64_t	triOffset;			//triCount NavigationMesh::NavTri, as they are in memory
+		uint64_t	cellStartOffset;	//cellsWide * cellsDeep + 1 int32_t
+		uint64_t	cellTrisOffset;		//cellTriCount int32_t
+
+		static const uint32_t VERSION = 2;
+	};
+
+	struct NavGridFileHeader {
+		char		magic[4];
+		uint32_t	version;
+
+		uint32_t	nodeSize;
+		uint32_t	width;
+		uint32_t	height;
+		uint32_t	padding;
+
+		uint64_t	typeOffset; //one byte a node, row by row, the same characters as the text files
+
+		static const uint32_t VERSION = 1;
+	};
+
+	const char NAVMESH_FILE_MAGIC[4]	= { 'N', 'V', 'M', 'B' };
+	const char NAVGRID_FILE_MAGIC[4]	= { 'N', 'V', 'G', 'B' };
+
+	inline uint64_t AlignNavSection(uint64_t offset) {
+		return (offset + 7) & ~(uint64_t)7;
+	}
+}
@@ -1,7 +1,12 @@
 #include "NavigationGrid.h"
 #include "Assets.h"
+#include "MappedFile.h"
+#include "NavigationFile.h"
 
 #include <fstream>
+#include <iostream>
+#include <cstring>
+#include <climits>
 
 using namespace NCL;
 using namespace CSC8503;
@@ -14,14 +19,29 @@ const int BOTTOM_NODE	= 3;
 const char WALL_NODE	= 'x';
 const char FLOOR_NODE	= '.';
 
+const float TIE_BREAK		= 0.0001f;
+
 NavigationGrid::NavigationGrid()	{
 	nodeSize	= 0;
 	gridWidth	= 0;
 	gridHeight	= 0;
 	allNodes	= nullptr;
+
+	searchMode		= GridSearchMode::AStar;
+	diagonalMoves	= false;
 }
 
 NavigationGrid::NavigationGrid(const std::string&filename) : NavigationGrid() {
+	MappedFile mapped;
+	if (mapped.OpenRead(Assets::DATADIR + filename) && mapped.GetMappedSize() >= sizeof(NAVGRID_FILE_MAGIC) &&
+		memcmp(mapped.GetData(), NAVGRID_FILE_MAGIC, sizeof(NAVGRID_FILE_MAGIC)) == 0) {
+		if (!LoadBinary(mapped)) {
+			std::cout << "Couldn't load navigation grid " << filename << std::endl;
+		}
+		return;
+	}
+	mapped.Close();
+
 	std::ifstream infile(Assets::DATADIR + filename);
 
 	infile >> nodeSize;
@@ -39,138 +59,406 @@ NavigationGrid::NavigationGrid(const std::string&filename) : NavigationGrid() {
 			n.position = Vector3((float)(x * nodeSize), 0, (float)(y * nodeSize));
 		}
 	}
-	
+	BuildConnections();
+}
+
+NavigationGrid::NavigationGrid(int nodeSize, int width, int height, const std::string& tiles) : NavigationGrid() {
+	this->nodeSize	= nodeSize;
+	gridWidth		= width;
+	gridHeight		= height;
+
+	allNodes = new GridNode[gridWidth * gridHeight];
+
+	for (int y = 0; y < gridHeight; ++y) {
+		for (int x = 0; x < gridWidth; ++x) {
+			GridNode&n = allNodes[(gridWidth * y) + x];
+			size_t i = (size_t)(gridWidth * y) + x;
+			n.type = i < tiles.size() ? tiles[i] : WALL_NODE;
+			n.position = Vector3((float)(x * nodeSize), 0, (float)(y * nodeSize));
+		}
+	}
+	BuildConnections();
+}
+
+//The node types come straight out of the mapping, and the connections
+//are made from them the same as for a text file
+bool NavigationGrid::LoadBinary(const MappedFile& file) {
+	const char*	data	= file.GetData();
+	size_t		size	= file.GetMappedSize();
+
+	if (size < sizeof(NavGridFileHeader)) {
+		return false;
+	}
+	const NavGridFileHeader* header = (const NavGridFileHeader*)data;
+	if (header->version != NavGridFileHeader::VERSION) {
+		std::cout << "Navigation grid is version " << header->version << ", expected " << NavGridFileHeader::VERSION << std::endl;
+		return false;
+	}
+	uint64_t nodeCount = (uint64_t)header->width * header->height;
+	if (header->typeOffset > size || nodeCount > size - header->typeOffset || nodeCount > INT_MAX) {
+		return false;
+	}
+	if (header->nodeSize == 0 || header->nodeSize > INT_MAX) {
+		return false; //positions are divided by it to find their node
+	}
+	nodeSize	= (int)header->nodeSize;
+	gridWidth	= (int)header->width;
+	gridHeight	= (int)header->height;
+
+	allNodes = new GridNode[gridWidth * gridHeight];
+
+	const char* types = data + header->typeOffset;
+	for (int y = 0; y < gridHeight; ++y) {
+		for (int x = 0; x < gridWidth; ++x) {
+			GridNode&n = allNodes[(gridWidth * y) + x];
+			n.type = types[(gridWidth * y) + x];
+			n.position = Vector3((float)(x * nodeSize), 0, (float)(y * nodeSize));
+		}
+	}
+	BuildConnections();
+	return true;
+}
+
+bool NavigationGrid::SaveBinary(const std::string& filename) const {
+	NavGridFileHeader header;
+	memcpy(header.magic, NAVGRID_FILE_MAGIC, sizeof(NAVGRID_FILE_MAGIC));
+	header.version		= NavGridFileHeader::VERSION;
+	header.nodeSize		= (uint32_t)nodeSize;
+	header.width		= (uint32_t)gridWidth;
+	header.height		= (uint32_t)gridHeight;
+	header.padding		= 0;
+	header.typeOffset	= AlignNavSection(sizeof(NavGridFileHeader));
+
+	size_t nodeCount	= (size_t)gridWidth * gridHeight;
+	size_t size			= (size_t)header.typeOffset + nodeCount;
+
+	MappedFile file;
+	if (!file.OpenWrite(Assets::DATADIR + filename, size)) {
+		std::cout << "Couldn't open " << filename << " to save the navigation grid to" << std::endl;
+		return false;
+	}
+	char* data = file.GetData();
+	memset(data, 0, (size_t)header.typeOffset);
+	memcpy(data, &header, sizeof(header));
+
+	char* types = data + header.typeOffset;
+	for (size_t i = 0; i < nodeCount; ++i) {
+		types[i] = (char)allNodes[i].type;
+	}
+	file.Close(size);
+	return true;
+}
+
+void NavigationGrid::BuildConnections() {
+	walkable.resize(gridWidth * gridHeight);
+	for (int i = 0; i < gridWidth * gridHeight; ++i) {
+		walkable[i] = allNodes[i].type != WALL_NODE;
+	}
 	//now to build the connectivity between the nodes
 	for (int y = 0; y < gridHeight; ++y) {
 		for (int x = 0; x < gridWidth; ++x) {
-			GridNode&n = allNodes[(gridWidth * y) + x];		
+			ConnectNode(x, y);
+		}	
+	}
+}
 
-			if (y > 0) { //get the above node
-				n.connected[0] = &allNodes[(gridWidth * (y - 1)) + x];
-			}
-			if (y < gridHeight - 1) { //get the below node
-				n.connected[1] = &allNodes[(gridWidth * (y + 1)) + x];
-			}
-			if (x > 0) { //get left node
-				n.connected[2] = &allNodes[(gridWidth * (y)) + (x - 1)];
-			}
-			if (x < gridWidth - 1) { //get right node
-				n.connected[3] = &allNodes[(gridWidth * (y)) + (x + 1)];
+void NavigationGrid::ConnectNode(int x, int y) {
+	GridNode&n = allNodes[(gridWidth * y) + x];
+
+	n.connected[0] = (y > 0)				? &allNodes[(gridWidth * (y - 1)) + x] : nullptr; //get the above node
+	n.connected[1] = (y < gridHeight - 1)	? &allNodes[(gridWidth * (y + 1)) + x] : nullptr; //get the below node
+	n.connected[2] = (x > 0)				? &allNodes[(gridWidth * (y)) + (x - 1)] : nullptr; //get left node
+	n.connected[3] = (x < gridWidth - 1)	? &allNodes[(gridWidth * (y)) + (x + 1)] : nullptr; //get right node
+
+	for (int i = 0; i < 4; ++i) {
+		n.costs[i] = 0;
+		if (n.connected[i]) {
+			if (n.connected[i]->type == '.') {
+				n.costs[i]		= 1;
 			}
-			for (int i = 0; i < 4; ++i) {
-				if (n.connected[i]) {
-					if (n.connected[i]->type == '.') {
-						n.costs[i]		= 1;
-					}
-					if (n.connected[i]->type == 'x') {
-						n.connected[i] = nullptr; //actually a wall, disconnect!
-					}
-				}
+			if (n.connected[i]->type == 'x') {
+				n.connected[i] = nullptr; //actually a wall, disconnect!
 			}
-		}	
+		}
 	}
 }
 
+void NavigationGrid::SetTileType(int x, int y, char type) {
+	if (x < 0 || y < 0 || x >= gridWidth || y >= gridHeight) {
+		return;
+	}
+	allNodes[(gridWidth * y) + x].type	= type;
+	walkable[(gridWidth * y) + x]		= type != WALL_NODE;
+
+	//Only this node and the ones next to it can have changed links
+	ConnectNode(x, y);
+	if (y > 0)				ConnectNode(x, y - 1);
+	if (y < gridHeight - 1)	ConnectNode(x, y + 1);
+	if (x > 0)				ConnectNode(x - 1, y);
+	if (x < gridWidth - 1)	ConnectNode(x + 1, y);
+}
+
 NavigationGrid::~NavigationGrid()	{
 	delete[] allNodes;
 }
 
-bool NavigationGrid::FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) {
-	//need to work out which node 'from' sits in, and 'to' sits in
-	int fromX = ((int)from.x / nodeSize);
-	int fromZ = ((int)from.z / nodeSize);
-
-	int toX = ((int)to.x / nodeSize);
-	int toZ = ((int)to.z / nodeSize);
+int NavigationGrid::GetNodeIndex(const Vector3& position) const {
+	if (nodeSize <= 0) {
+		return -1;
+	}
+	int x = ((int)position.x / nodeSize);
+	int z = ((int)position.z / nodeSize);
 
-	if (fromX < 0 || fromX > gridWidth - 1 ||
-		fromZ < 0 || fromZ > gridHeight - 1) {
-		return false; //outside of map region!
+	if (x < 0 || x > gridWidth - 1 ||
+		z < 0 || z > gridHeight - 1) {
+		return -1; //outside of map region!
 	}
+	return (z * gridWidth) + x; // 2D to 1D array indexing
+}
 
-	if (toX < 0 || toX > gridWidth - 1 ||
-		toZ < 0 || toZ > gridHeight - 1) {
+bool NavigationGrid::FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) {
+	return FindPath(from, to, outPath, scratch);
+}
+
+bool NavigationGrid::FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath, GridSearchScratch& scratch) const {
+	//need to work out which node 'from' sits in, and 'to' sits in
+	int startIndex	= GetNodeIndex(from);
+	int endIndex	= GetNodeIndex(to);
+	if (startIndex < 0 || endIndex < 0) {
 		return false; //outside of map region!
 	}
+	scratch.Begin(gridWidth * gridHeight);
 
-	GridNode* startNode = &allNodes[(fromZ * gridWidth) + fromX]; // 2D to 1D array indexing
-	GridNode* endNode = &allNodes[(toZ * gridWidth) + toX];	// 2D to 1D array indexing
+	scratch.g[startIndex]		= 0;
+	scratch.parent[startIndex]	= -1;
+	scratch.seen[startIndex]	= scratch.generation;
+	scratch.open.Push(startIndex, 0.0f);
 
-	std::vector<GridNode*>  openList; // could use a priority queue here...
-	std::vector<GridNode*>  closedList; // could use a priority queue here...
+	bool found = searchMode == GridSearchMode::JumpPoint
+		? FindJumpPointPath(endIndex, scratch)
+		: FindAStarPath(endIndex, scratch);
 
-	openList.push_back(startNode);
-
-	startNode->f = 0;
-	startNode->g = 0;
-	startNode->parent = nullptr;
+	if (found) {
+		BuildPath(endIndex, scratch, outPath);
+	}
+	return found;
+}
 
-	GridNode* currentBestNode = nullptr;
+void NavigationGrid::OpenNode(int node, int parent, float g, int endIndex, GridSearchScratch& scratch) const {
+	if (scratch.IsClosed(node)) {
+		return; //already discarded this neighbour...
+	}
+	if (!scratch.IsSeen(node) || g < scratch.g[node]) {//might be a better route to this neighbour
+		scratch.seen[node]		= scratch.generation;
+		scratch.g[node]			= g;
+		scratch.parent[node]	= parent;
+		//Among equal totals, whichever has come furthest goes first
+		scratch.open.Push(node, g + Heuristic(&allNodes[node], &allNodes[endIndex]) - g * TIE_BREAK);
+	}
+}
 
-	while (!openList.empty()) {
-		currentBestNode = RemoveBestNode(openList);
+bool NavigationGrid::FindAStarPath(int endIndex, GridSearchScratch& scratch) const {
+	while (!scratch.open.IsEmpty()) {
+		int bestIndex = scratch.open.Pop();
+		scratch.closed[bestIndex] = scratch.generation;
+		scratch.expanded++;
 
-		if (currentBestNode == endNode) {			//we've found the path!
-			GridNode* node = endNode;
-			while (node != nullptr) {
-				outPath.PushWaypoint(node->position); // build up the path from the end
-				node = node->parent;
-			}
+		if (bestIndex == endIndex) {			//we've found the path!
 			return true;
 		}
-		else {
-			for (int i = 0; i < 4; ++i) {
-				GridNode* neighbour = currentBestNode->connected[i];
-				if (!neighbour) { //might not be connected...
-					continue;
-				}	
-				bool inClosed	= NodeInList(neighbour, closedList);
-				if (inClosed) {
-					continue; //already discarded this neighbour...
+		const GridNode& best = allNodes[bestIndex];
+		for (int i = 0; i < 4; ++i) {
+			const GridNode* neighbour = best.connected[i];
+			if (neighbour) { //might not be connected...
+				OpenNode((int)(neighbour - allNodes), bestIndex, scratch.g[bestIndex] + best.costs[i], endIndex, scratch);
+			}
+		}
+		if (!diagonalMoves) {
+			continue;
+		}
+		int x = bestIndex % gridWidth;
+		int y = bestIndex / gridWidth;
+		for (int dy = -1; dy <= 1; dy += 2) {
+			for (int dx = -1; dx <= 1; dx += 2) {
+				if (IsWalkable(x + dx, y + dy) && IsWalkable(x + dx, y) && IsWalkable(x, y + dy)) {
+					OpenNode((y + dy) * gridWidth + x + dx, bestIndex, scratch.g[bestIndex] + DIAGONAL_COST, endIndex, scratch);
 				}
+			}
+		}
+	}
+	return false; //open list emptied out with no path!
+}
+
+/*
+Jump point search only puts the nodes where a path might have to turn on
+the open list. From each, it runs in the directions that could lead
+somewhere new, and keeps going until a wall, the goal, or a node next to
+a wall that can only be reached best through this run (a forced
+neighbour). The nodes it passes over are never opened.
 
-				float h = Heuristic(neighbour, endNode);				
-				float g = currentBestNode->g + currentBestNode->costs[i];
-				float f = h + g;
+Diagonal moves may not cut corners, so a diagonal run also stops wherever
+a straight run from it would find something.
+*/
+bool NavigationGrid::FindJumpPointPath(int endIndex, GridSearchScratch& scratch) const {
+	int directions[8][2];
 
-				bool inOpen		= NodeInList(neighbour, openList);
+	while (!scratch.open.IsEmpty()) {
+		int bestIndex = scratch.open.Pop();
+		scratch.closed[bestIndex] = scratch.generation;
+		scratch.expanded++;
+
+		if (bestIndex == endIndex) {
+			return true;
+		}
+		int x		= bestIndex % gridWidth;
+		int y		= bestIndex / gridWidth;
+		int count	= 0;
 
-				if (!inOpen) { //first time we've seen this neighbour
-					openList.emplace_back(neighbour);
+		int parent = scratch.parent[bestIndex];
+		if (parent < 0) { //the start goes every way it can
+			for (int dy = -1; dy <= 1; ++dy) {
+				for (int dx = -1; dx <= 1; ++dx) {
+					if ((dx == 0 && dy == 0) || (dx != 0 && dy != 0 && !diagonalMoves)) {
+						continue;
+					}
+					directions[count][0] = dx;
+					directions[count][1] = dy;
+					count++;
 				}
-				if (!inOpen || f < neighbour->f) {//might be a better route to this neighbour
-					neighbour->parent = currentBestNode;
-					neighbour->f = f;
-					neighbour->g = g;
+			}
+		}
+		else { //otherwise only ways the parent couldn't have gone itself
+			int px = parent % gridWidth;
+			int py = parent / gridWidth;
+			int dx = (x > px) - (x < px);
+			int dy = (y > py) - (y < py);
+
+			auto add = [&](int ddx, int ddy) {
+				directions[count][0] = ddx;
+				directions[count][1] = ddy;
+				count++;
+			};
+			if (dx != 0 && dy != 0) {
+				add(dx, 0);
+				add(0, dy);
+				add(dx, dy);
+			}
+			else if (diagonalMoves) {
+				//Straight on, the sides, and diagonally forward off them
+				add(dx, dy);
+				add(dy, dx);
+				add(-dy, -dx);
+				add(dx + dy, dy + dx);
+				add(dx - dy, dy - dx);
+			}
+			else {
+				add(dx, dy);
+				add(dy, dx);
+				add(-dy, -dx);
+			}
+		}
+		float g = scratch.g[bestIndex];
+		for (int i = 0; i < count; ++i) {
+			int dx = directions[i][0];
+			int dy = directions[i][1];
+			int jumpPoint = -1;
+			if (dx != 0 && dy != 0) {
+				if (IsWalkable(x + dx, y) && IsWalkable(x, y + dy)) {
+					jumpPoint = JumpDiagonal(x + dx, y + dy, dx, dy, endIndex);
 				}
 			}
-			closedList.emplace_back(currentBestNode);
+			else {
+				jumpPoint = JumpStraight(x + dx, y + dy, dx, dy, endIndex);
+			}
+			if (jumpPoint < 0) {
+				continue;
+			}
+			int steps = std::max(std::abs(jumpPoint % gridWidth - x), std::abs(jumpPoint / gridWidth - y));
+			OpenNode(jumpPoint, bestIndex, g + steps * (dx != 0 && dy != 0 ? DIAGONAL_COST : 1.0f), endIndex, scratch);
 		}
 	}
-	return false; //open list emptied out with no path!
+	return false;
 }
 
-bool NavigationGrid::NodeInList(GridNode* n, std::vector<GridNode*>& list) const {
-	std::vector<GridNode*>::iterator i = std::find(list.begin(), list.end(), n);
-	return i == list.end() ? false : true;
+int NavigationGrid::JumpStraight(int x, int y, int dx, int dy, int endIndex) const {
+	while (IsWalkable(x, y)) {
+		int index = y * gridWidth + x;
+		if (index == endIndex) {
+			return index;
+		}
+		if (dx != 0) {
+			//A wall behind us to one side that's gone now means the node past
+			//it can't be reached any better than through here
+			if ((IsWalkable(x, y - 1) && !IsWalkable(x - dx, y - 1)) ||
+				(IsWalkable(x, y + 1) && !IsWalkable(x - dx, y + 1))) {
+				return index;
+			}
+		}
+		else {
+			if ((IsWalkable(x - 1, y) && !IsWalkable(x - 1, y - dy)) ||
+				(IsWalkable(x + 1, y) && !IsWalkable(x + 1, y - dy))) {
+				return index;
+			}
+			//Without diagonals, a vertical run has to stop anywhere a
+			//sideways one could find something, as nothing else will
+			if (!diagonalMoves && (JumpStraight(x + 1, y, 1, 0, endIndex) >= 0 || JumpStraight(x - 1, y, -1, 0, endIndex) >= 0)) {
+				return index;
+			}
+		}
+		x += dx;
+		y += dy;
+	}
+	return -1;
 }
 
-GridNode*  NavigationGrid::RemoveBestNode(std::vector<GridNode*>& list) const {
-	std::vector<GridNode*>::iterator bestI = list.begin();
-
-	GridNode* bestNode = *list.begin();
-
-	for (auto i = list.begin(); i != list.end(); ++i) {
-		if ((*i)->f < bestNode->f) {
-			bestNode	= (*i);
-			bestI		= i;
+int NavigationGrid::JumpDiagonal(int x, int y, int dx, int dy, int endIndex) const {
+	while (IsWalkable(x, y)) {
+		int index = y * gridWidth + x;
+		if (index == endIndex) {
+			return index;
+		}
+		if (JumpStraight(x + dx, y, dx, 0, endIndex) >= 0 || JumpStraight(x, y + dy, 0, dy, endIndex) >= 0) {
+			return index;
 		}
+		if (!IsWalkable(x + dx, y) || !IsWalkable(x, y + dy)) {
+			return -1; //can't squeeze past the corner
+		}
+		x += dx;
+		y += dy;
 	}
-	list.erase(bestI);
+	return -1;
+}
 
-	return bestNode;
+//Jump points can be many nodes apart, so the runs between them are filled
+//back in, to give the same node by node path that A* does
+void NavigationGrid::BuildPath(int endIndex, const GridSearchScratch& scratch, NavigationPath& outPath) const {
+	int node = endIndex;
+	while (node >= 0) {
+		int parent = scratch.parent[node];
+		outPath.PushWaypoint(allNodes[node].position); // build up the path from the end
+		if (parent < 0) {
+			break;
+		}
+		int x	= node % gridWidth;
+		int y	= node / gridWidth;
+		int dx	= (parent % gridWidth > x) - (parent % gridWidth < x);
+		int dy	= (parent / gridWidth > y) - (parent / gridWidth < y);
+		for (x += dx, y += dy; y * gridWidth + x != parent; x += dx, y += dy) {
+			outPath.PushWaypoint(allNodes[y * gridWidth + x].position);
+		}
+		node = parent;
+	}
 }
 
-float NavigationGrid::Heuristic(GridNode* hNode, GridNode* endNode) const {
-	return Vector::Length(hNode->position - endNode->position);
-}
\ No newline at end of file
+//Counted in nodes like the costs are, or the search stops being sure to
+//find the shortest route. Without diagonals that's the Manhattan distance,
+//with them it's straight along the longer axis and diagonal for the rest.
+float NavigationGrid::Heuristic(const GridNode* hNode, const GridNode* endNode) const {
+	Vector3 offset = hNode->position - endNode->position;
+	float dx = std::abs(offset.x) / nodeSize;
+	float dz = std::abs(offset.z) / nodeSize;
+	if (!diagonalMoves) {
+		return dx + dz;
+	}
+	return std::max(dx, dz) + (DIAGONAL_COST - 1.0f) * std::min(dx, dz);
+}
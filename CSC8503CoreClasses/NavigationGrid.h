@@ -1,19 +1,20 @@
 #pragma once
 #include "NavigationMap.h"
+#include "NodeHeap.h"
 #include <string>
+#include <cstdint>
 namespace NCL {
 	namespace CSC8503 {
-		struct GridNode {
-			GridNode* parent;
+		class MappedFile;
 
+		//Only what the map is made of - anything a search works out goes in
+		//a GridSearchScratch instead, so the nodes can be shared
+		struct GridNode {
 			GridNode* connected[4];
 			int		  costs[4];
 
 			Vector3		position;
 
-			float f;
-			float g;
-
 			int type;
 
 			GridNode() {
@@ -21,22 +22,79 @@ namespace NCL {
 					connected[i] = nullptr;
 					costs[i] = 0;
 				}
-				f = 0;
-				g = 0;
 				type = 0;
-				parent = nullptr;
 			}
 			~GridNode() {	}
 		};
 
+		//What a diagonal step costs, next to 1 for a straight one. Anything
+		//searching the grid has to agree on it, or their distances won't match.
+		const float DIAGONAL_COST = 1.41421356f;
+
+		enum class GridSearchMode {
+			AStar,		//expands every node it reaches
+			JumpPoint	//skips along straight runs, for maps where every step costs the same
+		};
+
 		class NavigationGrid : public NavigationMap	{
 		public:
 			NavigationGrid();
+			//Either the text format or the binary one SaveBinary writes
 			NavigationGrid(const std::string&filename);
+			//One character per node, row by row, as in the grid files
+			NavigationGrid(int nodeSize, int width, int height, const std::string& tiles);
 			~NavigationGrid();
 
 			bool FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) override;
 
+			//Doesn't change the grid, so any number can run at once as long
+			//as each has its own scratch
+			bool FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath, GridSearchScratch& scratch) const;
+
+			//Into the data directory, the same as the files it loads
+			bool SaveBinary(const std::string& filename) const;
+
+			//-1 if the position is off the grid
+			int GetNodeIndex(const Vector3& position) const;
+
+			//Where a node is, worked out rather than read from the node, for
+			//anything turning a long run of indices into a path
+			Vector3 GetNodePosition(int index) const {
+				return Vector3((float)((index % gridWidth) * nodeSize), 0, (float)((index / gridWidth) * nodeSize));
+			}
+
+			//Both give the same length of path, jump point search just gets
+			//there after looking at far fewer nodes when there's open space
+			void SetSearchMode(GridSearchMode mode) {
+				searchMode = mode;
+			}
+
+			GridSearchMode GetSearchMode() const {
+				return searchMode;
+			}
+
+			//Lets paths go diagonally between nodes, as long as they don't
+			//cut the corner of a wall
+			void SetDiagonalMoves(bool state) {
+				diagonalMoves = state;
+			}
+
+			bool HasDiagonalMoves() const {
+				return diagonalMoves;
+			}
+
+			//Turns a node into a wall or back again, reconnecting it to its
+			//neighbours. Anything built over the grid has to be told too.
+			void SetTileType(int x, int y, char type);
+
+			bool IsWalkable(int x, int y) const {
+				return x >= 0 && y >= 0 && x < gridWidth && y < gridHeight && walkable[(gridWidth * y) + x];
+			}
+
+			int GetLastExpandedCount() const {
+				return scratch.expanded;
+			}
+
 			int GetGridHeight() const {
 				return gridHeight;
 			}
@@ -50,14 +108,37 @@ namespace NCL {
 			}
 				
 		protected:
-			bool		NodeInList(GridNode* n, std::vector<GridNode*>& list) const;
-			GridNode*	RemoveBestNode(std::vector<GridNode*>& list) const;
-			float		Heuristic(GridNode* hNode, GridNode* endNode) const;
+			void		BuildConnections();
+			bool		LoadBinary(const MappedFile& file);
+			void		ConnectNode(int x, int y);
+			float		Heuristic(const GridNode* hNode, const GridNode* endNode) const;
+
+			bool		FindAStarPath(int endIndex, GridSearchScratch& scratch) const;
+			bool		FindJumpPointPath(int endIndex, GridSearchScratch& scratch) const;
+
+			//Each returns the index of the jump point found heading that
+			//way from (x, y), or -1 if it runs into a wall first
+			int			JumpStraight(int x, int y, int dx, int dy, int endIndex) const;
+			int			JumpDiagonal(int x, int y, int dx, int dy, int endIndex) const;
+
+			//Offers a node to the open list, if this is the best route to it yet
+			void		OpenNode(int node, int parent, float g, int endIndex, GridSearchScratch& scratch) const;
+			void		BuildPath(int endIndex, const GridSearchScratch& scratch, NavigationPath& outPath) const;
+
+			GridSearchMode	searchMode;
+			bool			diagonalMoves;
+
 			int nodeSize;
 			int gridWidth;
 			int gridHeight;
 
 			GridNode* allNodes;
+
+			//A byte per node, as jump point search reads long runs of these
+			//and the nodes themselves are far bigger
+			std::vector<uint8_t> walkable;
+
+			GridSearchScratch scratch; //for the NavigationMap version of FindPath
 		};
 	}
 }
@@ -1,18 +1,66 @@
 #include "NavigationMesh.h"
 #include "Assets.h"
 #include "Maths.h"
+#include "MappedFile.h"
+#include "NavigationFile.h"
 #include <fstream>
-#include <queue>
+#include <unordered_map>
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
 using namespace NCL;
 using namespace CSC8503;
 using namespace std;
 
+namespace {
+	//Which of t's edges it shares with other, or -1
+	int SharedEdge(const NavigationMesh::NavTri& t, const NavigationMesh::NavTri& other) {
+		for (int j = 0; j < 3; ++j) {
+			int a = t.indices[j];
+			int b = t.indices[(j + 1) % 3];
+			int matched = 0;
+			for (int k = 0; k < 3; ++k) {
+				matched += other.indices[k] == a || other.indices[k] == b;
+			}
+			if (matched == 2) {
+				return j;
+			}
+		}
+		return -1;
+	}
+
+	//Twice the area of abc flat on the XZ plane, positive if c is to the
+	//left of a to b as the funnel sees it
+	float TriArea2D(const Vector3& a, const Vector3& b, const Vector3& c) {
+		return (c.x - a.x) * (b.z - a.z) - (b.x - a.x) * (c.z - a.z);
+	}
+
+	bool SamePoint(const Vector3& a, const Vector3& b) {
+		float dx = a.x - b.x;
+		float dz = a.z - b.z;
+		return dx * dx + dz * dz < 0.000001f;
+	}
+}
+
 NavigationMesh::NavigationMesh()
 {
 }
 
 NavigationMesh::NavigationMesh(const std::string&filename)
 {
+	if (mapped.OpenRead(Assets::DATADIR + filename) && mapped.GetMappedSize() >= sizeof(NAVMESH_FILE_MAGIC) &&
+		memcmp(mapped.GetData(), NAVMESH_FILE_MAGIC, sizeof(NAVMESH_FILE_MAGIC)) == 0) {
+		if (!LoadBinary()) {
+			std::cout << "Couldn't load navmesh " << filename << std::endl;
+		}
+		return;
+	}
+	mapped.Close();
+
 	ifstream file(Assets::DATADIR + filename);
 
 	int numVertices = 0;
@@ -27,146 +75,534 @@ NavigationMesh::NavigationMesh(const std::string&filename)
 		file >> vert.y;
 		file >> vert.z;
 
-		allVerts.emplace_back(vert);
+		builtVerts.emplace_back(vert);
 	}
 
-	allTris.resize(numIndices / 3);
+	builtTris.resize(numIndices / 3);
 
-	for (int i = 0; i < allTris.size(); ++i) {
-		NavTri* tri = &allTris[i];
+	for (int i = 0; i < (int)builtTris.size(); ++i) {
+		NavTri* tri = &builtTris[i];
 		file >> tri->indices[0];
 		file >> tri->indices[1];
 		file >> tri->indices[2];
 
-		tri->centroid = allVerts[tri->indices[0]] +
-			allVerts[tri->indices[1]] +
-			allVerts[tri->indices[2]];
-
-		tri->centroid = allTris[i].centroid / 3.0f;
-
-		tri->triPlane = Plane::PlaneFromTri(allVerts[tri->indices[0]],
-			allVerts[tri->indices[1]],
-			allVerts[tri->indices[2]]);
-
-		tri->area = Maths::AreaofTri3D(allVerts[tri->indices[0]], allVerts[tri->indices[1]], allVerts[tri->indices[2]]);
+		BuildTriangle(*tri);
 	}
-	for (int i = 0; i < allTris.size(); ++i) {
-		NavTri* tri = &allTris[i];
+	for (int i = 0; i < (int)builtTris.size(); ++i) {
+		NavTri* tri = &builtTris[i];
 		for (int j = 0; j < 3; ++j) {
 			int index = 0;
 			file >> index;
-			if (index != -1) {
-				tri->neighbours[j] = &allTris[index];
+			if (index < 0 || index >= (int)builtTris.size()) {
+				continue;
+			}
+			//The files don't list them in edge order, so each goes in the
+			//slot for the edge it's across
+			int edge = SharedEdge(*tri, builtTris[index]);
+			if (edge >= 0) {
+				tri->neighbours[edge] = index;
 			}
 		}
 	}
+	BuildSpatialIndex();
+	UseBuilt();
+}
+
+NavigationMesh::NavigationMesh(const std::vector<Vector3>& vertices, const std::vector<int>& indices) {
+	builtVerts = vertices;
+	builtTris.resize(indices.size() / 3);
+
+	for (int i = 0; i < (int)builtTris.size(); ++i) {
+		NavTri* tri = &builtTris[i];
+		tri->indices[0] = indices[i * 3 + 0];
+		tri->indices[1] = indices[i * 3 + 1];
+		tri->indices[2] = indices[i * 3 + 2];
+		BuildTriangle(*tri);
+	}
+	FindNeighbours();
+	BuildSpatialIndex();
+	UseBuilt();
 }
 
 NavigationMesh::~NavigationMesh()
 {
 }
 
-bool NavigationMesh::FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) {
-    const NavTri* startTri = GetTriForPosition(from);
-    const NavTri* endTri = GetTriForPosition(to);
+void NavigationMesh::UseBuilt() {
+	allTris		= builtTris;
+	allVerts	= builtVerts;
+	cellStart	= builtCellStart;
+	cellTris	= builtCellTris;
+}
 
-    if (!startTri || !endTri) {
-        return false; // No valid triangles for the start or end positions
-    }
+namespace {
+	//Whether count things of this size starting at offset are all inside the file
+	bool SectionFits(uint64_t offset, uint64_t count, size_t itemSize, size_t fileSize) {
+		return offset <= fileSize && count <= (fileSize - offset) / itemSize;
+	}
+}
 
-    struct Node {
-        const NavTri* tri;
-        float gCost; // Cost from start to this node
-        float hCost; // Heuristic cost to the end
-        float fCost; // Total cost (gCost + hCost)
-        const Node* parent;
+//The file holds the triangles and vertices exactly as they sit in memory
+static_assert(sizeof(Vector3) == 3 * sizeof(float), "Vector3 is stored in navmesh files as three floats");
+static_assert(sizeof(int) == sizeof(int32_t), "navmesh files store indices as 32 bit ints");
+static_assert(sizeof(NavigationMesh::NavTri) == 14 * sizeof(float) && std::is_trivially_copyable_v<NavigationMesh::NavTri>,
+	"NavTri is stored in navmesh files as it is, so changing it needs a new file version");
 
-        Node(const NavTri* t, float g, float h, const Node* p)
-            : tri(t), gCost(g), hCost(h), fCost(g + h), parent(p) {}
+/*
+Nothing is copied or worked out again - the triangles, vertices and
+spatial index are all used right where they are in the mapping, which
+is kept open for as long as the mesh is. All that's done up front is
+checking every index in it points somewhere real, so a bad file can't
+send a search or lookup off the end of anything.
+*/
+bool NavigationMesh::LoadBinary() {
+	const char*	data	= mapped.GetData();
+	size_t		size	= mapped.GetMappedSize();
 
-        bool operator<(const Node& other) const {
-            return fCost > other.fCost; // Reverse for priority queue
-        }
-    };
+	if (size < sizeof(NavMeshFileHeader)) {
+		return false;
+	}
+	const NavMeshFileHeader* header = (const NavMeshFileHeader*)data;
+	if (header->version != NavMeshFileHeader::VERSION) {
+		std::cout << "Navmesh is version " << header->version << ", expected " << NavMeshFileHeader::VERSION << std::endl;
+		return false;
+	}
+	//Every lookup divides by the cell size, so it has to be something real
+	if (!std::isfinite(header->cellSize) || header->cellSize <= 0.0f ||
+		!std::isfinite(header->indexOriginX) || !std::isfinite(header->indexOriginZ)) {
+		return false;
+	}
+	uint64_t cellCount = (uint64_t)header->cellsWide * header->cellsDeep;
+	if (cellCount > INT_MAX ||
+		header->vertexCount > INT_MAX || header->triCount > INT_MAX ||
+		!SectionFits(header->vertexOffset, header->vertexCount, sizeof(Vector3), size) ||
+		!SectionFits(header->triOffset, header->triCount, sizeof(NavTri), size) ||
+		!SectionFits(header->cellStartOffset, cellCount + 1, sizeof(int32_t), size) ||
+		!SectionFits(header->cellTrisOffset, header->cellTriCount, sizeof(int32_t), size)) {
+		return false;
+	}
+	int vertexCount	= (int)header->vertexCount;
+	int triCount	= (int)header->triCount;
 
-    auto Heuristic = [](const Vector3& a, const Vector3& b) -> float {
-		return Vector::Length(a - b);
-        };
+	std::span<const NavTri>	tris((const NavTri*)(data + header->triOffset), triCount);
+	std::span<const int>	starts((const int*)(data + header->cellStartOffset), (size_t)cellCount + 1);
+	std::span<const int>	cells((const int*)(data + header->cellTrisOffset), header->cellTriCount);
 
-    std::priority_queue<Node> openSet;
-    std::unordered_map<const NavTri*, float> gScore;
-    std::unordered_map<const NavTri*, const Node*> nodeMap;
+	for (const NavTri& t : tris) {
+		for (int j = 0; j < 3; ++j) {
+			if (t.indices[j] < 0 || t.indices[j] >= vertexCount || t.neighbours[j] < -1 || t.neighbours[j] >= triCount) {
+				Clear();
+				return false;
+			}
+		}
+	}
+	bool valid = starts.front() == 0 && starts.back() == (int)cells.size();
+	for (size_t i = 1; valid && i < starts.size(); ++i) {
+		valid = starts[i] >= starts[i - 1];
+	}
+	for (size_t i = 0; valid && i < cells.size(); ++i) {
+		valid = cells[i] >= 0 && cells[i] < triCount;
+	}
+	if (!valid) {
+		Clear();
+		return false;
+	}
 
-    Node startNode(startTri, 0.0f, Heuristic(startTri->centroid, endTri->centroid), nullptr);
-    openSet.push(startNode);
-    gScore[startTri] = 0.0f;
-    nodeMap[startTri] = &startNode;
+	allVerts	= std::span<const Vector3>((const Vector3*)(data + header->vertexOffset), vertexCount);
+	allTris		= tris;
+	cellStart	= starts;
+	cellTris	= cells;
 
-    while (!openSet.empty()) {
-        Node current = openSet.top();
-        openSet.pop();
+	indexOrigin	= Vector3(header->indexOriginX, 0.0f, header->indexOriginZ);
+	cellSize	= header->cellSize;
+	cellsWide	= (int)header->cellsWide;
+	cellsDeep	= (int)header->cellsDeep;
+	return true;
+}
 
-        if (current.tri == endTri) {
-            // Reconstruct the path
-            const Node* pathNode = &current;
-            std::vector<Vector3> waypoints;
+bool NavigationMesh::SaveBinary(const std::string& filename) const {
+	NavMeshFileHeader header;
+	memcpy(header.magic, NAVMESH_FILE_MAGIC, sizeof(NAVMESH_FILE_MAGIC));
+	header.version		= NavMeshFileHeader::VERSION;
+	header.vertexCount	= (uint32_t)allVerts.size();
+	header.triCount		= (uint32_t)allTris.size();
+	header.indexOriginX	= indexOrigin.x;
+	header.indexOriginZ	= indexOrigin.z;
+	header.cellSize		= cellSize;
+	header.cellsWide	= (uint32_t)cellsWide;
+	header.cellsDeep	= (uint32_t)cellsDeep;
+	header.cellTriCount	= (uint32_t)cellTris.size();
+
+	//An empty mesh has no index at all, but still needs the one past the end
+	std::vector<int32_t> starts(cellStart.begin(), cellStart.end());
+	if (starts.empty()) {
+		header.cellsWide = 0;
+		header.cellsDeep = 0;
+		starts.push_back(0);
+	}
 
-            while (pathNode != nullptr) {
-                waypoints.emplace_back(pathNode->tri->centroid);
-                pathNode = pathNode->parent;
-            }
+	header.vertexOffset		= AlignNavSection(sizeof(NavMeshFileHeader));
+	header.triOffset		= AlignNavSection(header.vertexOffset + allVerts.size_bytes());
+	header.cellStartOffset	= AlignNavSection(header.triOffset + allTris.size_bytes());
+	header.cellTrisOffset	= AlignNavSection(header.cellStartOffset + starts.size() * sizeof(int32_t));
+	size_t size				= (size_t)(header.cellTrisOffset + cellTris.size_bytes());
 
-            std::reverse(waypoints.begin(), waypoints.end());
+	MappedFile file;
+	if (!file.OpenWrite(Assets::DATADIR + filename, size)) {
+		std::cout << "Couldn't open " << filename << " to save the navmesh to" << std::endl;
+		return false;
+	}
+	char* data = file.GetData();
+	memset(data, 0, size);
+	memcpy(data, &header, sizeof(header));
 
-            for (const Vector3& waypoint : waypoints) {
-                outPath.PushWaypoint(waypoint);
-            }
+	//Everything goes in exactly as it is in memory, ready to be used in place
+	if (!allVerts.empty()) {
+		memcpy(data + header.vertexOffset, allVerts.data(), allVerts.size_bytes());
+	}
+	if (!allTris.empty()) {
+		memcpy(data + header.triOffset, allTris.data(), allTris.size_bytes());
+	}
+	memcpy(data + header.cellStartOffset, starts.data(), starts.size() * sizeof(int32_t));
+	if (!cellTris.empty()) {
+		memcpy(data + header.cellTrisOffset, cellTris.data(), cellTris.size_bytes());
+	}
+	file.Close(size);
+	return true;
+}
 
-            return true;
-        }
+void NavigationMesh::Clear() {
+	allTris		= {};
+	allVerts	= {};
+	cellStart	= {};
+	cellTris	= {};
+	builtTris.clear();
+	builtVerts.clear();
+	builtCellStart.clear();
+	builtCellTris.clear();
+	mapped.Close();
+	cellsWide = 0;
+	cellsDeep = 0;
+}
 
-        for (int i = 0; i < 3; ++i) {
-            const NavTri* neighbor = current.tri->neighbours[i];
+void NavigationMesh::BuildTriangle(NavTri& t) {
+	const Vector3& a = builtVerts[t.indices[0]];
+	const Vector3& b = builtVerts[t.indices[1]];
+	const Vector3& c = builtVerts[t.indices[2]];
 
-            if (!neighbor) {
-                continue;
-            }
+	t.centroid	= (a + b + c) / 3.0f;
+	t.triPlane	= Plane::PlaneFromTri(a, b, c);
+	t.area		= Maths::AreaofTri3D(a, b, c);
+}
 
-            float tentativeGScore = gScore[current.tri] + Heuristic(current.tri->centroid, neighbor->centroid);
+//Neighbour j is across the edge from corner j to corner j + 1
+void NavigationMesh::FindNeighbours() {
+	std::unordered_map<uint64_t, int> edges; //from the lower vertex index to the higher, to the first triangle along it
+	for (int i = 0; i < (int)builtTris.size(); ++i) {
+		NavTri& t = builtTris[i];
+		for (int j = 0; j < 3; ++j) {
+			int a = t.indices[j];
+			int b = t.indices[(j + 1) % 3];
+			uint64_t key = ((uint64_t)std::min(a, b) << 32) | (uint32_t)std::max(a, b);
+
+			auto found = edges.find(key);
+			if (found == edges.end()) {
+				edges.emplace(key, i);
+				continue;
+			}
+			NavTri& other = builtTris[found->second];
+			for (int k = 0; k < 3; ++k) {
+				int oa = other.indices[k];
+				int ob = other.indices[(k + 1) % 3];
+				if ((oa == a && ob == b) || (oa == b && ob == a)) {
+					other.neighbours[k] = i;
+				}
+			}
+			t.neighbours[j] = found->second;
+		}
+	}
+}
 
-            if (gScore.find(neighbor) == gScore.end() || tentativeGScore < gScore[neighbor]) {
-                gScore[neighbor] = tentativeGScore;
-                float hCost = Heuristic(neighbor->centroid, endTri->centroid);
-                Node neighborNode(neighbor, tentativeGScore, hCost, nodeMap[current.tri]);
+bool NavigationMesh::FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) {
+	return FindPath(from, to, outPath, scratch);
+}
 
-                openSet.push(neighborNode);
-                nodeMap[neighbor] = &neighborNode;
-            }
-        }
-    }
+/*
+A* over the triangles, by index, with everything it works out kept in the
+scratch rather than allocated per query. Moving from one triangle to the
+next costs the distance between their centroids, which is also what the
+heuristic measures to the goal.
+*/
+bool NavigationMesh::FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath, GridSearchScratch& scratch) const {
+	const NavTri* startTri	= GetTriForPosition(from);
+	const NavTri* endTri	= GetTriForPosition(to);
+
+	if (!startTri || !endTri) {
+		return false; // No valid triangles for the start or end positions
+	}
+	int startIndex	= GetTriIndex(startTri);
+	int endIndex	= GetTriIndex(endTri);
+	const Vector3& goal = endTri->centroid;
+
+	scratch.Begin((int)allTris.size());
+	scratch.g[startIndex]		= 0.0f;
+	scratch.parent[startIndex]	= -1;
+	scratch.seen[startIndex]	= scratch.generation;
+	scratch.open.Push(startIndex, Vector::Length(startTri->centroid - goal));
+
+	while (!scratch.open.IsEmpty()) {
+		int current = scratch.open.Pop();
+		scratch.closed[current] = scratch.generation;
+		scratch.expanded++;
+
+		if (current == endIndex) {
+			if (!smoothPaths) {
+				for (int node = endIndex; node >= 0; node = scratch.parent[node]) {
+					outPath.PushWaypoint(allTris[node].centroid); // build up the path from the end
+				}
+				return true;
+			}
+			scratch.route.clear();
+			for (int node = endIndex; node >= 0; node = scratch.parent[node]) {
+				scratch.route.emplace_back(node); //goal first, the same way the path is built
+			}
+			StringPull(from, to, scratch.route, outPath);
+			return true;
+		}
+		const NavTri& tri = allTris[current];
+		float g = scratch.g[current];
+
+		for (int i = 0; i < 3; ++i) {
+			int next = tri.neighbours[i];
+			if (next < 0 || scratch.IsClosed(next)) {
+				continue;
+			}
+			const NavTri& neighbour = allTris[next];
+			float nextG = g + Vector::Length(neighbour.centroid - tri.centroid);
+			if (scratch.IsSeen(next) && nextG >= scratch.g[next]) {
+				continue;
+			}
+			scratch.seen[next]		= scratch.generation;
+			scratch.g[next]			= nextG;
+			scratch.parent[next]	= current;
+			scratch.open.Push(next, nextG + Vector::Length(neighbour.centroid - goal));
+		}
+	}
+	return false; // No path found
+}
 
-    return false; // No path found
+//The edge two neighbouring triangles share, with its ends named for
+//which side they're on when crossing it from the first into the second.
+//That's worked out from the first triangle's centroid rather than its
+//winding, so it doesn't matter which way round the mesh was wound.
+void NavigationMesh::GetPortal(int fromTri, int toTri, Vector3& left, Vector3& right) const {
+	const NavTri& t = allTris[fromTri];
+	for (int i = 0; i < 3; ++i) {
+		if (t.neighbours[i] != toTri) {
+			continue;
+		}
+		const Vector3& a = allVerts[t.indices[i]];
+		const Vector3& b = allVerts[t.indices[(i + 1) % 3]];
+		if (TriArea2D(t.centroid, a, b) > 0.0f) {
+			left	= a;
+			right	= b;
+		}
+		else {
+			left	= b;
+			right	= a;
+		}
+		return;
+	}
 }
 
 /*
-If you have triangles on top of triangles in a full 3D environment, you'll need to change this slightly,
-as it is currently ignoring height. You might find tri/plane raycasting is handy.
+Pulls the path tight through the triangles the search went through,
+leaving only the corners it has to turn at - the 'simple stupid funnel'.
+The funnel is the two lines from the last corner to either end of the
+edges crossed so far. Each new edge narrows it, until an edge end would
+cross over to the far side, and that side's end becomes the next corner.
+
+The funnel runs from the goal back to the start, so the corners come out
+in the order a path wants pushing them in, and the route is the search's
+own goal-first walk back along the parents.
 */
+void NavigationMesh::StringPull(const Vector3& from, const Vector3& to, const std::vector<int>& route, NavigationPath& outPath) const {
+	int portalCount = (int)route.size(); //the last is the start point on its own
+
+	Vector3 apex		= to;
+	Vector3 portalLeft	= to;
+	Vector3 portalRight	= to;
+	int apexIndex	= -1;
+	int leftIndex	= -1;
+	int rightIndex	= -1;
+
+	outPath.PushWaypoint(to);
+
+	for (int i = 0; i < portalCount; ++i) {
+		Vector3 left;
+		Vector3 right;
+		if (i < portalCount - 1) {
+			GetPortal(route[i], route[i + 1], left, right);
+		}
+		else {
+			left	= from;
+			right	= from;
+		}
 
-const NavigationMesh::NavTri* NavigationMesh::GetTriForPosition(const Vector3& pos) const {
-	for (const NavTri& t : allTris) {
-		Vector3 planePoint = t.triPlane.ProjectPointOntoPlane(pos);
-
-		float ta = Maths::AreaofTri3D(allVerts[t.indices[0]], allVerts[t.indices[1]], planePoint);
-		float tb = Maths::AreaofTri3D(allVerts[t.indices[1]], allVerts[t.indices[2]], planePoint);
-		float tc = Maths::AreaofTri3D(allVerts[t.indices[2]], allVerts[t.indices[0]], planePoint);
+		if (TriArea2D(apex, portalRight, right) <= 0.0f) {
+			if (SamePoint(apex, portalRight) || TriArea2D(apex, portalLeft, right) > 0.0f) {
+				portalRight	= right; //tightens the funnel
+				rightIndex	= i;
+			}
+			else { //crosses over the left, so that's a corner
+				apex		= portalLeft;
+				apexIndex	= leftIndex;
+				outPath.PushWaypoint(apex);
+
+				portalLeft	= apex;
+				portalRight	= apex;
+				leftIndex	= apexIndex;
+				rightIndex	= apexIndex;
+				i			= apexIndex; //and start again from it
+				continue;
+			}
+		}
+		if (TriArea2D(apex, portalLeft, left) >= 0.0f) {
+			if (SamePoint(apex, portalLeft) || TriArea2D(apex, portalRight, left) < 0.0f) {
+				portalLeft	= left;
+				leftIndex	= i;
+			}
+			else {
+				apex		= portalRight;
+				apexIndex	= rightIndex;
+				outPath.PushWaypoint(apex);
+
+				portalLeft	= apex;
+				portalRight	= apex;
+				leftIndex	= apexIndex;
+				rightIndex	= apexIndex;
+				i			= apexIndex;
+				continue;
+			}
+		}
+	}
+	if (!SamePoint(apex, from)) {
+		outPath.PushWaypoint(from);
+	}
+}
 
-		float areaSum = ta + tb + tc;
+//Buckets every triangle into the cells of a flat grid over the XZ plane
+//that its bounds overlap. Cells are sized so there are only a few
+//triangles in each, so finding the triangle under a point only has to
+//test those in the one cell it lands in.
+void NavigationMesh::BuildSpatialIndex() {
+	builtCellStart.clear();
+	builtCellTris.clear();
+	if (builtTris.empty()) {
+		return;
+	}
+	Vector3 boundsMin(FLT_MAX, 0.0f, FLT_MAX);
+	Vector3 boundsMax(-FLT_MAX, 0.0f, -FLT_MAX);
+	for (const NavTri& t : builtTris) {
+		for (int i = 0; i < 3; ++i) {
+			const Vector3& v = builtVerts[t.indices[i]];
+			boundsMin.x = std::min(boundsMin.x, v.x);
+			boundsMin.z = std::min(boundsMin.z, v.z);
+			boundsMax.x = std::max(boundsMax.x, v.x);
+			boundsMax.z = std::max(boundsMax.z, v.z);
+		}
+	}
+	float width		= std::max(boundsMax.x - boundsMin.x, 0.001f);
+	float depth		= std::max(boundsMax.z - boundsMin.z, 0.001f);
+	cellSize		= std::max(sqrtf(width * depth / builtTris.size()) * 2.0f, 0.001f);
+	cellsWide		= std::min((int)(width / cellSize) + 1, 4096);
+	cellsDeep		= std::min((int)(depth / cellSize) + 1, 4096);
+	cellSize		= std::max(width / (cellsWide - 0.5f), depth / (cellsDeep - 0.5f)); //stretched to cover it all, with room at the far edge
+	indexOrigin		= boundsMin;
+
+	//Counted first, then filled in, so it's all in one flat array
+	auto forEachCell = [&](const NavTri& t, auto&& func) {
+		float minX = FLT_MAX, minZ = FLT_MAX, maxX = -FLT_MAX, maxZ = -FLT_MAX;
+		for (int i = 0; i < 3; ++i) {
+			const Vector3& v = builtVerts[t.indices[i]];
+			minX = std::min(minX, v.x);
+			minZ = std::min(minZ, v.z);
+			maxX = std::max(maxX, v.x);
+			maxZ = std::max(maxZ, v.z);
+		}
+		int x0 = std::clamp((int)((minX - indexOrigin.x) / cellSize), 0, cellsWide - 1);
+		int x1 = std::clamp((int)((maxX - indexOrigin.x) / cellSize), 0, cellsWide - 1);
+		int z0 = std::clamp((int)((minZ - indexOrigin.z) / cellSize), 0, cellsDeep - 1);
+		int z1 = std::clamp((int)((maxZ - indexOrigin.z) / cellSize), 0, cellsDeep - 1);
+		for (int z = z0; z <= z1; ++z) {
+			for (int x = x0; x <= x1; ++x) {
+				func(z * cellsWide + x);
+			}
+		}
+	};
+	builtCellStart.assign(cellsWide * cellsDeep + 1, 0);
+	for (const NavTri& t : builtTris) {
+		forEachCell(t, [&](int cell) {
+			builtCellStart[cell + 1]++;
+		});
+	}
+	for (int i = 0; i < cellsWide * cellsDeep; ++i) {
+		builtCellStart[i + 1] += builtCellStart[i];
+	}
+	builtCellTris.resize(builtCellStart.back());
+	std::vector<int> filled(builtCellStart.begin(), builtCellStart.end() - 1);
+	for (int i = 0; i < (int)builtTris.size(); ++i) {
+		forEachCell(builtTris[i], [&](int cell) {
+			builtCellTris[filled[cell]++] = i;
+		});
+	}
+}
 
-		if (abs(areaSum - t.area)  > 0.001f) { //floating points are annoying! Are we more or less inside the triangle?
+/*
+Looks through the triangles in the cell the point lands in, testing
+each with barycentric coordinates on the XZ plane. Where floors are
+stacked on top of each other, more than one can contain the point, and
+the one whose surface is closest to its height wins.
+*/
+const NavigationMesh::NavTri* NavigationMesh::GetTriForPosition(const Vector3& pos) const {
+	if (cellStart.empty()) {
+		return nullptr;
+	}
+	//Range checked before they're made ints, so points miles away can't overflow
+	float cellX = floorf((pos.x - indexOrigin.x) / cellSize);
+	float cellZ = floorf((pos.z - indexOrigin.z) / cellSize);
+	if (!(cellX >= 0.0f && cellZ >= 0.0f && cellX < (float)cellsWide && cellZ < (float)cellsDeep)) {
+		return nullptr;
+	}
+	int x = (int)cellX;
+	int z = (int)cellZ;
+	const float EDGE_TOLERANCE = 0.0001f; //so points right on a shared edge still land somewhere
+
+	const NavTri*	best		= nullptr;
+	float			bestHeight	= FLT_MAX;
+
+	int cell = z * cellsWide + x;
+	for (int i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+		const NavTri& t = allTris[cellTris[i]];
+		const Vector3& a = allVerts[t.indices[0]];
+		const Vector3& b = allVerts[t.indices[1]];
+		const Vector3& c = allVerts[t.indices[2]];
+
+		float denominator = (b.z - c.z) * (a.x - c.x) + (c.x - b.x) * (a.z - c.z);
+		if (fabsf(denominator) < 1e-8f) {
+			continue; //a wall, edge on from above
+		}
+		float u = ((b.z - c.z) * (pos.x - c.x) + (c.x - b.x) * (pos.z - c.z)) / denominator;
+		float v = ((c.z - a.z) * (pos.x - c.x) + (a.x - c.x) * (pos.z - c.z)) / denominator;
+		float w = 1.0f - u - v;
+		if (u < -EDGE_TOLERANCE || v < -EDGE_TOLERANCE || w < -EDGE_TOLERANCE) {
 			continue;
 		}
-		return &t;
+		float height = fabsf(u * a.y + v * b.y + w * c.y - pos.y);
+		if (height < bestHeight) {
+			best		= &t;
+			bestHeight	= height;
+		}
 	}
-	return nullptr;
-}
\ No newline at end of file
+	return best;
+}
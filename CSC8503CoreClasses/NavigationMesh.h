@@ -1,6 +1,9 @@
 #pragma once
 #include "NavigationMap.h"
 #include "Plane.h"
+#include "NodeHeap.h"
+#include "MappedFile.h"
+#include <span>
 #include <string>
 #include <vector>
 namespace NCL {
@@ -8,19 +11,22 @@ namespace NCL {
 		class NavigationMesh : public NavigationMap	{
 		public:
 		public:
+			//Laid out the same as in the binary files, which are used right
+			//where they're mapped, so everything refers to other triangles
+			//and vertices by index
 			struct NavTri {  // Move NavTri to public scope
 				Plane   triPlane;
 				Vector3 centroid;
 				float	area;
-				NavTri* neighbours[3];
+				int		neighbours[3]; //across the edge from corner j to j + 1, -1 for none
 
 				int indices[3];
 
 				NavTri() {
 					area = 0.0f;
-					neighbours[0] = nullptr;
-					neighbours[1] = nullptr;
-					neighbours[2] = nullptr;
+					neighbours[0] = -1;
+					neighbours[1] = -1;
+					neighbours[2] = -1;
 
 					indices[0] = -1;
 					indices[1] = -1;
@@ -29,19 +35,78 @@ namespace NCL {
 			};
 
 			NavigationMesh();
+			//Either the text format or the binary one SaveBinary writes
 			NavigationMesh(const std::string& filename);
+			//Three indices a triangle, with neighbours found from the edges they share
+			NavigationMesh(const std::vector<Vector3>& vertices, const std::vector<int>& indices);
 			~NavigationMesh();
 
+			//A loaded mesh points into its mapping, so it can't be copied
+			NavigationMesh(const NavigationMesh&) = delete;
+			NavigationMesh& operator=(const NavigationMesh&) = delete;
+
 			bool FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) override;
 
-			const std::vector<NavTri>& GetTriangles() const { return allTris; }
+			//Doesn't change the mesh, so any number can run at once as long
+			//as each has its own scratch
+			bool FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath, GridSearchScratch& scratch) const;
+
+			int GetLastExpandedCount() const {
+				return scratch.expanded;
+			}
+
+			//On by default. Off, paths go from centroid to centroid of every
+			//triangle passed through instead.
+			void SetPathSmoothing(bool state) {
+				smoothPaths = state;
+			}
+
+			//Into the data directory, the same as the files it loads
+			bool SaveBinary(const std::string& filename) const;
+
+			std::span<const NavTri> GetTriangles() const { return allTris; }
 			const Vector3& GetVertex(int index) const { return allVerts[index]; }
 
 		protected:
 			const NavTri* GetTriForPosition(const Vector3& pos) const;
 
-			std::vector<NavTri>		allTris;
-			std::vector<Vector3>	allVerts;
+			int GetTriIndex(const NavTri* t) const {
+				return (int)(t - allTris.data());
+			}
+
+			void	BuildTriangle(NavTri& t);
+			void	FindNeighbours();
+			void	BuildSpatialIndex();
+			void	UseBuilt();
+			bool	LoadBinary();
+			void	Clear();
+
+			void	GetPortal(int fromTri, int toTri, Vector3& left, Vector3& right) const;
+			void	StringPull(const Vector3& from, const Vector3& to, const std::vector<int>& route, NavigationPath& outPath) const;
+
+			//Into the mapping for a binary file, or the built copies below
+			//for anything else
+			std::span<const NavTri>		allTris;
+			std::span<const Vector3>	allVerts;
+
+			//A flat grid over the XZ plane, each cell listing the triangles
+			//that overlap it, cell by cell in cellTris
+			Vector3					indexOrigin;
+			float					cellSize	= 1.0f;
+			int						cellsWide	= 0;
+			int						cellsDeep	= 0;
+			std::span<const int>	cellStart;	//one past the last cell, too
+			std::span<const int>	cellTris;
+
+			std::vector<NavTri>		builtTris;
+			std::vector<Vector3>	builtVerts;
+			std::vector<int>		builtCellStart;
+			std::vector<int>		builtCellTris;
+			MappedFile				mapped;
+
+			GridSearchScratch scratch; //for the NavigationMap version of FindPath
+
+			bool smoothPaths = true;
 		};
 	}
 }
\ No newline at end of file
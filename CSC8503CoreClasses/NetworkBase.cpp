@@ -1,10 +1,81 @@
 #include "NetworkBase.h"
+#include "NetworkObject.h"
+#include "LockstepSession.h"
+#include "EntityReplicator.h"
 #include "./enet/enet.h"
-NetworkBase::NetworkBase()	{
-	netHandle = nullptr;
+#include <chrono>
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	double NetworkClock() {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	//The peer belongs to whichever thread services the host, so everything
+	//the game wants from it is copied out here
+	NetworkEvent MakeEvent(const ENetEvent& event) {
+		NetworkEvent e;
+		e.type		= event.type;
+		e.peerID	= event.peer ? event.peer->incomingPeerID : -1;
+		e.packet	= event.packet;
+		if (event.peer) {
+			e.roundTripTime = event.peer->roundTripTime;
+			e.jitter		= event.peer->roundTripTimeVariance;
+			e.packetLoss	= event.peer->packetLoss / (float)ENET_PEER_PACKET_LOSS_SCALE;
+		}
+		return e;
+	}
+}
+
+NetworkBase::NetworkBase() : incoming(QUEUE_SIZE), outgoing(QUEUE_SIZE)	{
+	netHandle	= nullptr;
+	conditioner = nullptr;
+	sentCounterCount = 0;
+	for (int i = 0; i < Max_Messages; ++i) {
+		handlerCounts[i]	= 0;
+		minimumPayloads[i]	= GetMinimumPayload(i);
+	}
+	threadRunning		= false;
+	maxIncomingDepth	= 0;
+	averageServiceTime	= 0.0f;
+	worstServiceTime	= 0.0f;
+	droppedIncoming		= 0;
+	droppedStale		= 0;
+	maxOutgoingDepth	= 0;
+	averageQueueDelay	= 0.0f;
+	spilledOutgoing		= 0;
+	heldSnapshots		= 0;
 }
 
 NetworkBase::~NetworkBase()	{
+	//Derived classes should have stopped the thread already, as sending
+	//needs them - if not, anything left over is just thrown away
+	if (threadRunning) {
+		threadRunning = false;
+		networkThread.join();
+	}
+	OutgoingPacket out;
+	while (outgoing.TryPop(out)) {
+		enet_packet_destroy(out.packet);
+	}
+	NetworkEvent e;
+	while (incoming.TryPop(e)) {
+		enet_packet_destroy(e.packet);
+	}
+	for (const OutgoingPacket& o : outgoingSpill) {
+		enet_packet_destroy(o.packet);
+	}
+	for (const NetworkEvent& i : incomingSpill) {
+		enet_packet_destroy(i.packet);
+	}
+	if (conditioner) {
+		while (conditioner->ReleaseAny(out.packet, out.peerID, out.channel)) {
+			enet_packet_destroy(out.packet);
+		}
+		delete conditioner;
+	}
 	if (netHandle) {
 		enet_host_destroy(netHandle);
 	}
@@ -18,21 +89,321 @@ void NetworkBase::Destroy() {
 	enet_deinitialize();
 }
 
-bool NetworkBase::ProcessPacket(GamePacket* packet, int peerID) {
-	
-	PacketHandlerIterator firstHandler;
-	PacketHandlerIterator lastHandler;
+int NetworkBase::GetChannelForMessage(int type) {
+	switch (type) {
+		case Delta_State:
+		case Full_State:
+		case Received_State:
+		case Ack_State:
+		case Player_State:
+			return Channel_Snapshot;
+		//Each input packet resends every input the server hasn't acknowledged,
+		//so losing one costs nothing, and none are ever dropped as stale -
+		//the server's input queue puts them back in order and skips repeats
+		case Player_Input:
+			return Channel_Snapshot;
+		case Hello:
+		case Player_Connected:
+		case Player_Disconnected:
+		case Client_Connected:
+		case Client_Disconnected:
+		case Server_Connected:
+		case Server_Disconnected:
+		case Shutdown:
+		case Lockstep_Start:
+			return Channel_Control;
+		default:
+			return Channel_Events;
+	}
+}
+
+int NetworkBase::GetMinimumPayload(int type) {
+	switch (type) {
+		case String_Message:	return (int)(sizeof(StringPacket) - sizeof(GamePacket));
+		case Full_State:		return (int)(sizeof(FullPacket) - sizeof(GamePacket));
+		case Delta_State:		return (int)(sizeof(DeltaPacket) - sizeof(GamePacket));
+		case Player_State:		return (int)(sizeof(PlayerStatePacket) - sizeof(GamePacket));
+		case Raycast_Request:	return (int)(sizeof(RaycastRequestPacket) - sizeof(GamePacket));
+		case Player_Input:		return (int)(sizeof(ClientPacket) - sizeof(GamePacket) - sizeof(ClientPacket::older));
+		case Ack_State:			return (int)sizeof(int);
+		case Entity_Spawn:		return (int)sizeof(int);
+		case Entity_Despawn:	return (int)sizeof(int);
+		case Lockstep_Start:	return (int)(sizeof(LockstepStartPacket) - sizeof(GamePacket));
+		case Lockstep_Input:	return (int)(sizeof(LockstepInputPacket) - sizeof(GamePacket));
+		case Lockstep_Tick:		return (int)(sizeof(int) * 2);
+		//Connects and disconnects are made up locally from enet's events,
+		//with nothing after the header
+		default:				return 0;
+	}
+}
+
+ENetPacket* NetworkBase::CreatePacket(GamePacket& payload, int channel) {
+	enet_uint32 flags = channel == Channel_Snapshot ? ENET_PACKET_FLAG_UNSEQUENCED : ENET_PACKET_FLAG_RELIABLE;
+	return enet_packet_create(&payload, payload.GetTotalSize(), flags);
+}
+
+bool NetworkBase::DropIfStale(ENetEvent& event) {
+	if (event.type != ENET_EVENT_TYPE_RECEIVE || event.channelID != Channel_Snapshot) {
+		return false;
+	}
+	if (event.packet->dataLength < sizeof(GamePacket) || !IsStale(*(GamePacket*)event.packet->data, event.packet->dataLength)) {
+		return false;
+	}
+	enet_packet_destroy(event.packet);
+	droppedStale++;
+	return true;
+}
+
+bool NetworkBase::ProcessPacket(GamePacket* packet, int peerID, size_t length) {
+	if (length < sizeof(GamePacket) || (size_t)packet->GetTotalSize() > length) {
+		NET_LOG_ERROR(__FUNCTION__ << " Truncated packet from peer " << peerID);
+		return false;
+	}
+	int type = packet->type;
+	if (type < 0 || type >= Max_Messages || handlerCounts[type] == 0) {
+		NET_LOG_ERROR(__FUNCTION__ << " No handler for packet type " << type);
+		return false;
+	}
+	if (packet->size < minimumPayloads[type]) {
+		NET_LOG_ERROR(__FUNCTION__ << " Packet type " << type << " from peer " << peerID << " is too short to read");
+		return false;
+	}
+	NET_LOG_PACKET("Processing packet type " << type << " from peer " << peerID);
+
+	for (int i = 0; i < handlerCounts[type]; ++i) {
+		packetHandlers[type][i]->ReceivePacket(type, packet, peerID);
+	}
+	return true;
+}
+
+void NetworkBase::StartNetworkThread() {
+	if (threadRunning || !netHandle) {
+		return;
+	}
+	threadRunning = true;
+	networkThread = std::thread(&NetworkBase::NetworkThreadLoop, this);
+}
 
-	bool canHandle = GetPacketHandlers(packet->type, firstHandler, lastHandler) && firstHandler != lastHandler;
-	if (canHandle) {
-		
-		std::cout << "Processing packets" << std::endl;
-		for (auto i = firstHandler; i != lastHandler; ++i) {
-			i->second->ReceivePacket(packet->type, packet, peerID);
+void NetworkBase::StopNetworkThread() {
+	if (!threadRunning) {
+		return;
+	}
+	threadRunning = false;
+	networkThread.join();
+
+	//The host is ours again, so send anything still waiting and throw
+	//away anything the game never got round to reading
+	OutgoingPacket out;
+	while (outgoing.TryPop(out)) {
+		SendConditioned(out);
+	}
+	for (const OutgoingPacket& o : outgoingSpill) {
+		SendConditioned(o);
+	}
+	outgoingSpill.clear();
+
+	NetworkEvent e;
+	while (incoming.TryPop(e)) {
+		enet_packet_destroy(e.packet);
+	}
+	for (const NetworkEvent& i : incomingSpill) {
+		enet_packet_destroy(i.packet);
+	}
+	incomingSpill.clear();
+}
+
+void NetworkBase::SetPeerCount(int count) {
+	stats.Resize(count);
+	if (!threadRunning) {
+		sentCounters.reset(new SentCounter[count]);
+		sentCounterCount = count;
+	}
+}
+
+void NetworkBase::CountSent(int peerID, size_t bytes) {
+	if (peerID >= 0 && peerID < sentCounterCount) {
+		sentCounters[peerID].bytes.fetch_add((int)bytes, std::memory_order_relaxed);
+		sentCounters[peerID].packets.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void NetworkBase::CollectSent() {
+	for (int i = 0; i < sentCounterCount; ++i) {
+		int bytes	= sentCounters[i].bytes.exchange(0, std::memory_order_relaxed);
+		int packets = sentCounters[i].packets.exchange(0, std::memory_order_relaxed);
+		if (packets > 0) {
+			stats.RecordSent(i, bytes, packets);
 		}
-		return true;
 	}
-	std::cout << __FUNCTION__ << " No handler for packet type " << packet->type << std::endl;
+}
+
+NCL::CSC8503::LinkConditioner* NetworkBase::EnableLinkConditioner(unsigned int seed) {
+	if (!conditioner && !threadRunning) {
+		conditioner = new NCL::CSC8503::LinkConditioner(seed);
+	}
+	return conditioner;
+}
+
+void NetworkBase::SendConditioned(const OutgoingPacket& p) {
+	if (!conditioner) {
+		SendOutgoing(p);
+		return;
+	}
+	bool reliable = (p.packet->flags & ENET_PACKET_FLAG_RELIABLE) != 0;
+	if (!conditioner->Hold(p.packet, p.peerID, p.channel, reliable, NetworkClock())) {
+		enet_packet_destroy(p.packet);
+	}
+}
+
+void NetworkBase::ReleaseConditioned() {
+	if (!conditioner) {
+		return;
+	}
+	double now = NetworkClock();
+	OutgoingPacket out;
+	while (conditioner->Release(now, out.packet, out.peerID, out.channel)) {
+		SendOutgoing(out);
+	}
+}
+
+void NetworkBase::NetworkThreadLoop() {
+	ENetEvent event;
+	while (threadRunning) {
+		double start = NetworkClock();
+
+		OutgoingPacket out;
+		while (outgoing.TryPop(out)) {
+			SendConditioned(out);
+		}
+		ReleaseConditioned();
+		FlushIncomingSpill();
+		while (enet_host_service(netHandle, &event, 0) > 0) {
+			if (!DropIfStale(event)) {
+				PushIncoming(event);
+			}
+		}
+		float serviceTime = (float)(NetworkClock() - start);
+		averageServiceTime	= averageServiceTime + (serviceTime - averageServiceTime) * 0.05f;
+		worstServiceTime	= std::max((float)worstServiceTime, serviceTime);
+
+		//Sleep until the socket has something for us, but not so long that
+		//queued outgoing packets sit around
+		if (enet_host_service(netHandle, &event, 1) > 0 && !DropIfStale(event)) {
+			PushIncoming(event);
+		}
+	}
+}
+
+void NetworkBase::PushIncoming(ENetEvent& event) {
+	bool snapshot	= event.type == ENET_EVENT_TYPE_RECEIVE && event.channelID == Channel_Snapshot;
+	NetworkEvent e	= MakeEvent(event);
+	e.queuedAt		= NetworkClock();
+
+	//Snapshots don't need to stay in order, so they can go past anything
+	//that's waiting
+	if ((snapshot || incomingSpill.empty()) && incoming.TryPush(e)) {
+		maxIncomingDepth = std::max((size_t)maxIncomingDepth, incoming.Size());
+		return;
+	}
+	if (snapshot) {
+		enet_packet_destroy(e.packet); //game thread has fallen too far behind
+		droppedIncoming++;
+		return;
+	}
+	incomingSpill.push_back(e);
+}
+
+void NetworkBase::FlushIncomingSpill() {
+	while (!incomingSpill.empty() && incoming.TryPush(incomingSpill.front())) {
+		incomingSpill.pop_front();
+	}
+}
+
+void NetworkBase::FlushOutgoingSpill() {
+	while (!outgoingSpill.empty() && outgoing.TryPush(outgoingSpill.front())) {
+		outgoingSpill.pop_front();
+	}
+}
+
+void NetworkBase::PollEvents() {
+	if (!netHandle) {
+		return;
+	}
+	if (threadRunning) {
+		FlushOutgoingSpill(); //in case nothing has been sent since it filled up
+		double now = NetworkClock();
+		NetworkEvent e;
+		while (incoming.TryPop(e)) {
+			averageQueueDelay += ((float)(now - e.queuedAt) - averageQueueDelay) * 0.05f;
+			HandleEvent(e);
+			enet_packet_destroy(e.packet);
+		}
+		return;
+	}
+	ReleaseConditioned();
+
+	ENetEvent event;
+	while (enet_host_service(netHandle, &event, 0) > 0) {
+		if (DropIfStale(event)) {
+			continue;
+		}
+		NetworkEvent e = MakeEvent(event);
+		HandleEvent(e);
+		enet_packet_destroy(e.packet);
+	}
+}
+
+void NetworkBase::QueueOutgoing(ENetPacket* packet, int peerID, int channel) {
+	OutgoingPacket out;
+	out.packet	= packet;
+	out.peerID	= peerID;
+	out.channel = channel;
+
+	if (!threadRunning) {
+		SendConditioned(out);
+		return;
+	}
+	FlushOutgoingSpill();
 
+	if (outgoingSpill.empty() && outgoing.TryPush(out)) {
+		maxOutgoingDepth = std::max(maxOutgoingDepth, outgoing.Size());
+		return;
+	}
+	outgoingSpill.push_back(out);
+	spilledOutgoing++;
+}
+
+void NetworkBase::SetOutgoingQueueSize(size_t packets) {
+	if (threadRunning || packets <= outgoing.MaxSize()) {
+		return;
+	}
+	outgoing.SetCapacity(packets + 1);
+}
+
+bool NetworkBase::ReadyForSnapshot() {
+	if (!threadRunning) {
+		return true;
+	}
+	FlushOutgoingSpill();
+	if (outgoingSpill.empty()) {
+		return true;
+	}
+	heldSnapshots++;
 	return false;
-}
\ No newline at end of file
+}
+
+NetworkThreadStats NetworkBase::GetThreadStats() const {
+	NetworkThreadStats stats;
+	stats.incomingDepth			= incoming.Size();
+	stats.outgoingDepth			= outgoing.Size();
+	stats.maxIncomingDepth		= maxIncomingDepth;
+	stats.maxOutgoingDepth		= maxOutgoingDepth;
+	stats.averageServiceTime	= averageServiceTime;
+	stats.worstServiceTime		= worstServiceTime;
+	stats.averageQueueDelay		= averageQueueDelay;
+	stats.droppedIncoming		= droppedIncoming;
+	stats.spilledOutgoing		= spilledOutgoing;
+	stats.heldSnapshots			= heldSnapshots;
+	stats.droppedStale			= droppedStale;
+	return stats;
+}
@@ -4,10 +4,46 @@
 #include <string>
 #include <map>
 #include <iostream>
+#include <thread>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <cstring>
+#include <algorithm>
+
+#include "SPSCQueue.h"
+#include "LinkConditioner.h"
+#include "NetworkStats.h"
 
 struct _ENetHost;
 struct _ENetPeer;
 struct _ENetEvent;
+struct _ENetPacket;
+
+//0 = silent, 1 = errors, 2 = connection events, 3 = every packet. Levels
+//that are off still compile their message, so anything only worked out for
+//a log line isn't left unused, but it's never printed.
+#ifndef NET_LOG_LEVEL
+#define NET_LOG_LEVEL 1
+#endif
+
+#if NET_LOG_LEVEL >= 1
+#define NET_LOG_ERROR(msg) do { std::cerr << msg << std::endl; } while (0)
+#else
+#define NET_LOG_ERROR(msg) do { if (false) { std::cerr << msg; } } while (0)
+#endif
+
+#if NET_LOG_LEVEL >= 2
+#define NET_LOG_INFO(msg) do { std::cout << msg << std::endl; } while (0)
+#else
+#define NET_LOG_INFO(msg) do { if (false) { std::cout << msg; } } while (0)
+#endif
+
+#if NET_LOG_LEVEL >= 3
+#define NET_LOG_PACKET(msg) do { std::cout << msg << std::endl; } while (0)
+#else
+#define NET_LOG_PACKET(msg) do { if (false) { std::cout << msg; } } while (0)
+#endif
 
 enum BasicNetworkMessages {
 	None,
@@ -26,7 +62,29 @@ enum BasicNetworkMessages {
 	Player_Update,
 	Shutdown,
 
-	Ack_State // Added by me for acknowledgment packets
+	Ack_State, // Added by me for acknowledgment packets
+
+	Player_Input,	//client input with a sequence number
+	Player_State,	//server's state for a client's player, after a given input
+	Raycast_Request,//client shot, checked against the world as the client saw it
+
+	Lockstep_Start,	//server tells each client its slot and the shared seed
+	Lockstep_Input,	//a client's buttons for a future tick, plus a recent state hash
+	Lockstep_Tick,	//everyone's buttons for one tick, once they've all arrived
+
+	Entity_Spawn,	//a batch of new objects, each with its prefab and starting transform
+	Entity_Despawn,	//a batch of network IDs that have gone
+
+	Max_Messages	//must stay last, sizes the handler table
+};
+
+//Each kind of traffic gets its own enet channel, so a reliable packet that
+//needs resending only holds up packets on its own channel
+enum NetworkChannel {
+	Channel_Snapshot,	//unreliable and unsequenced, newest wins
+	Channel_Events,		//reliable and ordered, for things that happen once
+	Channel_Control,	//reliable, for connecting and shutting down
+	Channel_Count
 };
 
 struct GamePacket {
@@ -105,9 +163,41 @@ struct ServerConnectedPacket : public GamePacket {
 
 class PacketReceiver {
 public:
+	virtual ~PacketReceiver() {}
 	virtual void ReceivePacket(int type, GamePacket* payload, int source = -1) = 0;
 };
 
+//Something that happened on the enet host, handed over to the game thread
+struct NetworkEvent {
+	int				type	= 0;		//ENetEventType
+	int				peerID	= -1;
+	int				roundTripTime = 0;	//read from the peer on the thread that owns it
+	int				jitter	= 0;
+	float			packetLoss = 0.0f;
+	_ENetPacket*	packet	= nullptr;	//owned by whoever pops the event
+	double			queuedAt = 0.0;		//so we can see how long it sat waiting
+};
+
+struct OutgoingPacket {
+	_ENetPacket*	packet	= nullptr;
+	int				peerID	= -1;		//-1 to send to everyone
+	int				channel = Channel_Snapshot;
+};
+
+struct NetworkThreadStats {
+	size_t	incomingDepth		= 0;
+	size_t	outgoingDepth		= 0;
+	size_t	maxIncomingDepth	= 0;
+	size_t	maxOutgoingDepth	= 0;
+	float	averageServiceTime	= 0.0f;	//seconds per pass of the network thread
+	float	worstServiceTime	= 0.0f;
+	float	averageQueueDelay	= 0.0f;	//how long events wait before the game sees them
+	int		droppedIncoming		= 0;	//only ever snapshots, the rest wait for room
+	int		spilledOutgoing		= 0;	//packets that had to wait for room in the outgoing queue
+	int		heldSnapshots		= 0;	//snapshots put off until the outgoing queue had room
+	int		droppedStale		= 0;	//old snapshots thrown away on arrival
+};
+
 class NetworkBase	{
 public:
 	static void Initialise();
@@ -117,29 +207,159 @@ public:
 		return 1234;
 	}
 
-	void RegisterPacketHandler(int msgID, PacketReceiver* receiver) {
-		packetHandlers.insert(std::make_pair(msgID, receiver));
+	//Which channel a message goes out on if the sender doesn't say
+	static int GetChannelForMessage(int type);
+
+	//The fewest payload bytes (after the GamePacket header) a message of
+	//this type can have and still be read in place. Anything with a count
+	//only needs its fixed part, as the count is checked against the size.
+	static int GetMinimumPayload(int type);
+
+	//Handlers cast the payload straight to their packet struct, so a
+	//message type this class doesn't know about should say how much of it
+	//they read with minimumPayload
+	void RegisterPacketHandler(int msgID, PacketReceiver* receiver, int minimumPayload = 0) {
+		if (msgID < 0 || msgID >= Max_Messages || handlerCounts[msgID] == MAX_HANDLERS) {
+			NET_LOG_ERROR(__FUNCTION__ << " can't register handler for packet type " << msgID);
+			return;
+		}
+		packetHandlers[msgID][handlerCounts[msgID]++] = receiver;
+		minimumPayloads[msgID] = std::max(minimumPayloads[msgID], minimumPayload);
+	}
+
+	//Hands the enet host over to its own thread, so packets keep flowing
+	//however long the game's frames take. Once started, the host is only
+	//ever touched from that thread.
+	void StartNetworkThread();
+	void StopNetworkThread();
+
+	bool IsThreaded() const {
+		return threadRunning;
+	}
+
+	NetworkThreadStats GetThreadStats() const;
+
+	//Makes room for this many packets between the game and the network
+	//thread, which should be at least one tick's worth. Call it before
+	//starting the network thread.
+	void SetOutgoingQueueSize(size_t packets);
+
+	//False while packets are still waiting for room in the outgoing queue,
+	//in which case the caller should put its snapshot off until the next
+	//tick rather than pile another one on behind them
+	bool ReadyForSnapshot();
+
+	//Starts putting everything this end sends through a simulated link.
+	//Set this up before starting the network thread.
+	NCL::CSC8503::LinkConditioner* EnableLinkConditioner(unsigned int seed = 0);
+
+	NCL::CSC8503::LinkConditioner* GetLinkConditioner() const {
+		return conditioner;
+	}
+
+	//Per peer RTT, loss and traffic, only safe to read on the game thread
+	NCL::CSC8503::NetworkStats& GetStats() {
+		return stats;
+	}
+
+	const NCL::CSC8503::NetworkStats& GetStats() const {
+		return stats;
 	}
+
+	static const int MAX_HANDLERS = 4; //per message type
+	static const int QUEUE_SIZE = 4096;
 protected:
 	NetworkBase();
-	~NetworkBase();
+	virtual ~NetworkBase();
 
-	bool ProcessPacket(GamePacket* p, int peerID = -1);
+	//The packet is read in place, so length is how many bytes are actually
+	//behind it - anything claiming to be bigger, or too small to hold what
+	//its handlers read, is thrown away
+	bool ProcessPacket(GamePacket* p, int peerID = -1, size_t length = sizeof(GamePacket));
 
-	typedef std::multimap<int, PacketReceiver*>::const_iterator PacketHandlerIterator;
+	//Called on the game thread, either straight from enet or from the
+	//incoming queue, and passes each event to HandleEvent
+	void PollEvents();
 
-	bool GetPacketHandlers(int msgID, PacketHandlerIterator& first, PacketHandlerIterator& last) const {
-		auto range = packetHandlers.equal_range(msgID);
+	//Copies the packet into an enet packet flagged to suit the channel
+	static _ENetPacket* CreatePacket(GamePacket& payload, int channel);
 
-		if (range.first == packetHandlers.end()) {
-			return false; //no handlers for this message type!
-		}
-		first	= range.first;
-		last	= range.second;
-		return true;
+	//Sends straight away, or queues for the network thread if there is one
+	void QueueOutgoing(_ENetPacket* packet, int peerID, int channel);
+
+	//Lets a snapshot be thrown away as soon as it arrives, before it's
+	//queued or dispatched, if something newer has already been seen.
+	//Called on the network thread if there is one. Player inputs must never
+	//be dropped here, as the one that looks older may still be needed.
+	virtual bool IsStale(const GamePacket&, size_t) {
+		return false;
 	}
+	bool DropIfStale(_ENetEvent& event);
+
+	virtual void HandleEvent(const NetworkEvent& e) = 0;
+	virtual void SendOutgoing(const OutgoingPacket& p) = 0;
+
+	//How many peers traffic is counted for, by enet peer ID
+	void SetPeerCount(int count);
+	//Counts a packet once enet has taken it. Called on whichever thread
+	//sends, so it's only added to the stats by CollectSent.
+	void CountSent(int peerID, size_t bytes);
+	//Adds everything sent since last time to the stats, on the game thread
+	void CollectSent();
+
+	//Sends, or passes the packet to the link conditioner if there is one
+	void SendConditioned(const OutgoingPacket& p);
+	//Sends whatever the link conditioner has finished holding on to
+	void ReleaseConditioned();
+
+	void NetworkThreadLoop();
+	void PushIncoming(_ENetEvent& event);
+
+	//Moves whatever has been waiting for room into the queues, in order
+	void FlushIncomingSpill();
+	void FlushOutgoingSpill();
 
 	_ENetHost* netHandle;
 
-	std::multimap<int, PacketReceiver*> packetHandlers;
+	//Indexed directly by message type, so a lookup is just an array access
+	PacketReceiver*	packetHandlers[Max_Messages][MAX_HANDLERS];
+	int				handlerCounts[Max_Messages];
+	int				minimumPayloads[Max_Messages];
+
+	NCL::CSC8503::LinkConditioner* conditioner;
+	NCL::CSC8503::NetworkStats stats;
+
+	struct SentCounter {
+		std::atomic<int> bytes		= 0;
+		std::atomic<int> packets	= 0;
+	};
+	std::unique_ptr<SentCounter[]>	sentCounters;	//by peer, written by the sending thread
+	int								sentCounterCount;
+
+	std::thread			networkThread;
+	std::atomic<bool>	threadRunning;
+
+	NCL::CSC8503::SPSCQueue<NetworkEvent>	incoming;	//network thread -> game
+	NCL::CSC8503::SPSCQueue<OutgoingPacket>	outgoing;	//game -> network thread
+
+	//When a queue is full, incoming snapshots are dropped as a newer one
+	//will be along soon, but everything else waits here for the next pass.
+	//Nothing going out is dropped - ReadyForSnapshot holds the game back
+	//until the queue catches up instead. Each is only touched by the thread
+	//that pushes into its queue.
+	std::deque<NetworkEvent>	incomingSpill;
+	std::deque<OutgoingPacket>	outgoingSpill;
+
+	//Written by the network thread
+	std::atomic<size_t>	maxIncomingDepth;
+	std::atomic<float>	averageServiceTime;
+	std::atomic<float>	worstServiceTime;
+	std::atomic<int>	droppedIncoming;
+	std::atomic<int>	droppedStale;
+
+	//Written by the game thread
+	size_t	maxOutgoingDepth;
+	float	averageQueueDelay;
+	int		spilledOutgoing;
+	int		heldSnapshots;
 };
\ No newline at end of file
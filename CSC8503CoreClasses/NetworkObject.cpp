@@ -1,15 +1,19 @@
 #include "NetworkObject.h"
 #include "./enet/enet.h"
+
+#include <climits>
+#include <cmath>
+
 using namespace NCL;
 using namespace CSC8503;
 
 NetworkObject::NetworkObject(GameObject& o, int id)
-	: object(o), networkID(id), deltaErrors(0), fullErrors(0) {
-	std::cout << "Creating network object " << networkID << std::endl;
+	: object(o), interpolated(true), predicted(false), deltaErrors(0), fullErrors(0), networkID(id) {
+	NET_LOG_INFO("Creating network object " << networkID);
 }
 
 NetworkObject::~NetworkObject()	{
-	std::cout << "Deleting network object " << networkID << std::endl;
+	NET_LOG_INFO("Deleting network object " << networkID);
 }
 
 bool NetworkObject::ReadPacket(GamePacket& p) {
@@ -22,104 +26,131 @@ bool NetworkObject::ReadPacket(GamePacket& p) {
 	return false; //this isn't a packet we care about!
 }
 
-bool NetworkObject::WritePacket(GamePacket** p, bool deltaFrame, int stateID) {
-	if (deltaFrame) {
-		if (!WriteDeltaPacket(p, stateID)) {
-			return WriteFullPacket(p);
-		}
+void NetworkObject::RecordState(int stateID, float timeStamp) {
+	lastFullState.position		= object.GetTransform().GetPosition();
+	lastFullState.orientation	= object.GetTransform().GetOrientation();
+	lastFullState.stateID		= stateID;
+	lastFullState.timeStamp		= timeStamp;
+}
+
+bool NetworkObject::WritePacket(GamePacket** p, bool deltaFrame, int baseID) {
+	if (deltaFrame && WriteDeltaPacket(p, baseID)) {
+		return true;
 	}
 	return WriteFullPacket(p);
 }
 //Client objects recieve these packets
 bool NetworkObject::ReadDeltaPacket(DeltaPacket &p) {
-	if (p.fullID != lastFullState.stateID) {
+	NetworkState base;
+	if (!GetNetworkState(p.fullID, base)) {
 		return false; // can't delta this frame
 	}
+	//The server only moves a client's baseline forwards
 	UpdateStateHistory(p.fullID);
 
-	Vector3 fullPos = lastFullState.position;
-	Quaternion fullOrientation = lastFullState.orientation;
+	Vector3 fullPos = base.position;
+	Quaternion fullOrientation = base.orientation;
 
-	fullPos.x += p.pos[0];
-	fullPos.y += p.pos[1];
-	fullPos.z += p.pos[2];
+	fullPos.x += p.pos[0] / DeltaPacket::POSITION_SCALE;
+	fullPos.y += p.pos[1] / DeltaPacket::POSITION_SCALE;
+	fullPos.z += p.pos[2] / DeltaPacket::POSITION_SCALE;
 
-	fullOrientation.x += ((float)p.orientation[0]) / 127.0f;
-	fullOrientation.y += ((float)p.orientation[1]) / 127.0f;
-	fullOrientation.z += ((float)p.orientation[2]) / 127.0f;
-	fullOrientation.w += ((float)p.orientation[3]) / 127.0f;
+	fullOrientation.x += p.orientation[0] / DeltaPacket::ORIENTATION_SCALE;
+	fullOrientation.y += p.orientation[1] / DeltaPacket::ORIENTATION_SCALE;
+	fullOrientation.z += p.orientation[2] / DeltaPacket::ORIENTATION_SCALE;
+	fullOrientation.w += p.orientation[3] / DeltaPacket::ORIENTATION_SCALE;
+	fullOrientation.Normalise();
 
-	object.GetTransform().SetPosition(fullPos);
-	object.GetTransform().SetOrientation(fullOrientation);
+	ApplyState(fullPos, fullOrientation, p.timeStamp);
 	return true;
 }
 
 bool NetworkObject::ReadFullPacket(FullPacket &p) {
 	if (p.fullState.stateID < lastFullState.stateID) {
-		std::cout << "Out of order packet received" << std::endl;
+		NET_LOG_PACKET("Out of order packet received");
 		return false; //out of order packet
 	}
 	lastFullState = p.fullState;
 
-	object.GetTransform().SetPosition(lastFullState.position);
-	object.GetTransform().SetOrientation(lastFullState.orientation);
+	ApplyState(lastFullState.position, lastFullState.orientation, lastFullState.timeStamp);
 
-	stateHistory.emplace_back(lastFullState);
+	AddToStateHistory(lastFullState);
 
 	return true;
 }
 
-bool NetworkObject::WriteDeltaPacket(GamePacket**p, int stateID) {
-	DeltaPacket* dp = new DeltaPacket();
-	NetworkState state;
-	if (!GetNetworkState(stateID, state)) {
-		return false;
+//Received states go into the interpolation buffer rather than straight onto
+//the transform, so the object moves smoothly between network updates
+void NetworkObject::ApplyState(const Vector3& position, const Quaternion& orientation, float timeStamp) {
+	if (predicted) {
+		return;
 	}
+	if (!interpolated) {
+		object.GetTransform().SetPosition(position);
+		object.GetTransform().SetOrientation(orientation);
+		return;
+	}
+	interpolation.AddSnapshot(position, orientation, timeStamp);
+}
 
-	dp->fullID = stateID;
-	dp->objectID = networkID;
-
-	Vector3 currentPos = object.GetTransform().GetPosition();
-	Quaternion currentOrientation = object.GetTransform().GetOrientation();
-
-	currentPos -= state.position;
-	currentOrientation -= state.orientation;
-
-	/*dp->pos[0] = (char)currentPos.x;
-	dp->pos[1] = (char)currentPos.y;
-	dp->pos[2] = (char)currentPos.z;
-
-	dp->orientation[0] = (char)(currentOrientation.x * 127.0f);
-	dp->orientation[1] = (char)(currentOrientation.y * 127.0f);
-	dp->orientation[2] = (char)(currentOrientation.z * 127.0f);
-	dp->orientation[3] = (char)(currentOrientation.w * 127.0f);*/
-
-	Vector3 deltaPos = currentPos - state.position;
-	Quaternion deltaOrientation = currentOrientation - state.orientation;
-
-	dp->pos[0] = (short)(deltaPos.x * 1000);
-	dp->pos[1] = (short)(deltaPos.y * 1000);
-	dp->pos[2] = (short)(deltaPos.z * 1000);
+void NetworkObject::UpdateInterpolation(float dt) {
+	if (!interpolated) {
+		return;
+	}
+	Vector3		position;
+	Quaternion	orientation;
+	if (interpolation.Update(dt, position, orientation)) {
+		object.GetTransform().SetPosition(position);
+		object.GetTransform().SetOrientation(orientation);
+	}
+}
 
-	dp->orientation[0] = (short)(deltaOrientation.x * 1000);
-	dp->orientation[1] = (short)(deltaOrientation.y * 1000);
-	dp->orientation[2] = (short)(deltaOrientation.z * 1000);
-	dp->orientation[3] = (short)(deltaOrientation.w * 1000);
+namespace {
+	//False if the value won't fit, so a full state is sent instead
+	bool Quantise(float value, float scale, short& out) {
+		float scaled = value * scale;
+		if (scaled < SHRT_MIN || scaled > SHRT_MAX) {
+			return false;
+		}
+		out = (short)std::round(scaled);
+		return true;
+	}
+}
 
-	*p = dp;
+//Written from the state recorded for this snapshot, against the one the
+//client has acknowledged
+bool NetworkObject::WriteDeltaPacket(GamePacket**p, int baseID) {
+	NetworkState base;
+	if (!GetNetworkState(baseID, base)) {
+		return false;
+	}
+	Vector3 deltaPos = lastFullState.position - base.position;
+	Quaternion deltaOrientation = lastFullState.orientation - base.orientation;
+
+	DeltaPacket dp;
+	dp.fullID		= baseID;
+	dp.objectID		= networkID;
+	dp.timeStamp	= lastFullState.timeStamp;
+
+	const float s = DeltaPacket::POSITION_SCALE;
+	const float r = DeltaPacket::ORIENTATION_SCALE;
+	if (!Quantise(deltaPos.x, s, dp.pos[0]) || !Quantise(deltaPos.y, s, dp.pos[1]) || !Quantise(deltaPos.z, s, dp.pos[2]) ||
+		!Quantise(deltaOrientation.x, r, dp.orientation[0]) || !Quantise(deltaOrientation.y, r, dp.orientation[1]) ||
+		!Quantise(deltaOrientation.z, r, dp.orientation[2]) || !Quantise(deltaOrientation.w, r, dp.orientation[3])) {
+		return false;
+	}
+	*p = new DeltaPacket(dp);
 	return true;
 }
 
+//Every full state sent is kept, as the client may come back acknowledging it
 bool NetworkObject::WriteFullPacket(GamePacket**p) {
 	FullPacket* fp = new FullPacket();
 
 	fp->objectID = networkID;
-	fp->fullState.position = object.GetTransform().GetPosition();
-	fp->fullState.orientation = object.GetTransform().GetOrientation();
-	fp->fullState.stateID = lastFullState.stateID++;
-	std::cout << "Writing full packet for object " << networkID
-		<< "pos" << fp->fullState.position.x << "," << fp->fullState.position.y << "," << fp->fullState.position.z
-		<< "or" << fp->fullState.orientation.x << "," << fp->fullState.orientation.y << "," << fp->fullState.orientation.z << "," << fp->fullState.orientation.w << std::endl;
+	fp->fullState = lastFullState;
+	AddToStateHistory(lastFullState);
+	NET_LOG_PACKET("Writing full packet for object " << networkID);
 	*p = fp;
 	return true;
 }
@@ -140,6 +171,16 @@ bool NetworkObject::GetNetworkState(int stateID, NetworkState& state) {
 	return false;
 }
 
+void NetworkObject::AddToStateHistory(const NetworkState& state) {
+	if (!stateHistory.empty() && stateHistory.back().stateID == state.stateID) {
+		return; //already sent to another client, or received twice
+	}
+	if ((int)stateHistory.size() >= MAX_STATE_HISTORY) {
+		stateHistory.erase(stateHistory.begin());
+	}
+	stateHistory.emplace_back(state);
+}
+
 void NetworkObject::UpdateStateHistory(int minID) {
 	for (auto i = stateHistory.begin(); i != stateHistory.end();) {
 		if ((*i).stateID < minID) {
@@ -2,6 +2,9 @@
 #include "GameObject.h"
 #include "NetworkBase.h"
 #include "NetworkState.h"
+#include "InterpolationBuffer.h"
+
+#include <algorithm>
 
 namespace NCL::CSC8503 {
 	class GameObject;
@@ -17,11 +20,17 @@ namespace NCL::CSC8503 {
 		}
 	};
 
+	//The change since a full state the client has acknowledged, in fixed
+	//point. Anything too far from that state to fit goes as a full state.
 	struct DeltaPacket : public GamePacket {
+		static constexpr float POSITION_SCALE		= 1000.0f;	//millimetres, so up to 32m
+		static constexpr float ORIENTATION_SCALE	= 16000.0f;
+
 		int		fullID		= -1;
 		int		objectID	= -1;
-		char	pos[3];
-		char	orientation[4];
+		float	timeStamp	= 0.0f;
+		short	pos[3];
+		short	orientation[4];
 
 		DeltaPacket() {
 			type = Delta_State;
@@ -29,13 +38,109 @@ namespace NCL::CSC8503 {
 		}
 	};
 
+	//The newest full state the client has for each object that's had a new
+	//one since its last ack, which the server builds that object's deltas
+	//from. Only the entries in use are sent.
+	struct AckPacket : public GamePacket {
+		static constexpr int MAX_ACKS = 64;
+
+		struct ObjectAck {
+			int objectID;
+			int stateID;
+		};
+
+		int			count = 0;
+		ObjectAck	acks[MAX_ACKS];
+
+		AckPacket() {
+			type = Ack_State;
+			size = sizeof(int);
+		}
+
+		void Add(int objectID, int stateID) {
+			acks[count++] = { objectID, stateID };
+			size = (short)(sizeof(int) + count * sizeof(ObjectAck));
+		}
+
+		bool IsFull() const {
+			return count == MAX_ACKS;
+		}
+
+		int GetReceivedCount() const {
+			if (size < (short)sizeof(int)) {
+				return 0;
+			}
+			int fits = (int)((size - sizeof(int)) / sizeof(ObjectAck));
+			return std::clamp(count, 0, std::min(fits, MAX_ACKS));
+		}
+	};
+
+	//Inputs go out unreliably, so each packet also carries the ones before it
+	//the server hasn't acknowledged yet. Only those in use are sent.
 	struct ClientPacket : public GamePacket {
+		static constexpr int MAX_OLDER_INPUTS = 15;
+
+		struct OlderInput {
+			char	buttonstates[8];
+			float	duration;
+		};
+
 		int		lastID;
+		int		sequence;
 		char	buttonstates[8];
+		float	duration;	//how long the input was held for, as they're only sent once they're finished
+		int		olderCount;
+		OlderInput	older[MAX_OLDER_INPUTS];	//older[i] is input sequence - 1 - i
 
 		ClientPacket() {
-			type = Player_Update;
-			size = sizeof(ClientPacket) - sizeof(GamePacket);
+			type = Player_Input;
+			lastID	 = -1;
+			sequence = -1;
+			duration = 0.0f;
+			memset(buttonstates, 0, sizeof(buttonstates));
+			SetOlderCount(0);
+		}
+
+		void SetOlderCount(int n) {
+			olderCount	= n;
+			size		= (short)(sizeof(ClientPacket) - sizeof(GamePacket) - sizeof(older) + n * sizeof(OlderInput));
+		}
+
+		//How many older inputs a received packet really holds
+		int GetReceivedOlderCount() const {
+			int base = (int)(sizeof(ClientPacket) - sizeof(GamePacket) - sizeof(older));
+			if (size < base) {
+				return 0;
+			}
+			int fits = (size - base) / (int)sizeof(OlderInput);
+			return std::clamp(olderCount, 0, std::min(fits, MAX_OLDER_INPUTS));
+		}
+	};
+
+	struct PlayerStatePacket : public GamePacket {
+		int		objectID		= -1;
+		int		lastSequence	= -1;	//the newest client input applied to this state
+		float	heldFor			= 0.0f;	//how long it had been held for, which can be longer than the client held it
+		Vector3		position;
+		Quaternion	orientation;
+		Vector3		linearVelocity;
+		Vector3		angularVelocity;
+
+		PlayerStatePacket() {
+			type = Player_State;
+			size = sizeof(PlayerStatePacket) - sizeof(GamePacket);
+		}
+	};
+
+	struct RaycastRequestPacket : public GamePacket {
+		Vector3 origin;
+		Vector3 direction;
+		float	viewTime = 0.0f;	//server time the client was looking at when it fired
+		int		targetID = -1;		//network object the client thinks it hit
+
+		RaycastRequestPacket() {
+			type = Raycast_Request;
+			size = sizeof(RaycastRequestPacket) - sizeof(GamePacket);
 		}
 	};
 
@@ -46,11 +151,48 @@ namespace NCL::CSC8503 {
 
 		//Called by clients
 		virtual bool ReadPacket(GamePacket& p);
-		//Called by servers
-		virtual bool WritePacket(GamePacket** p, bool deltaFrame, int stateID);
+		//Called by servers once per snapshot, before any packets for it are
+		//written, so every client is sent the same state under the same ID
+		void RecordState(int stateID, float timeStamp);
+		//Called by servers. Deltas are built against baseID, the newest full
+		//state the client has acknowledged for this object.
+		virtual bool WritePacket(GamePacket** p, bool deltaFrame, int baseID);
+
+		//Called by clients every frame, moves the object along the received snapshots
+		void UpdateInterpolation(float dt);
+
+		void SetInterpolated(bool state) {
+			interpolated = state;
+		}
+
+		bool IsInterpolated() const {
+			return interpolated;
+		}
+
+		//Predicted objects are moved locally by the client, so snapshots
+		//for them only update the last known state
+		void SetPredicted(bool state) {
+			predicted = state;
+		}
+
+		bool IsPredicted() const {
+			return predicted;
+		}
+
+		const InterpolationBuffer& GetInterpolationBuffer() const {
+			return interpolation;
+		}
 
 		void UpdateStateHistory(int minID);
 
+		int GetNetworkID() const {
+			return networkID;
+		}
+
+		GameObject& GetGameObject() const {
+			return object;
+		}
+
 		Player* GetPlayer() const {
 			return associatedPlayer;
 		}
@@ -69,15 +211,27 @@ namespace NCL::CSC8503 {
 
 		
 
-		virtual bool WriteDeltaPacket(GamePacket**p, int stateID);
+		virtual bool WriteDeltaPacket(GamePacket**p, int baseID);
 		virtual bool WriteFullPacket(GamePacket**p);
 
+		//Keeps a full state sent or received to build deltas from
+		void AddToStateHistory(const NetworkState& state);
+
+		//Past this the oldest are let go, even if some client hasn't acked them
+		static const int MAX_STATE_HISTORY = 32;
+
+		void ApplyState(const Vector3& position, const Quaternion& orientation, float timeStamp);
+
 		GameObject& object;
 
 		NetworkState lastFullState;
 
 		std::vector<NetworkState> stateHistory;
 
+		InterpolationBuffer interpolation;
+		bool interpolated;
+		bool predicted;
+
 		int deltaErrors;
 		int fullErrors;
 
@@ -4,7 +4,8 @@ using namespace NCL;
 using namespace CSC8503;
 
 NetworkState::NetworkState()	{
-	stateID = 0;
+	stateID		= -1;
+	timeStamp	= 0.0f;
 }
 
 NetworkState::~NetworkState()	{
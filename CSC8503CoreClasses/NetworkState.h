@@ -11,7 +11,8 @@ namespace NCL {
 
 			Vector3		position;
 			Quaternion	orientation;
-			int			stateID;
+			int			stateID;	//-1 until one is recorded or received
+			float		timeStamp;	//server time the state was written at
 		};
 	}
 }
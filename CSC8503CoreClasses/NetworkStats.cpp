@@ -0,0 +1,194 @@
+#include "NetworkStats.h"
+#include "NetworkBase.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+NetworkStats::NetworkStats() {
+	startTime			= std::chrono::steady_clock::now();
+	lastSample			= startTime;
+	ticksSinceSample	= 0;
+}
+
+NetworkStats::~NetworkStats() {
+	StopCSV();
+}
+
+void NetworkStats::Resize(int peerCount) {
+	peers.resize(peerCount);
+}
+
+void NetworkStats::Connect(int peer) {
+	if (peer < 0) {
+		return;
+	}
+	if (peer >= (int)peers.size()) {
+		peers.resize(peer + 1);
+	}
+	peers[peer]			= PeerNetworkStats();
+	peers[peer].active	= true;
+}
+
+void NetworkStats::Disconnect(int peer) {
+	if (PeerNetworkStats* p = Find(peer)) {
+		p->active = false;
+	}
+}
+
+namespace {
+	//Servers count the snapshots they send, clients the ones they get
+	void RecordSnapshot(PeerNetworkStats& p, int type, int bytes) {
+		if (type == Delta_State) {
+			p.deltaSnapshots++;
+			p.tickSnapshotBytes += bytes;
+		}
+		else if (type == Full_State) {
+			p.fullSnapshots++;
+			p.tickSnapshotBytes += bytes;
+		}
+	}
+}
+
+void NetworkStats::RecordQueued(int peer, int type, int bytes) {
+	if (PeerNetworkStats* p = Find(peer)) {
+		RecordSnapshot(*p, type, bytes);
+	}
+}
+
+void NetworkStats::RecordSent(int peer, int bytes, int packets) {
+	if (PeerNetworkStats* p = Find(peer)) {
+		p->bytesSent	+= bytes;
+		p->packetsSent	+= packets;
+	}
+}
+
+void NetworkStats::RecordReceived(int peer, int type, int bytes) {
+	if (PeerNetworkStats* p = Find(peer)) {
+		p->bytesReceived += bytes;
+		p->packetsReceived++;
+		RecordSnapshot(*p, type, bytes);
+	}
+}
+
+void NetworkStats::UpdateLink(int peer, int roundTripTime, int jitter, float packetLoss) {
+	if (PeerNetworkStats* p = Find(peer)) {
+		p->roundTripTime	= roundTripTime;
+		p->jitter			= jitter;
+		p->packetLoss		= packetLoss;
+	}
+}
+
+void NetworkStats::EndTick() {
+	for (PeerNetworkStats& p : peers) {
+		if (!p.active || p.tickSnapshotBytes == 0) {
+			continue;
+		}
+		int bucket = std::min(p.tickSnapshotBytes / PeerNetworkStats::BUCKET_BYTES, PeerNetworkStats::HISTOGRAM_BUCKETS - 1);
+		p.snapshotHistogram[bucket]++;
+		p.intervalHistogram[bucket]++;
+		p.tickSnapshotBytes = 0;
+	}
+	ticksSinceSample++;
+
+	auto now = std::chrono::steady_clock::now();
+	float elapsed = std::chrono::duration<float>(now - lastSample).count();
+	if (elapsed >= 1.0f) {
+		lastSample = now;
+		Sample(elapsed);
+	}
+}
+
+void NetworkStats::Sample(float elapsed) {
+	float seconds = std::chrono::duration<float>(lastSample - startTime).count();
+
+	for (int i = 0; i < (int)peers.size(); ++i) {
+		PeerNetworkStats& p = peers[i];
+		if (!p.active) {
+			continue;
+		}
+		p.sendKbps					= p.bytesSent * 8.0f / 1000.0f / elapsed;
+		p.receiveKbps				= p.bytesReceived * 8.0f / 1000.0f / elapsed;
+		p.packetsSentPerTick		= p.packetsSent / (float)ticksSinceSample;
+		p.packetsReceivedPerTick	= p.packetsReceived / (float)ticksSinceSample;
+
+		if (csv.is_open()) {
+			csv << seconds << "," << i << "," << p.roundTripTime << "," << p.jitter << "," << p.packetLoss << ","
+				<< p.sendKbps << "," << p.receiveKbps << "," << p.packetsSentPerTick << "," << p.packetsReceivedPerTick << ","
+				<< p.GetDeltaHitRatio();
+			for (int b = 0; b < PeerNetworkStats::HISTOGRAM_BUCKETS; ++b) {
+				csv << "," << p.intervalHistogram[b];
+			}
+			csv << "\n";
+		}
+		p.bytesSent			= 0;
+		p.bytesReceived		= 0;
+		p.packetsSent		= 0;
+		p.packetsReceived	= 0;
+		for (int& b : p.intervalHistogram) {
+			b = 0;
+		}
+	}
+	ticksSinceSample = 0;
+	if (csv.is_open()) {
+		csv.flush(); //so a killed load test still leaves something behind
+	}
+}
+
+bool NetworkStats::StartCSV(const std::string& filename) {
+	StopCSV();
+	csv.open(filename, std::ios::out | std::ios::trunc);
+	if (!csv.is_open()) {
+		NET_LOG_ERROR("Couldn't open " << filename << " for network stats");
+		return false;
+	}
+	csv << "time,peer,rtt_ms,jitter_ms,loss,send_kbps,receive_kbps,packets_sent_per_tick,packets_received_per_tick,delta_hit_ratio";
+	for (int b = 0; b < PeerNetworkStats::HISTOGRAM_BUCKETS; ++b) {
+		csv << ",snapshot_" << b * PeerNetworkStats::BUCKET_BYTES;
+		if (b == PeerNetworkStats::HISTOGRAM_BUCKETS - 1) {
+			csv << "_plus";
+		}
+	}
+	csv << "\n";
+	return true;
+}
+
+void NetworkStats::StopCSV() {
+	if (csv.is_open()) {
+		csv.close();
+	}
+}
+
+float NetworkStats::GetTotalSendKbps() const {
+	float total = 0.0f;
+	for (const PeerNetworkStats& p : peers) {
+		total += p.active ? p.sendKbps : 0.0f;
+	}
+	return total;
+}
+
+float NetworkStats::GetTotalReceiveKbps() const {
+	float total = 0.0f;
+	for (const PeerNetworkStats& p : peers) {
+		total += p.active ? p.receiveKbps : 0.0f;
+	}
+	return total;
+}
+
+int NetworkStats::GetSnapshotPercentile(const PeerNetworkStats& peer, float fraction) {
+	int total = 0;
+	for (int count : peer.snapshotHistogram) {
+		total += count;
+	}
+	if (total == 0) {
+		return 0;
+	}
+	int needed	= (int)(total * fraction + 0.5f);
+	int seen	= 0;
+	for (int b = 0; b < PeerNetworkStats::HISTOGRAM_BUCKETS; ++b) {
+		seen += peer.snapshotHistogram[b];
+		if (seen >= needed) {
+			return (b + 1) * PeerNetworkStats::BUCKET_BYTES;
+		}
+	}
+	return PeerNetworkStats::HISTOGRAM_BUCKETS * PeerNetworkStats::BUCKET_BYTES;
+}
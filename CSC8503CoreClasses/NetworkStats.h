@@ -0,0 +1,109 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <chrono>
+
+namespace NCL::CSC8503 {
+	//What we know about one connection. Rates are worked out once a second,
+	//everything else is updated as it happens.
+	struct PeerNetworkStats {
+		static const int HISTOGRAM_BUCKETS	= 16;
+		static const int BUCKET_BYTES		= 128; //last bucket takes anything bigger
+
+		bool	active			= false;
+		int		roundTripTime	= 0;	//ms, as measured by enet
+		int		jitter			= 0;	//ms, enet's round trip variance
+		float	packetLoss		= 0.0f;	//0 - 1, enet's estimate
+
+		float	sendKbps				= 0.0f;
+		float	receiveKbps				= 0.0f;
+		float	packetsSentPerTick		= 0.0f;
+		float	packetsReceivedPerTick	= 0.0f;
+
+		//Bytes of snapshot sent to (or from) this peer in each tick, bucketed. The
+		//totals are kept for the overlay, the interval ones for the CSV.
+		int		snapshotHistogram[HISTOGRAM_BUCKETS]	= {};
+		int		intervalHistogram[HISTOGRAM_BUCKETS]	= {};
+
+		//Object states sent as deltas against an acked baseline, versus
+		//sent in full because there wasn't one (or it was a full frame)
+		int		deltaSnapshots	= 0;
+		int		fullSnapshots	= 0;
+
+		float GetDeltaHitRatio() const {
+			int total = deltaSnapshots + fullSnapshots;
+			return total > 0 ? deltaSnapshots / (float)total : 0.0f;
+		}
+
+		//Accumulated until the next sample, or tick for the snapshot bytes
+		int		bytesSent			= 0;
+		int		bytesReceived		= 0;
+		int		packetsSent			= 0;
+		int		packetsReceived		= 0;
+		int		tickSnapshotBytes	= 0;
+	};
+
+	/*
+	Per peer traffic and link quality, gathered on the game thread as
+	packets are sent and handled. The server has one entry per enet peer,
+	a client just the one for its server. Owners call EndTick once per game
+	tick, which also takes the once a second sample and, if one's open,
+	writes it to a CSV file for looking at load tests afterwards.
+	*/
+	class NetworkStats {
+	public:
+		NetworkStats();
+		~NetworkStats();
+
+		void Resize(int peerCount);
+
+		void Connect(int peer);
+		void Disconnect(int peer);
+
+		//What the game asked to send, for the snapshot sizes and delta
+		//ratio, and what enet actually took, for the traffic rates
+		void RecordQueued(int peer, int type, int bytes);
+		void RecordSent(int peer, int bytes, int packets);
+		void RecordReceived(int peer, int type, int bytes);
+		void UpdateLink(int peer, int roundTripTime, int jitter, float packetLoss);
+
+		void EndTick();
+
+		//Appends a row per connected peer every sample. Returns false if
+		//the file couldn't be opened.
+		bool StartCSV(const std::string& filename);
+		void StopCSV();
+
+		int GetPeerCount() const {
+			return (int)peers.size();
+		}
+
+		const PeerNetworkStats* GetPeer(int peer) const {
+			return (peer >= 0 && peer < (int)peers.size() && peers[peer].active) ? &peers[peer] : nullptr;
+		}
+
+		//Totals across every connected peer
+		float GetTotalSendKbps() const;
+		float GetTotalReceiveKbps() const;
+
+		//Smallest snapshot size, in bytes, that at least the given fraction
+		//of ticks came in under, read from the histogram
+		static int GetSnapshotPercentile(const PeerNetworkStats& peer, float fraction);
+
+	protected:
+		void Sample(float elapsed);
+
+		PeerNetworkStats* Find(int peer) {
+			return (peer >= 0 && peer < (int)peers.size() && peers[peer].active) ? &peers[peer] : nullptr;
+		}
+
+		std::vector<PeerNetworkStats> peers;
+
+		std::chrono::steady_clock::time_point startTime;
+		std::chrono::steady_clock::time_point lastSample;
+		int ticksSinceSample;
+
+		std::ofstream csv;
+	};
+}
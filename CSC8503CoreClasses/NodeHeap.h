@@ -0,0 +1,165 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace NCL::CSC8503 {
+	/*
+	A binary min-heap of node indices for pathfinding open lists. Each node
+	remembers where it is in the heap, so a cheaper route to a node that's
+	already open moves it up in place instead of searching for it.
+
+	Positions are only kept for nodes in the heap, and Clear puts back the
+	few that are left, so one heap can be reused query after query without
+	touching the whole map.
+	*/
+	class NodeHeap {
+	public:
+		NodeHeap() {}
+		~NodeHeap() {}
+
+		void Resize(int nodeCount) {
+			positions.assign(nodeCount, -1);
+			heap.clear();
+		}
+
+		void Clear() {
+			for (const Entry& e : heap) {
+				positions[e.node] = -1;
+			}
+			heap.clear();
+		}
+
+		bool IsEmpty() const {
+			return heap.empty();
+		}
+
+		int GetSize() const {
+			return (int)heap.size();
+		}
+
+		bool Contains(int node) const {
+			return positions[node] >= 0;
+		}
+
+		//Adds the node, or moves it up if it's already in with a higher key
+		void Push(int node, float key) {
+			int i = positions[node];
+			if (i < 0) {
+				i = (int)heap.size();
+				heap.push_back({ key, node });
+			}
+			else if (key < heap[i].key) {
+				heap[i].key = key;
+			}
+			else {
+				return;
+			}
+			SiftUp(i);
+		}
+
+		int Pop() {
+			int node = heap[0].node;
+			positions[node] = -1;
+
+			Entry last = heap.back();
+			heap.pop_back();
+			if (!heap.empty()) {
+				heap[0] = last;
+				positions[last.node] = 0;
+				SiftDown(0);
+			}
+			return node;
+		}
+
+	protected:
+		struct Entry {
+			float	key;
+			int		node;
+		};
+
+		void SiftUp(int i) {
+			Entry e = heap[i];
+			while (i > 0) {
+				int parent = (i - 1) >> 1;
+				if (heap[parent].key <= e.key) {
+					break;
+				}
+				heap[i] = heap[parent];
+				positions[heap[i].node] = i;
+				i = parent;
+			}
+			heap[i] = e;
+			positions[e.node] = i;
+		}
+
+		void SiftDown(int i) {
+			Entry e		= heap[i];
+			int count	= (int)heap.size();
+			while (true) {
+				int child = i * 2 + 1;
+				if (child >= count) {
+					break;
+				}
+				if (child + 1 < count && heap[child + 1].key < heap[child].key) {
+					child++;
+				}
+				if (e.key <= heap[child].key) {
+					break;
+				}
+				heap[i] = heap[child];
+				positions[heap[i].node] = i;
+				i = child;
+			}
+			heap[i] = e;
+			positions[e.node] = i;
+		}
+
+		std::vector<Entry>	heap;
+		std::vector<int>	positions; //per node, -1 when it isn't in the heap
+	};
+
+	/*
+	The working state for one search at a time, indexed by node - grid
+	nodes or navmesh triangles alike. Rather than clearing it all before
+	each query, every query bumps the generation, and a node's g and
+	parent only count if its stamp matches - so a short search over a big
+	map only touches the nodes it actually visits.
+	*/
+	struct GridSearchScratch {
+		std::vector<float>		g;
+		std::vector<int>		parent;
+		std::vector<uint32_t>	seen;	//g and parent are this query's
+		std::vector<uint32_t>	closed;	//already expanded this query
+		NodeHeap				open;
+		uint32_t				generation	= 0;
+		int						expanded	= 0; //by the last query
+		std::vector<int>		route;	//the nodes along the last path, for anything that tidies it up afterwards
+
+		void Begin(int nodeCount) {
+			if ((int)seen.size() != nodeCount) {
+				g.resize(nodeCount);
+				parent.resize(nodeCount);
+				seen.assign(nodeCount, 0);
+				closed.assign(nodeCount, 0);
+				open.Resize(nodeCount);
+				generation = 0;
+			}
+			open.Clear();
+			expanded = 0;
+			if (++generation == 0) { //wrapped, so old stamps could match again
+				std::fill(seen.begin(), seen.end(), 0);
+				std::fill(closed.begin(), closed.end(), 0);
+				generation = 1;
+			}
+		}
+
+		bool IsSeen(int node) const {
+			return seen[node] == generation;
+		}
+
+		bool IsClosed(int node) const {
+			return closed[node] == generation;
+		}
+	};
+}
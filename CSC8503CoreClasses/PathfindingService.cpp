@@ -0,0 +1,289 @@
+#include "PathfindingService.h"
+
+#include <chrono>
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+PathfindingService::PathfindingService(int workerCount) {
+	requestsMade			= 0;
+	requestsCoalesced		= 0;
+	searchesRun				= 0;
+	hierarchicalSearches	= 0;
+
+	stopping		= false;
+	nextJobID		= 0;
+	nextRequestID	= 0;
+	nextOrder		= 0;
+
+	inlineSearchTime = 0.0;
+
+	if (workerCount < 0) {
+		workerCount = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	}
+	for (int i = 0; i < workerCount; ++i) {
+		workers.emplace_back(&PathfindingService::WorkerLoop, this);
+	}
+}
+
+PathfindingService::~PathfindingService() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	workReady.notify_all();
+	for (std::thread& t : workers) {
+		t.join();
+	}
+	//Nobody's going to hear about these now
+	for (auto& [id, job] : jobs) {
+		delete job;
+	}
+	for (Job* job : finished) {
+		delete job;
+	}
+}
+
+void PathfindingService::SetNavigationData(std::shared_ptr<const NavigationGrid> grid, std::shared_ptr<const HierarchicalGrid> hierarchy) {
+	std::lock_guard<std::mutex> guard(lock);
+	snapshot.grid		= grid;
+	snapshot.hierarchy	= hierarchy;
+	snapshot.version++;
+
+	//Sized now, while the map's being loaded, rather than partway through
+	//whichever frame first runs a search over every node
+	if (workers.empty() && grid) {
+		inlineScratch.grid.Begin(grid->GetGridWidth() * grid->GetGridHeight());
+	}
+}
+
+int PathfindingService::RequestPath(const Vector3& from, const Vector3& to, const PathCallback& callback, int priority) {
+	std::unique_lock<std::mutex> guard(lock);
+	if (!snapshot.grid) {
+		return -1;
+	}
+	int startNode	= snapshot.grid->GetNodeIndex(from);
+	int goalNode	= snapshot.grid->GetNodeIndex(to);
+	uint64_t key	= ((uint64_t)(uint32_t)startNode << 32) | (uint32_t)goalNode;
+
+	int requestID = nextRequestID++;
+	requestsMade++;
+
+	auto i = jobsByKey.find(key);
+	if (i != jobsByKey.end() && i->second->version == snapshot.version) {
+		Job* job = i->second;
+		job->waiting.push_back({ requestID, callback });
+		requests[requestID] = job;
+		requestsCoalesced++;
+		if (priority > job->priority && !job->started) {
+			//Queued again further up - the old entry is skipped when it's
+			//reached, as the job will have gone by then
+			job->priority = priority;
+			queue.push({ priority, nextOrder++, job->id });
+		}
+		return requestID;
+	}
+	Job* job		= new Job();
+	job->id			= nextJobID++;
+	job->key		= key;
+	job->snapshot	= snapshot;
+	job->version	= snapshot.version;
+	job->from		= from;
+	job->to			= to;
+	job->priority	= priority;
+	job->waiting.push_back({ requestID, callback });
+
+	jobs[job->id]		= job;
+	jobsByKey[key]		= job;
+	requests[requestID] = job;
+	queue.push({ priority, nextOrder++, job->id });
+
+	guard.unlock();
+	workReady.notify_one();
+	return requestID;
+}
+
+void PathfindingService::Cancel(int requestID) {
+	std::lock_guard<std::mutex> guard(lock);
+	auto i = requests.find(requestID);
+	if (i == requests.end()) {
+		return;
+	}
+	Job* job = i->second;
+	requests.erase(i);
+
+	auto& waiting = job->waiting;
+	waiting.erase(std::remove_if(waiting.begin(), waiting.end(), [&](const Waiting& w) {
+		return w.requestID == requestID;
+	}), waiting.end());
+
+	//Not worth searching for if nobody wants it any more
+	if (waiting.empty() && !job->started && jobs.count(job->id)) {
+		DropJob(job);
+	}
+}
+
+int PathfindingService::GetWaitingCount() const {
+	std::lock_guard<std::mutex> guard(lock);
+	return (int)jobs.size();
+}
+
+PathfindingService::Job* PathfindingService::TakeNextJob() {
+	while (!queue.empty()) {
+		QueueEntry entry = queue.top();
+		queue.pop();
+
+		auto i = jobs.find(entry.jobID);
+		if (i == jobs.end() || i->second->started) {
+			continue; //cancelled, or a stale entry from a priority bump
+		}
+		i->second->started = true;
+		return i->second;
+	}
+	return nullptr;
+}
+
+void PathfindingService::FinishJob(Job* job) {
+	jobs.erase(job->id);
+	auto i = jobsByKey.find(job->key);
+	if (i != jobsByKey.end() && i->second == job) {
+		jobsByKey.erase(i);
+	}
+	finished.push_back(job);
+	searchesRun++;
+}
+
+void PathfindingService::DropJob(Job* job) {
+	jobs.erase(job->id);
+	auto i = jobsByKey.find(job->key);
+	if (i != jobsByKey.end() && i->second == job) {
+		jobsByKey.erase(i);
+	}
+	delete job;
+}
+
+void PathfindingService::RunJob(Job& job, WorkerScratch& scratch) {
+	const NavigationGrid& grid = *job.snapshot.grid;
+
+	bool useHierarchy = false;
+	if (job.snapshot.hierarchy) {
+		int start	= grid.GetNodeIndex(job.from);
+		int goal	= grid.GetNodeIndex(job.to);
+		int width	= grid.GetGridWidth();
+		if (start >= 0 && goal >= 0 &&
+			grid.IsWalkable(start % width, start / width) && grid.IsWalkable(goal % width, goal / width)) {
+			int distance = std::abs(start % width - goal % width) + std::abs(start / width - goal / width);
+			useHierarchy = distance > job.snapshot.hierarchy->GetClusterSize() * 2;
+		}
+	}
+	if (useHierarchy) {
+		job.found = job.snapshot.hierarchy->FindPath(job.from, job.to, job.path, scratch.hierarchy);
+	}
+	else {
+		job.found = grid.FindPath(job.from, job.to, job.path, scratch.grid);
+	}
+	job.snapshot = NavigationSnapshot(); //let go of the map as soon as we can
+
+	if (useHierarchy) {
+		std::lock_guard<std::mutex> guard(lock);
+		hierarchicalSearches++;
+	}
+}
+
+void PathfindingService::WorkerLoop() {
+	WorkerScratch scratch;
+
+	std::unique_lock<std::mutex> guard(lock);
+	while (true) {
+		workReady.wait(guard, [&]() {
+			return stopping || !queue.empty();
+		});
+		if (stopping) {
+			return;
+		}
+		Job* job = TakeNextJob();
+		if (!job) {
+			continue;
+		}
+		guard.unlock();
+		RunJob(*job, scratch);
+		guard.lock();
+
+		FinishJob(job);
+		jobFinished.notify_all();
+	}
+}
+
+void PathfindingService::Update(float maxMilliseconds) {
+	if (workers.empty()) {
+		using Clock = std::chrono::high_resolution_clock;
+		auto	start	= Clock::now();
+		bool	ranAny	= false;
+		while (true) {
+			//Anything that wouldn't fit waits for next frame - though one
+			//always goes ahead, or a budget smaller than a search would
+			//never get anywhere
+			double spent = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			if (ranAny && spent + inlineSearchTime > maxMilliseconds) {
+				break;
+			}
+			Job* job = nullptr;
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				job = TakeNextJob();
+			}
+			if (!job) {
+				break;
+			}
+			//Callbacks are handed their path straight away, so whatever they
+			//do with it is paid for out of the same budget as the search
+			auto searchStart = Clock::now();
+			RunJob(*job, inlineScratch);
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				FinishJob(job);
+			}
+			Deliver();
+			double took = std::chrono::duration<double, std::milli>(Clock::now() - searchStart).count();
+			inlineSearchTime = std::max(took, inlineSearchTime * 0.99);
+			ranAny = true;
+		}
+	}
+	Deliver();
+}
+
+//Callbacks are run without the lock, so they're free to ask for more paths
+void PathfindingService::Deliver() {
+	std::vector<Job*> done;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		done.swap(finished);
+		for (Job* job : done) {
+			for (const Waiting& w : job->waiting) {
+				requests.erase(w.requestID);
+			}
+		}
+	}
+	for (Job* job : done) {
+		for (const Waiting& w : job->waiting) {
+			w.callback(job->found, job->path);
+		}
+		delete job;
+	}
+}
+
+void PathfindingService::WaitForAll() {
+	if (workers.empty()) {
+		while (GetWaitingCount() > 0) {
+			Update(1000.0f);
+		}
+	}
+	else {
+		std::unique_lock<std::mutex> guard(lock);
+		jobFinished.wait(guard, [&]() {
+			return jobs.empty();
+		});
+	}
+	Deliver();
+}
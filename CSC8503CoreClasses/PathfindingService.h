@@ -0,0 +1,145 @@
+#pragma once
+#include "NavigationGrid.h"
+#include "HierarchicalGrid.h"
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <unordered_map>
+#include <cstdint>
+
+namespace NCL::CSC8503 {
+	/*
+	The map a batch of searches runs against. Workers only ever read it,
+	so once it's handed over it mustn't change - to change the map, build
+	a new grid and hand that over instead. Searches already running carry
+	on with the one they started with, and it's freed once the last of
+	them is done.
+	*/
+	struct NavigationSnapshot {
+		std::shared_ptr<const NavigationGrid>	grid;
+		std::shared_ptr<const HierarchicalGrid>	hierarchy;	//optional, built over grid, for long searches
+		int										version = 0;
+	};
+
+	/*
+	Finds paths off the game thread. Requests go into a queue, highest
+	priority first, and are picked up by a pool of worker threads, each
+	with its own search scratch. Results come back through callbacks,
+	which are only ever called from Update on the game thread.
+
+	Requests between the same two nodes while one is still waiting or
+	running are folded into it, so a crowd all re-pathing to the same
+	place at once only costs one search. Long searches go through the
+	hierarchical grid when there is one, rather than over every node.
+
+	With no workers, Update runs searches itself, but won't start one
+	it doesn't expect to finish in the time it was given, going by the
+	longest of the last few searches along with their callbacks, which
+	are run as each one finishes. Whatever's left waits for the next Update, so
+	a burst of requests is spread over frames instead of all landing on
+	one.
+	*/
+	class PathfindingService {
+	public:
+		using PathCallback = std::function<void(bool found, const NavigationPath& path)>;
+
+		//-1 for one less than the machine has hardware threads
+		PathfindingService(int workerCount = -1);
+		~PathfindingService();
+
+		void SetNavigationData(std::shared_ptr<const NavigationGrid> grid, std::shared_ptr<const HierarchicalGrid> hierarchy = nullptr);
+
+		//Returns an ID to cancel it with, or -1 if there's no map yet
+		int		RequestPath(const Vector3& from, const Vector3& to, const PathCallback& callback, int priority = 0);
+		void	Cancel(int requestID);
+
+		//Game thread, once a frame. Hands back finished paths, and runs
+		//searches for up to maxMilliseconds if there are no workers.
+		void	Update(float maxMilliseconds = 1.0f);
+
+		//Blocks until everything asked for so far has been handed back
+		void	WaitForAll();
+
+		int GetWorkerCount() const {
+			return (int)workers.size();
+		}
+
+		int GetWaitingCount() const;
+
+		int requestsMade;
+		int requestsCoalesced;
+		int searchesRun;
+		int hierarchicalSearches;
+
+	protected:
+		struct Waiting {
+			int				requestID;
+			PathCallback	callback;
+		};
+
+		struct Job {
+			int					id;
+			uint64_t			key;
+			NavigationSnapshot	snapshot;	//only touched by whoever's running it
+			int					version;
+			Vector3				from;
+			Vector3				to;
+			int					priority;
+			bool				started = false;
+
+			std::vector<Waiting> waiting;
+
+			bool			found = false;
+			NavigationPath	path;
+		};
+
+		struct QueueEntry {
+			int priority;
+			int order;	//first come first served within a priority
+			int jobID;
+
+			bool operator<(const QueueEntry& other) const {
+				return priority != other.priority ? priority < other.priority : order > other.order;
+			}
+		};
+
+		struct WorkerScratch {
+			GridSearchScratch	grid;
+			HierarchicalScratch	hierarchy;
+		};
+
+		void	WorkerLoop();
+
+		//All with the lock held
+		Job*	TakeNextJob();
+		void	FinishJob(Job* job);
+		void	DropJob(Job* job);
+
+		void	RunJob(Job& job, WorkerScratch& scratch);
+		void	Deliver();
+
+		mutable std::mutex			lock;
+		std::condition_variable		workReady;
+		std::condition_variable		jobFinished;
+		std::vector<std::thread>	workers;
+		bool						stopping;
+
+		NavigationSnapshot						snapshot;
+		std::priority_queue<QueueEntry>			queue;
+		std::unordered_map<int, Job*>			jobs;		//waiting or running
+		std::unordered_map<uint64_t, Job*>		jobsByKey;	//the same, by start and goal node
+		std::unordered_map<int, Job*>			requests;	//request ID to the job answering it
+		std::vector<Job*>						finished;	//waiting for Update to hand them back
+
+		int nextJobID;
+		int nextRequestID;
+		int nextOrder;
+
+		WorkerScratch	inlineScratch;		//for Update, when there are no workers
+		double			inlineSearchTime;	//about the longest of the last few, callbacks and all, in milliseconds
+	};
+}
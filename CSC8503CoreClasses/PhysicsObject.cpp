@@ -11,6 +11,11 @@ PhysicsObject::PhysicsObject(Transform* parentTransform, const CollisionVolume*
 	inverseMass = 1.0f;
 	elasticity	= 0.8f;
 	friction	= 0.8f;
+
+	//Left unset these were read as whatever was in memory, which also
+	//made two runs of the same simulation come out differently
+	linearDamping	= 0.0f;
+	angularDamping	= 0.0f;
 }
 
 PhysicsObject::~PhysicsObject()	{
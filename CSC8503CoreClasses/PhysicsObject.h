@@ -52,6 +52,15 @@ namespace NCL {
 				return force;
 			}
 
+			//For putting back a saved state, use AddForce / AddTorque otherwise
+			void SetForce(const Vector3& f) {
+				force = f;
+			}
+
+			void SetTorque(const Vector3& t) {
+				torque = t;
+			}
+
 			void SetInverseMass(float invMass) {
 				inverseMass = invMass;
 			}
@@ -12,11 +12,18 @@
 using namespace NCL;
 using namespace CSC8503;
 
+//This is the fixed timestep we'd LIKE to have
+const int   idealHZ = 120;
+const float idealDT = 1.0f / idealHZ;
+
 PhysicsSystem::PhysicsSystem(GameWorld& g) : gameWorld(g)	{
 	applyGravity	= false;
 	useBroadPhase	= false;	
 	dTOffset		= 0.0f;
 	globalDamping	= 0.995f;
+	realHZ			= idealHZ;
+	realDT			= idealDT;
+	fixedTimestep	= false;
 	SetGravity(Vector3(0.0f, -9.8f, 0.0f));
 }
 
@@ -41,6 +48,20 @@ void PhysicsSystem::Clear() {
 	allCollisions.clear();
 }
 
+void PhysicsSystem::RemoveObject(GameObject* o) {
+	for (auto i = allCollisions.begin(); i != allCollisions.end(); ) {
+		if (i->a == o || i->b == o) {
+			//Whatever it was touching still gets told it's stopped
+			GameObject* other = i->a == o ? i->b : i->a;
+			other->OnCollisionEnd(o);
+			i = allCollisions.erase(i);
+		}
+		else {
+			++i;
+		}
+	}
+}
+
 /*
 
 This is the core of the physics engine update
@@ -49,22 +70,18 @@ This is the core of the physics engine update
 
 bool useSimpleContainer = false;
 
-int constraintIterationCount = 10;
-
-//This is the fixed timestep we'd LIKE to have
-const int   idealHZ = 120;
-const float idealDT = 1.0f / idealHZ;
+int constraintIterationCount = PhysicsSystem::FIXED_CONSTRAINT_ITERATIONS;
 
 /*
-This is the fixed update we actually have...
+The fixed update we actually have is kept per system in realHZ / realDT...
 If physics takes too long it starts to kill the framerate, it'll drop the 
 iteration count down until the FPS stabilises, even if that ends up
 being at a low rate. 
 */
-int realHZ		= idealHZ;
-float realDT	= idealDT;
 
-void PhysicsSystem::Update(float dt) {	
+//Kept out of Update so the physics can run without a window, e.g. on a
+//headless server
+void PhysicsSystem::HandleDebugKeys() {
 	if (Window::GetKeyboard()->KeyPressed(KeyCodes::B)) {
 		useBroadPhase = !useBroadPhase;
 		std::cout << "Setting broadphase to " << useBroadPhase << std::endl;
@@ -81,7 +98,9 @@ void PhysicsSystem::Update(float dt) {
 		constraintIterationCount++;
 		std::cout << "Setting constraint iterations to " << constraintIterationCount << std::endl;
 	}
+}
 
+void PhysicsSystem::Update(float dt) {	
 	dTOffset += dt; //We accumulate time delta here - there might be remainders from previous frame!
 
 	GameTimer t;
@@ -92,24 +111,7 @@ void PhysicsSystem::Update(float dt) {
 	}
 	int iteratorCount = 0;
 	while(dTOffset > realDT) {
-		IntegrateAccel(realDT); //Update accelerations from external forces
-		if (useBroadPhase) {
-			BroadPhase();
-			NarrowPhase();
-		}
-		else {
-			BasicCollisionDetection();
-		}
-
-		//This is our simple iterative solver - 
-		//we just run things multiple times, slowly moving things forward
-		//and then rechecking that the constraints have been met		
-		float constraintDt = realDT /  (float)constraintIterationCount;
-		for (int i = 0; i < constraintIterationCount; ++i) {
-			UpdateConstraints(constraintDt);	
-		}
-		IntegrateVelocity(realDT); //update positions from new velocity changes
-
+		Step(realDT, constraintIterationCount);
 		dTOffset -= realDT;
 		iteratorCount++;
 	}
@@ -121,6 +123,10 @@ void PhysicsSystem::Update(float dt) {
 	t.Tick();
 	float updateTime = t.GetTimeDeltaSeconds();
 
+	if (fixedTimestep) {
+		return; //the step size mustn't depend on how fast this machine is
+	}
+
 	//Uh oh, physics is taking too long...
 	if (updateTime > realDT) {
 		realHZ /= 2;
@@ -142,6 +148,46 @@ void PhysicsSystem::Update(float dt) {
 	}
 }
 
+/*
+Runs exactly one step of the ideal timestep, whatever the frame time was.
+The accumulator is left alone, so the same run of calls gives the same
+result on every machine running the same build - which is what lockstep
+networking relies on.
+*/
+void PhysicsSystem::FixedUpdate() {
+	if (useBroadPhase) {
+		UpdateObjectAABBs();
+	}
+	Step(idealDT, FIXED_CONSTRAINT_ITERATIONS);
+
+	ClearForces();
+	UpdateCollisionList();
+}
+
+void PhysicsSystem::Step(float dt, int constraintIterations) {
+	IntegrateAccel(dt); //Update accelerations from external forces
+	if (useBroadPhase) {
+		BroadPhase();
+		NarrowPhase();
+	}
+	else {
+		BasicCollisionDetection();
+	}
+
+	//This is our simple iterative solver - 
+	//we just run things multiple times, slowly moving things forward
+	//and then rechecking that the constraints have been met		
+	float constraintDt = dt / (float)constraintIterations;
+	for (int i = 0; i < constraintIterations; ++i) {
+		UpdateConstraints(constraintDt);	
+	}
+	IntegrateVelocity(dt); //update positions from new velocity changes
+}
+
+float PhysicsSystem::GetFixedDT() {
+	return idealDT;
+}
+
 /*
 Later on we're going to need to keep track of collisions
 across multiple frames, so we store them in a set.
@@ -373,36 +419,40 @@ void PhysicsSystem::IntegrateAccel(float dt) {
 	gameWorld.GetObjectIterators(first, last);
 
 	for (auto i = first; i != last; ++i) {
-		PhysicsObject* object = (*i)->GetPhysicsObject();
-		if (object == nullptr) {
-			continue; // No physics object for this game object
-		}
+		IntegrateObjectAccel(*(*i), dt);
+	}
 
-		float inverseMass = object->GetInverseMass();
+}
 
-		Vector3 linearVel = object->GetLinearVelocity();
-		Vector3 force = object->GetForce();
-		Vector3 accel = force * inverseMass;
+void PhysicsSystem::IntegrateObjectAccel(GameObject& o, float dt) const {
+	PhysicsObject* object = o.GetPhysicsObject();
+	if (object == nullptr) {
+		return; // No physics object for this game object
+	}
 
-		if (applyGravity && inverseMass > 0) {
-			accel += gravity; // don't move infinitely heavy things!
-		}
+	float inverseMass = object->GetInverseMass();
 
-		linearVel += accel * dt; // integrate acceleration to get new velocity
-		object->SetLinearVelocity(linearVel);
+	Vector3 linearVel = object->GetLinearVelocity();
+	Vector3 force = object->GetForce();
+	Vector3 accel = force * inverseMass;
 
-		// Angular stuff
-		Vector3 torque = object->GetTorque();
-		Vector3 angVel = object->GetAngularVelocity();
+	if (applyGravity && inverseMass > 0) {
+		accel += gravity; // don't move infinitely heavy things!
+	}
 
-		object->UpdateInertiaTensor(); // Update tensor vs orientation
+	linearVel += accel * dt; // integrate acceleration to get new velocity
+	object->SetLinearVelocity(linearVel);
 
-		Vector3 angAccel = object->GetInertiaTensor() * torque;
+	// Angular stuff
+	Vector3 torque = object->GetTorque();
+	Vector3 angVel = object->GetAngularVelocity();
 
-		angVel += angAccel * dt; // integrate acceleration to get new velocity
-		object->SetAngularVelocity(angVel);
-	}
+	object->UpdateInertiaTensor(); // Update tensor vs orientation
+
+	Vector3 angAccel = object->GetInertiaTensor() * torque;
 
+	angVel += angAccel * dt; // integrate acceleration to get new velocity
+	object->SetAngularVelocity(angVel);
 }
 
 /*
@@ -418,42 +468,84 @@ void PhysicsSystem::IntegrateVelocity(float dt) {
 	//float frameLinearDamping = 1.0f - (0.4f * dt);
 
 	for (auto i = first; i != last; ++i) {
-		PhysicsObject* object = (*i)->GetPhysicsObject();
-		if (object == nullptr) {
-			continue; // No physics object for this game object
-		}
-		// Apply damping
-		float frameLinearDamping = globalDamping * dt;
-		float objectLinearDamping = object->GetLinearDamping() * frameLinearDamping;
-
-		Transform& transform = (*i)->GetTransform();
-		// Position stuff
-		Vector3 position = transform.GetPosition();
-		Vector3 linearVel = object->GetLinearVelocity();
-		position += linearVel * dt;
-		transform.SetPosition(position);
-		// Linear damping
-		linearVel = linearVel * (1.0f - objectLinearDamping);
-		object->SetLinearVelocity(linearVel);
-
-		// Orientation stuff
-		Quaternion orientation = transform.GetOrientation();
-		Vector3 angVel = object->GetAngularVelocity();
-
-		orientation = orientation + (Quaternion(angVel * dt * 0.5f, 0.0) * orientation);
-		orientation.Normalise();
-
-		transform.SetOrientation(orientation);
-
-		// Angular damping
-		float frameAngularDamping = globalDamping * dt;
-		float objectAngularDamping = object->GetAngularDamping() * frameAngularDamping;
-		angVel = angVel * (1.0f - objectAngularDamping);
-		object->SetAngularVelocity(angVel);
+		IntegrateObjectVelocity(*(*i), dt);
 	}
 	
 }
 
+void PhysicsSystem::IntegrateObjectVelocity(GameObject& o, float dt) const {
+	PhysicsObject* object = o.GetPhysicsObject();
+	if (object == nullptr) {
+		return; // No physics object for this game object
+	}
+	// Apply damping
+	float frameLinearDamping = globalDamping * dt;
+	float objectLinearDamping = object->GetLinearDamping() * frameLinearDamping;
+
+	Transform& transform = o.GetTransform();
+	// Position stuff
+	Vector3 position = transform.GetPosition();
+	Vector3 linearVel = object->GetLinearVelocity();
+	position += linearVel * dt;
+	transform.SetPosition(position);
+	// Linear damping
+	linearVel = linearVel * (1.0f - objectLinearDamping);
+	object->SetLinearVelocity(linearVel);
+
+	// Orientation stuff
+	Quaternion orientation = transform.GetOrientation();
+	Vector3 angVel = object->GetAngularVelocity();
+
+	orientation = orientation + (Quaternion(angVel * dt * 0.5f, 0.0) * orientation);
+	orientation.Normalise();
+
+	transform.SetOrientation(orientation);
+
+	// Angular damping
+	float frameAngularDamping = globalDamping * dt;
+	float objectAngularDamping = object->GetAngularDamping() * frameAngularDamping;
+	angVel = angVel * (1.0f - objectAngularDamping);
+	object->SetAngularVelocity(angVel);
+}
+
+/*
+Steps a single object through the same fixed timestep as Update - forces,
+then collisions, then velocity - so a client can re-run its own inputs on
+top of a corrected server state and land in the same place the main
+simulation would have. Only the static world is collided with: anything
+else that moves is where it is now rather than where it was back then,
+and mustn't be pushed about by a replay.
+*/
+void PhysicsSystem::StepObject(GameObject& o, float dt) const {
+	while (dt > 0.0f) {
+		float step = std::min(dt, realDT);
+		IntegrateObjectAccel(o, step);
+		CollideWithStatic(o);
+		IntegrateObjectVelocity(o, step);
+		dt -= step;
+	}
+}
+
+void PhysicsSystem::CollideWithStatic(GameObject& o) const {
+	if (!o.GetPhysicsObject()) {
+		return;
+	}
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	gameWorld.GetObjectIterators(first, last);
+
+	for (auto i = first; i != last; ++i) {
+		GameObject* other = *i;
+		if (other == &o || !other->GetPhysicsObject() || other->GetPhysicsObject()->GetInverseMass() > 0.0f) {
+			continue;
+		}
+		CollisionDetection::CollisionInfo info;
+		if (CollisionDetection::ObjectIntersection(&o, other, info)) {
+			ImpulseResolveCollision(*info.a, *info.b, info.point);
+		}
+	}
+}
+
 /*
 Once we're finished with a physics update, we have to
 clear out any accumulated forces, ready to receive new
@@ -12,8 +12,28 @@ namespace NCL {
 
 			void Clear();
 
+			//Forgets any collisions an object is part of, so it can be taken
+			//out of the world without the list pointing at it afterwards
+			void RemoveObject(GameObject* o);
+
 			void Update(float dt);
 
+			//One step of exactly GetFixedDT(), for simulations that have to
+			//come out the same everywhere. Always uses FIXED_CONSTRAINT_ITERATIONS,
+			//whatever the debug keys have set for Update.
+			void FixedUpdate();
+			static const int FIXED_CONSTRAINT_ITERATIONS = 10;
+			static float GetFixedDT();
+
+			//Stops Update changing its step size to keep up with the frame
+			//rate, so results don't depend on how fast the machine is
+			void SetFixedTimestep(bool state) {
+				fixedTimestep = state;
+			}
+
+			//Broadphase and constraint iteration toggles, read from the keyboard
+			void HandleDebugKeys();
+
 			void UseGravity(bool state) {
 				applyGravity = state;
 			}
@@ -23,7 +43,25 @@ namespace NCL {
 			}
 
 			void SetGravity(const Vector3& g);
+
+			//Moves a single object forward by dt using the same fixed steps as
+			//the main update, colliding it with anything that can't move. Used
+			//to replay predicted player inputs on clients.
+			void StepObject(GameObject& o, float dt) const;
+
+			//Collisions are remembered across frames, so rolling the world
+			//back has to put these back too
+			void SaveCollisions(std::vector<CollisionDetection::CollisionInfo>& out) const {
+				out.assign(allCollisions.begin(), allCollisions.end());
+			}
+
+			void RestoreCollisions(const std::vector<CollisionDetection::CollisionInfo>& in) {
+				allCollisions = std::set<CollisionDetection::CollisionInfo>(in.begin(), in.end());
+			}
 		protected:
+			//Integrates, collides and solves constraints for one step of dt
+			void Step(float dt, int constraintIterations);
+
 			void BasicCollisionDetection();
 			void BroadPhase();
 			void NarrowPhase();
@@ -33,6 +71,11 @@ namespace NCL {
 			void IntegrateAccel(float dt);
 			void IntegrateVelocity(float dt);
 
+			void IntegrateObjectAccel(GameObject& o, float dt) const;
+			void IntegrateObjectVelocity(GameObject& o, float dt) const;
+
+			void CollideWithStatic(GameObject& o) const;
+
 			void UpdateConstraints(float dt);
 
 			void UpdateCollisionList();
@@ -49,6 +92,10 @@ namespace NCL {
 			float	dTOffset;
 			float	globalDamping;
 
+			int		realHZ;
+			float	realDT;
+			bool	fixedTimestep;
+
 			std::set<CollisionDetection::CollisionInfo> allCollisions;
 			std::set<CollisionDetection::CollisionInfo> broadphaseCollisions;
 			std::vector<CollisionDetection::CollisionInfo> broadphaseCollisionsVec;
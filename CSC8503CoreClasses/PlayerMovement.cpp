@@ -0,0 +1,44 @@
+#include "PlayerMovement.h"
+#include "GameObject.h"
+#include "PhysicsObject.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+void PlayerMovement::ApplyInput(GameObject& player, const PlayerInput& input, bool isNewInput, float share) {
+	PhysicsObject* phys = player.GetPhysicsObject();
+	if (!phys) {
+		return;
+	}
+	float speed = 10.0f;
+	Vector3 moveDirection = Vector3(0, 0, 0);
+
+	if (input.buttons[Button_Forward]) {
+		moveDirection += Vector3(0, 0, speed);
+		player.GetTransform().SetOrientation(Quaternion::AxisAngleToQuaterion(Vector3(0, 1, 0), 0));
+	}
+	if (input.buttons[Button_Back]) {
+		moveDirection += Vector3(0, 0, -speed);
+		player.GetTransform().SetOrientation(Quaternion::AxisAngleToQuaterion(Vector3(0, 1, 0), 180));
+	}
+	if (input.buttons[Button_Left]) {
+		moveDirection += Vector3(speed, 0, 0);
+		player.GetTransform().SetOrientation(Quaternion::AxisAngleToQuaterion(Vector3(0, 1, 0), 90));
+	}
+	if (input.buttons[Button_Right]) {
+		moveDirection += Vector3(-speed, 0, 0);
+		player.GetTransform().SetOrientation(Quaternion::AxisAngleToQuaterion(Vector3(0, 1, 0), -90));
+	}
+
+	if (isNewInput && input.buttons[Button_Jump]) {
+		phys->ApplyLinearImpulse(Vector3(0, 20.0f, 0));
+	}
+
+	if (moveDirection.x != 0.0f || moveDirection.z != 0.0f) {
+		phys->AddForce(moveDirection * share);
+	}
+	else {
+		phys->SetLinearVelocity(Vector3(0, phys->GetLinearVelocity().y, 0));
+		phys->SetAngularVelocity(Vector3(0, 0, 0));
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "ClientPrediction.h"
+
+namespace NCL::CSC8503 {
+	class GameObject;
+
+	enum PlayerButtons {
+		Button_Forward,
+		Button_Back,
+		Button_Left,
+		Button_Right,
+		Button_Jump
+	};
+
+	/*
+	How a player's buttons turn into forces. Lives down here rather than in
+	NetworkPlayer so the client, the game server and the headless server all
+	move players in exactly the same way.
+	*/
+	namespace PlayerMovement {
+		//share is how much of the frame the input was held for, when a
+		//server frame takes in more than one of a client's inputs
+		void ApplyInput(GameObject& player, const PlayerInput& input, bool isNewInput, float share = 1.0f);
+	}
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <cfloat>
 
 namespace NCL {
 	namespace Maths {
@@ -0,0 +1,211 @@
+#include "ReplayLog.h"
+#include <cstring>
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	const char		REPLAY_MAGIC[4]		= { 'N', 'R', 'P', 'L' };
+	const size_t	INITIAL_LOG_SIZE	= 4 * 1024 * 1024;
+
+	size_t PaddedRecordSize(size_t packetSize) {
+		return (sizeof(ReplayRecordHeader) + packetSize + 3) & ~(size_t)3;
+	}
+}
+
+ReplayRecorder::ReplayRecorder() {
+	used		= 0;
+	recordCount = 0;
+}
+
+ReplayRecorder::~ReplayRecorder() {
+	Close();
+}
+
+bool ReplayRecorder::Open(const std::string& filename) {
+	Close();
+	if (!file.OpenWrite(filename, INITIAL_LOG_SIZE)) {
+		NET_LOG_ERROR("Couldn't open " << filename << " to record a replay");
+		return false;
+	}
+	ReplayFileHeader* header = (ReplayFileHeader*)file.GetData();
+	memcpy(header->magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+	header->version		= ReplayFileHeader::VERSION;
+	header->usedBytes	= sizeof(ReplayFileHeader);
+
+	used		= sizeof(ReplayFileHeader);
+	recordCount = 0;
+	return true;
+}
+
+void ReplayRecorder::Close() {
+	if (file.IsOpen()) {
+		file.Close(used);
+	}
+}
+
+void ReplayRecorder::Record(float time, int peer, ReplayDirection direction, int channel, GamePacket& packet) {
+	if (!file.IsOpen()) {
+		return;
+	}
+	size_t packetSize = packet.GetTotalSize();
+	size_t recordSize = PaddedRecordSize(packetSize);
+	if (!file.Reserve(used + recordSize)) {
+		NET_LOG_ERROR("Replay log couldn't grow past " << used << " bytes, recording stopped");
+		Close();
+		return;
+	}
+	char* out = file.GetData() + used;
+
+	ReplayRecordHeader record;
+	record.time			= time;
+	record.peer			= (int16_t)peer;
+	record.direction	= (uint8_t)direction;
+	record.channel		= (uint8_t)channel;
+	memcpy(out, &record, sizeof(record));
+	memcpy(out + sizeof(record), &packet, packetSize);
+
+	used += recordSize;
+	recordCount++;
+	((ReplayFileHeader*)file.GetData())->usedBytes = used;
+}
+
+ReplayReader::ReplayReader() {
+	position	= 0;
+	end			= 0;
+	lastTime	= 0.0f;
+}
+
+bool ReplayReader::Open(const std::string& filename) {
+	Close();
+	if (!file.OpenRead(filename)) {
+		NET_LOG_ERROR("Couldn't open replay " << filename);
+		return false;
+	}
+	const ReplayFileHeader* header = (const ReplayFileHeader*)file.GetData();
+	if (file.GetMappedSize() < sizeof(ReplayFileHeader) || memcmp(header->magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0) {
+		NET_LOG_ERROR(filename << " isn't a replay log");
+		Close();
+		return false;
+	}
+	if (header->version != ReplayFileHeader::VERSION) {
+		NET_LOG_ERROR(filename << " is replay version " << header->version << ", expected " << ReplayFileHeader::VERSION);
+		Close();
+		return false;
+	}
+	//Trust whichever is smaller, in case the recorder died mid-write
+	end			= (size_t)std::min<uint64_t>(header->usedBytes, file.GetMappedSize());
+	Rewind();
+	return true;
+}
+
+void ReplayReader::Close() {
+	file.Close();
+	position	= 0;
+	end			= 0;
+}
+
+void ReplayReader::Rewind() {
+	position = sizeof(ReplayFileHeader);
+	lastTime = 0.0f;
+}
+
+//Records are written in time order, so one that isn't can't be trusted -
+//and a NaN would never come due, leaving playback waiting on it forever
+bool ReplayReader::PeekTime(float& time) const {
+	if (position + sizeof(ReplayRecordHeader) + sizeof(GamePacket) > end) {
+		return false;
+	}
+	time = ((const ReplayRecordHeader*)(file.GetData() + position))->time;
+	return std::isfinite(time) && time >= lastTime;
+}
+
+bool ReplayReader::Next(const ReplayRecordHeader*& header, GamePacket*& packet) {
+	float time;
+	if (!PeekTime(time)) {
+		if (position < end) {
+			NET_LOG_ERROR("Replay log is corrupt at byte " << position);
+			position = end;
+		}
+		return false;
+	}
+	char* record	= file.GetData() + position;
+	GamePacket* p	= (GamePacket*)(record + sizeof(ReplayRecordHeader));
+
+	if (p->size < 0 || position + PaddedRecordSize(p->GetTotalSize()) > end) {
+		NET_LOG_ERROR("Replay log is corrupt at byte " << position);
+		position = end;
+		return false;
+	}
+	header		= (const ReplayRecordHeader*)record;
+	packet		= p;
+	position	+= PaddedRecordSize(p->GetTotalSize());
+	lastTime	= time;
+	return true;
+}
+
+ReplayPlayer::ReplayPlayer() {
+	peerFilter		= -1;
+	firstPeer		= -1;
+	duration		= 0.0f;
+	recordCount		= 0;
+	recordsPlayed	= 0;
+	finished		= true;
+}
+
+ReplayPlayer::~ReplayPlayer() {
+}
+
+bool ReplayPlayer::Open(const std::string& filename) {
+	if (!reader.Open(filename)) {
+		return false;
+	}
+	//One pass up front to find how long it runs for, and who was in it
+	const ReplayRecordHeader*	header;
+	GamePacket*					packet;
+	recordCount = 0;
+	duration	= 0.0f;
+	firstPeer	= -1;
+	while (reader.Next(header, packet)) {
+		duration = header->time;
+		recordCount++;
+		if (header->direction == Replay_Outgoing && header->peer >= 0 && firstPeer < 0) {
+			firstPeer = header->peer;
+		}
+	}
+	Restart();
+	return true;
+}
+
+void ReplayPlayer::Restart() {
+	reader.Rewind();
+	recordsPlayed	= 0;
+	finished		= recordCount == 0;
+}
+
+bool ReplayPlayer::PlayUntil(float time) {
+	float nextTime;
+	while (reader.PeekTime(nextTime) && nextTime <= time) {
+		const ReplayRecordHeader*	header;
+		GamePacket*					packet;
+		if (!reader.Next(header, packet)) {
+			break;
+		}
+		recordsPlayed++;
+
+		if (header->direction == Replay_Outgoing && peerFilter >= 0 && header->peer >= 0 && header->peer != peerFilter) {
+			continue;
+		}
+		//Nobody listening for this type isn't an error during a replay
+		if (packet->type < 0 || packet->type >= Max_Messages || handlerCounts[packet->type] == 0) {
+			continue;
+		}
+		int source = header->direction == Replay_Incoming ? header->peer : -1;
+		ProcessPacket(packet, source, packet->GetTotalSize());
+	}
+	if (!reader.PeekTime(nextTime)) {
+		finished = true;
+	}
+	return !finished;
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include "NetworkBase.h"
+#include "MappedFile.h"
+#include <cstdint>
+
+namespace NCL::CSC8503 {
+	enum ReplayDirection {
+		Replay_Outgoing,	//server to client(s)
+		Replay_Incoming		//client to server
+	};
+
+	//Written once at the start of a log. usedBytes is kept up to date on
+	//every append, so a log from a server that crashed can still be read
+	//up to the last whole record.
+	struct ReplayFileHeader {
+		char		magic[4];
+		uint32_t	version;
+		uint64_t	usedBytes;
+
+		static const uint32_t VERSION = 1;
+	};
+
+	//Each record is this followed by the packet exactly as it was sent,
+	//padded out to 4 bytes
+	struct ReplayRecordHeader {
+		float	time;		//seconds since recording started
+		int16_t	peer;		//-1 for a packet sent to everyone
+		uint8_t	direction;
+		uint8_t	channel;
+	};
+
+	/*
+	Appends packets to a memory mapped log as they go past, so recording
+	every snapshot and input costs a copy rather than a write call. The
+	file grows by doubling and is cut back to size when closed.
+	*/
+	class ReplayRecorder {
+	public:
+		ReplayRecorder();
+		~ReplayRecorder();
+
+		bool Open(const std::string& filename);
+		void Close();
+
+		bool IsOpen() const {
+			return file.IsOpen();
+		}
+
+		void Record(float time, int peer, ReplayDirection direction, int channel, GamePacket& packet);
+
+		size_t GetBytesWritten() const {
+			return used;
+		}
+
+		int GetRecordCount() const {
+			return recordCount;
+		}
+
+	protected:
+		MappedFile	file;
+		size_t		used;
+		int			recordCount;
+	};
+
+	/*
+	Walks the records in a log in the order they were written. Packets are
+	handed out as pointers into the mapping, which is copy-on-write, so
+	whoever reads them is free to treat them as their own.
+	*/
+	class ReplayReader {
+	public:
+		ReplayReader();
+		~ReplayReader() {}
+
+		bool Open(const std::string& filename);
+		void Close();
+
+		//Returns false at the end of the log, or at the first record that
+		//doesn't make sense
+		bool Next(const ReplayRecordHeader*& header, GamePacket*& packet);
+
+		void Rewind();
+
+		//Peeks at the time of the next record without moving on. False
+		//at the end, or if the next record's time makes no sense.
+		bool PeekTime(float& time) const;
+
+		size_t GetSize() const {
+			return end;
+		}
+
+	protected:
+		MappedFile	file;
+		size_t		position;
+		size_t		end;
+		float		lastTime;	//of the last record read
+	};
+
+	/*
+	Plays a recorded log back through the same handler table as a real
+	connection, so anything that registers with a GameClient or GameServer
+	can register here instead and be fed captured traffic, as fast as it
+	can take it. Outgoing packets arrive from source -1 like they would on
+	a client, incoming ones from the peer that sent them.
+	*/
+	class ReplayPlayer : public NetworkBase {
+	public:
+		ReplayPlayer();
+		~ReplayPlayer();
+
+		bool Open(const std::string& filename);
+
+		//Only outgoing packets sent to this peer (or to everyone) are
+		//played, so the log can be seen as one client saw it. -1 plays all,
+		//which is only any use to something that doesn't decode deltas, as
+		//each client's are built against its own acks.
+		void SetPeerFilter(int peer) {
+			peerFilter = peer;
+		}
+
+		//The first peer the log has anything sent to on its own, or -1
+		int GetFirstPeer() const {
+			return firstPeer;
+		}
+
+		//Dispatches every record up to this many seconds into the recording.
+		//Returns false once there's nothing left.
+		bool PlayUntil(float time);
+
+		void Restart();
+
+		float GetDuration() const {
+			return duration;
+		}
+
+		int GetRecordCount() const {
+			return recordCount;
+		}
+
+		int GetRecordsPlayed() const {
+			return recordsPlayed;
+		}
+
+		bool IsFinished() const {
+			return finished;
+		}
+
+	protected:
+		void HandleEvent(const NetworkEvent&) override {}
+		void SendOutgoing(const OutgoingPacket&) override {}
+
+		ReplayReader reader;
+
+		int		peerFilter;
+		int		firstPeer;
+		float	duration;
+		int		recordCount;
+		int		recordsPlayed;
+		bool	finished;
+	};
+}
@@ -0,0 +1,69 @@
+#include "RollbackManager.h"
+#include "GameWorld.h"
+#include "PhysicsSystem.h"
+
+#include <chrono>
+
+using namespace NCL;
+using namespace CSC8503;
+
+RollbackManager::RollbackManager(GameWorld& world, PhysicsSystem& physics, int maxRollback) : world(world), physics(physics) {
+	//One more than the limit, as the frame being rolled back to has to
+	//still be there alongside the ones after it
+	frames.resize(maxRollback + 1);
+
+	rollbackCount		= 0;
+	framesResimulated	= 0;
+	totalRollbackTime	= 0.0;
+	worstRollbackTime	= 0.0f;
+}
+
+void RollbackManager::Reset() {
+	for (SavedFrame& f : frames) {
+		f.frame = -1;
+	}
+}
+
+void RollbackManager::SaveFrame(int frame) {
+	if (frame < 0) {
+		return;
+	}
+	SavedFrame& slot = FrameSlot(frame);
+	world.SaveState(slot.world);
+	physics.SaveCollisions(slot.collisions);
+	slot.frame = frame;
+}
+
+bool RollbackManager::CanRollbackTo(int frame) const {
+	if (frame < 0) {
+		return false;
+	}
+	const SavedFrame& slot = FrameSlot(frame);
+	return slot.frame == frame && slot.world.GetWorldState() == world.GetWorldStateID();
+}
+
+bool RollbackManager::Rollback(int toFrame, int currentFrame, const std::function<void(int)>& step) {
+	if (toFrame >= currentFrame || !CanRollbackTo(toFrame)) {
+		return false;
+	}
+	auto start = std::chrono::steady_clock::now();
+
+	SavedFrame& slot = FrameSlot(toFrame);
+	world.RestoreState(slot.world);
+	physics.RestoreCollisions(slot.collisions);
+
+	//The frames after this one are about to change, so they're saved again
+	//on the way forward rather than kept
+	for (int frame = toFrame; frame < currentFrame; ++frame) {
+		if (frame != toFrame) {
+			SaveFrame(frame);
+		}
+		step(frame);
+		framesResimulated++;
+	}
+	float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	totalRollbackTime	+= time;
+	worstRollbackTime	= std::max(worstRollbackTime, time);
+	rollbackCount++;
+	return true;
+}
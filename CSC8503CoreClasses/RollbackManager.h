@@ -0,0 +1,92 @@
+#pragma once
+#include "WorldSnapshot.h"
+#include "CollisionDetection.h"
+
+#include <functional>
+#include <cassert>
+
+namespace NCL::CSC8503 {
+	class GameWorld;
+	class PhysicsSystem;
+
+	/*
+	Keeps the last few frames of the world so that when an input turns up
+	late, we can go back to the frame it belonged to and simulate forward
+	again with it, instead of correcting the mistake afterwards.
+
+	Each frame is saved into one of a ring of snapshots that are reused, so
+	once the ring has seen the world at its full size, saving doesn't
+	allocate. The caller owns what a frame actually is - the step function
+	given to Rollback should apply that frame's inputs and step the world
+	exactly as the live game does (PhysicsSystem::FixedUpdate), or the
+	resimulated frames won't match.
+	*/
+	class RollbackManager {
+	public:
+		RollbackManager(GameWorld& world, PhysicsSystem& physics, int maxRollback = 8);
+		~RollbackManager() {}
+
+		//Call at the start of every frame, before it's simulated. Frames
+		//count up from 0, anything negative is ignored.
+		void SaveFrame(int frame);
+
+		//Puts the world back to the start of toFrame, then calls step for
+		//every frame up to (but not including) currentFrame. Fails without
+		//touching anything if toFrame is too old, or the world has had
+		//objects added or removed since it was saved.
+		bool Rollback(int toFrame, int currentFrame, const std::function<void(int)>& step);
+
+		bool CanRollbackTo(int frame) const;
+
+		//Forgets every saved frame, call when the world is rebuilt
+		void Reset();
+
+		int GetMaxRollback() const {
+			return (int)frames.size() - 1;
+		}
+
+		int GetRollbackCount() const {
+			return rollbackCount;
+		}
+
+		int GetFramesResimulated() const {
+			return framesResimulated;
+		}
+
+		float GetAverageRollbackTime() const {
+			return rollbackCount > 0 ? (float)(totalRollbackTime / rollbackCount) : 0.0f;
+		}
+
+		float GetWorstRollbackTime() const {
+			return worstRollbackTime;
+		}
+
+	protected:
+		struct SavedFrame {
+			int				frame = -1;
+			WorldSnapshot	world;
+			std::vector<CollisionDetection::CollisionInfo> collisions;
+		};
+
+		//Frames are never negative, every public entry point turns those away
+		SavedFrame& FrameSlot(int frame) {
+			assert(frame >= 0);
+			return frames[frame % frames.size()];
+		}
+
+		const SavedFrame& FrameSlot(int frame) const {
+			assert(frame >= 0);
+			return frames[frame % frames.size()];
+		}
+
+		GameWorld&		world;
+		PhysicsSystem&	physics;
+
+		std::vector<SavedFrame> frames;
+
+		int		rollbackCount;
+		int		framesResimulated;
+		double	totalRollbackTime;
+		float	worstRollbackTime;
+	};
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace NCL::CSC8503 {
+	/*
+	Ring buffer for passing items from exactly one producer thread to exactly
+	one consumer thread without locking. The producer only ever writes tail
+	and the consumer only ever writes head, so each side just needs to see
+	the other's index with acquire/release ordering.
+
+	Capacity is rounded up to a power of two. One slot is never used, so it
+	holds at most capacity - 1 items.
+	*/
+	template<typename T>
+	class SPSCQueue {
+	public:
+		explicit SPSCQueue(size_t capacity) : head(0), tail(0) {
+			SetCapacity(capacity);
+		}
+
+		//Throws away anything queued, so only call this while neither
+		//thread is using the queue
+		void SetCapacity(size_t capacity) {
+			size_t size = 2;
+			while (size < capacity) {
+				size <<= 1;
+			}
+			items.reset(new T[size]);
+			mask = size - 1;
+			head = 0;
+			tail = 0;
+		}
+
+		//Producer side. Returns false if the queue is full.
+		bool TryPush(const T& item) {
+			size_t t	= tail.load(std::memory_order_relaxed);
+			size_t next = (t + 1) & mask;
+			if (next == head.load(std::memory_order_acquire)) {
+				return false;
+			}
+			items[t] = item;
+			tail.store(next, std::memory_order_release);
+			return true;
+		}
+
+		//Consumer side. Returns false if the queue is empty.
+		bool TryPop(T& out) {
+			size_t h = head.load(std::memory_order_relaxed);
+			if (h == tail.load(std::memory_order_acquire)) {
+				return false;
+			}
+			out = items[h];
+			head.store((h + 1) & mask, std::memory_order_release);
+			return true;
+		}
+
+		//Only a snapshot - the other thread may change it straight away
+		size_t Size() const {
+			size_t h = head.load(std::memory_order_acquire);
+			size_t t = tail.load(std::memory_order_acquire);
+			return (t - h) & mask;
+		}
+
+		bool IsEmpty() const {
+			return Size() == 0;
+		}
+
+		size_t MaxSize() const {
+			return mask;
+		}
+
+	protected:
+		std::unique_ptr<T[]>	items;
+		size_t					mask;
+
+		//Kept on separate cache lines so the two threads don't keep
+		//invalidating each other's copy
+		alignas(64) std::atomic<size_t> head;
+		alignas(64) std::atomic<size_t> tail;
+	};
+}
@@ -42,4 +42,17 @@ void StateMachine::Update(float dt) {
 			}
 		}
 	}
+}
+
+int StateMachine::GetActiveStateIndex() const {
+	for (int i = 0; i < (int)allStates.size(); ++i) {
+		if (allStates[i] == activeState) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+void StateMachine::SetActiveStateIndex(int index) {
+	activeState = (index >= 0 && index < (int)allStates.size()) ? allStates[index] : nullptr;
 }
\ No newline at end of file
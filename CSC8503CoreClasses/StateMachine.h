@@ -21,6 +21,11 @@ namespace NCL {
 
 			virtual void Update(float dt); //made it virtual!
 
+			//Which state we're in, as a position in the order they were
+			//added, so it can be saved and put back. -1 if there's none.
+			int GetActiveStateIndex() const;
+			void SetActiveStateIndex(int index);
+
 		protected:
 			State * activeState;
 
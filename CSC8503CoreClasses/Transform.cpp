@@ -33,4 +33,11 @@ Transform& Transform::SetOrientation(const Quaternion& worldOrientation) {
 	orientation = worldOrientation;
 	UpdateMatrix();
 	return *this;
+}
+
+Transform& Transform::SetPositionAndOrientation(const Vector3& worldPos, const Quaternion& worldOrientation) {
+	position	= worldPos;
+	orientation = worldOrientation;
+	UpdateMatrix();
+	return *this;
 }
\ No newline at end of file
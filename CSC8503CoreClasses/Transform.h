@@ -1,5 +1,5 @@
 #pragma once
-#include "maths.h"
+#include "Maths.h"
 #include "Quaternion.h"
 
 using std::vector;
@@ -18,6 +18,9 @@ namespace NCL {
 			Transform& SetScale(const Vector3& worldScale);
 			Transform& SetOrientation(const Quaternion& newOr);
 
+			//Sets both with only one matrix rebuild
+			Transform& SetPositionAndOrientation(const Vector3& worldPos, const Quaternion& newOr);
+
 			Vector3 GetPosition() const {
 				return position;
 			}
@@ -0,0 +1,25 @@
+#include "WorldSnapshot.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+void WorldSnapshot::Reserve(int objects, size_t extraBytes) {
+	if (objects > capacity) {
+		//Every channel is laid out against the capacity, so anything
+		//already saved is meaningless afterwards
+		capacity	= objects;
+		worldState	= -1;
+		values.resize((size_t)ChannelCount * capacity);
+		this->objects.resize(capacity);
+		flags.resize(capacity);
+		extraOffsets.resize(capacity + 1);
+	}
+	if (extraBytes > extra.size()) {
+		extra.resize(extraBytes);
+	}
+}
+
+size_t WorldSnapshot::GetSizeInBytes() const {
+	return values.size() * sizeof(float) + objects.size() * sizeof(GameObject*) + flags.size()
+		+ extra.size() + extraOffsets.size() * sizeof(uint32_t) + constraints.size() * sizeof(Constraint*) + sizeof(random);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+#include <random>
+#include <cstdint>
+
+namespace NCL::CSC8503 {
+	class GameObject;
+	class Constraint;
+
+	/*
+	Everything GameWorld::SaveState needs to put a world back exactly as it
+	was, laid out structure-of-arrays: each component of each value (x of
+	every position, then y, and so on) is its own run of floats in one
+	buffer. Saving and restoring are then straight passes over memory.
+
+	The buffers only ever grow, so once a snapshot has been used for a
+	world of a given size, saving into it again doesn't allocate (unless
+	objects' extra state grows).
+
+	A snapshot can only be restored into the world it came from, and only
+	while that world has the same objects - adding or removing anything
+	changes the world state ID and the restore is refused.
+	*/
+	class WorldSnapshot {
+	public:
+		WorldSnapshot() {
+			objectCount = 0;
+			capacity	= 0;
+			worldState	= -1;
+		}
+
+		//Grows the buffers up front, so the first save doesn't have to
+		void Reserve(int objects, size_t extraBytes = 0);
+
+		int GetObjectCount() const {
+			return objectCount;
+		}
+
+		int GetWorldState() const {
+			return worldState;
+		}
+
+		bool IsEmpty() const {
+			return worldState < 0;
+		}
+
+		size_t GetSizeInBytes() const;
+
+	protected:
+		friend class GameWorld;
+
+		enum Channel {
+			PositionX, PositionY, PositionZ,
+			OrientationX, OrientationY, OrientationZ, OrientationW,
+			LinearX, LinearY, LinearZ,
+			AngularX, AngularY, AngularZ,
+			ForceX, ForceY, ForceZ,
+			TorqueX, TorqueY, TorqueZ,
+			ChannelCount
+		};
+
+		enum Flags {
+			Flag_Active		= 1,
+			Flag_Physics	= 2
+		};
+
+		float* GetChannel(int c) {
+			return &values[(size_t)c * capacity];
+		}
+
+		const float* GetChannel(int c) const {
+			return &values[(size_t)c * capacity];
+		}
+
+		std::vector<float>			values;		//ChannelCount runs of capacity floats
+		std::vector<GameObject*>	objects;	//also puts the world's order back
+		std::vector<uint8_t>		flags;
+
+		std::vector<char>		extra;			//state objects add themselves, e.g. AI
+		std::vector<uint32_t>	extraOffsets;	//objectCount + 1 entries
+
+		std::vector<Constraint*> constraints; //only their order can change
+		std::mt19937 random;
+
+		int objectCount;
+		int capacity;
+		int worldState;
+	};
+}
@@ -0,0 +1,311 @@
+#include "HeadlessServer.h"
+#include "GameServer.h"
+#include "GameObject.h"
+#include "PhysicsObject.h"
+#include "NetworkObject.h"
+#include "LagCompensator.h"
+#include "EntityReplicator.h"
+#include "PlayerMovement.h"
+#include "AABBVolume.h"
+#include "SphereVolume.h"
+#include "Debug.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace NCL;
+using namespace CSC8503;
+
+HeadlessServer::HeadlessServer(int port, int maxClients, int tickRate, const LinkSettings& link) {
+	tickDT				= 1.0f / tickRate;
+	serverTime			= 0.0f;
+	timeToNextPacket	= 0.0f;
+	packetInterval		= 1.0f / 20.0f; //same snapshot rate as NetworkedGame
+	packetsToSnapshot	= 0;
+
+	tickCount		= 0;
+	totalTickTime	= 0.0;
+	worstTickTime	= 0.0f;
+	timeToNextStats = 5.0f;
+
+	world	= new GameWorld();
+	physics = new PhysicsSystem(*world);
+	physics->UseGravity(true);
+
+	replicator = new EntityReplicator(*world, *physics);
+	replicator->RegisterPrefab(Headless_Cube, [this](const Vector3& position, const Quaternion&) {
+		return AddCube(position, Vector3(1, 1, 1), 1.0f);
+	});
+	replicator->RegisterPrefab(Headless_Sphere, [this](const Vector3& position, const Quaternion&) {
+		return AddSphere(position, 1.0f, 1.0f);
+	});
+	replicator->RegisterPrefab(Headless_Player, [this](const Vector3& position, const Quaternion&) {
+		return AddPlayer(position);
+	});
+
+	BuildLevel();
+	lagCompensator = new LagCompensator(*world);
+
+	NetworkBase::Initialise();
+	server = new GameServer(port, maxClients);
+	server->RegisterPacketHandler(Client_Connected, this);
+	server->RegisterPacketHandler(Client_Disconnected, this);
+	server->RegisterPacketHandler(Player_Input, this);
+	server->RegisterPacketHandler(Ack_State, this);
+	if (!link.IsPerfect()) {
+		server->EnableLinkConditioner()->SetDefaultSettings(link);
+	}
+	//Every client can be sent a packet per object, plus its player's state,
+	//in one tick, and there may still be a tick's worth on its way out
+	int objectsPerClient = replicator->GetLiveCount() + maxClients + 2;
+	server->SetOutgoingQueueSize((size_t)maxClients * objectsPerClient * 2);
+	server->StartNetworkThread();
+
+	NET_LOG_INFO("Headless server listening on port " << port << " at " << tickRate << "hz");
+}
+
+HeadlessServer::~HeadlessServer() {
+	delete server;
+	delete lagCompensator;
+	delete replicator;
+	delete physics;
+	world->ClearAndErase(); //deletes the network objects along with their owners
+	delete world;
+	NetworkBase::Destroy();
+}
+
+void HeadlessServer::BuildLevel() {
+	AddCube(Vector3(0, -2, 0), Vector3(200, 2, 200), 0.0f);
+
+	//Some dynamic objects so there's something to simulate and replicate
+	for (int x = -2; x <= 2; ++x) {
+		for (int z = -2; z <= 2; ++z) {
+			replicator->Spawn(Headless_Cube, Vector3(x * 10.0f, 10.0f, z * 10.0f));
+			replicator->Spawn(Headless_Sphere, Vector3(x * 10.0f + 5.0f, 15.0f, z * 10.0f + 5.0f));
+		}
+	}
+}
+
+GameObject* HeadlessServer::AddCube(const Vector3& position, const Vector3& halfSize, float inverseMass) {
+	GameObject* cube = new GameObject("cube");
+
+	cube->SetBoundingVolume((CollisionVolume*)new AABBVolume(halfSize));
+	cube->GetTransform()
+		.SetPosition(position)
+		.SetScale(halfSize * 2.0f);
+
+	cube->SetPhysicsObject(new PhysicsObject(&cube->GetTransform(), cube->GetBoundingVolume()));
+	cube->GetPhysicsObject()->SetInverseMass(inverseMass);
+	cube->GetPhysicsObject()->InitCubeInertia();
+
+	world->AddGameObject(cube);
+	return cube;
+}
+
+GameObject* HeadlessServer::AddSphere(const Vector3& position, float radius, float inverseMass) {
+	GameObject* sphere = new GameObject("sphere");
+
+	sphere->SetBoundingVolume((CollisionVolume*)new SphereVolume(radius));
+	sphere->GetTransform()
+		.SetPosition(position)
+		.SetScale(Vector3(radius, radius, radius));
+
+	sphere->SetPhysicsObject(new PhysicsObject(&sphere->GetTransform(), sphere->GetBoundingVolume()));
+	sphere->GetPhysicsObject()->SetInverseMass(inverseMass);
+	sphere->GetPhysicsObject()->InitSphereInertia();
+
+	world->AddGameObject(sphere);
+	return sphere;
+}
+
+//Same shape and mass as TutorialGame::AddPlayerToWorld, so movement matches
+GameObject* HeadlessServer::AddPlayer(const Vector3& position) {
+	GameObject* player = AddSphere(position, 1.0f, 0.5f);
+	player->GetTransform().SetScale(Vector3(3, 3, 3));
+	return player;
+}
+
+void HeadlessServer::Run(float seconds) {
+	using Clock = std::chrono::steady_clock;
+
+	auto tickLength = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(tickDT));
+	auto nextTick	= Clock::now();
+	int  maxTicks	= seconds > 0.0f ? (int)(seconds / tickDT) : -1;
+
+	while (maxTicks < 0 || tickCount < maxTicks) {
+		Tick();
+
+		nextTick += tickLength;
+		auto now = Clock::now();
+		if (now > nextTick + tickLength * 5) {
+			nextTick = now; //we've fallen well behind, don't try to catch up all at once
+		}
+		else {
+			std::this_thread::sleep_until(nextTick);
+		}
+	}
+	PrintStats();
+}
+
+void HeadlessServer::Tick() {
+	auto start = std::chrono::steady_clock::now();
+
+	server->UpdateServer();
+	ApplyClientInputs();
+
+	lagCompensator->RecordFrame(serverTime);
+
+	world->UpdateWorld(tickDT);
+	physics->Update(tickDT);
+	serverTime += tickDT;
+
+	//If the last snapshot is still waiting to go out, this one waits for
+	//the next tick rather than queueing up behind it
+	timeToNextPacket -= tickDT;
+	if (timeToNextPacket < 0.0f && server->ReadyForSnapshot()) {
+		timeToNextPacket += packetInterval;
+		packetsToSnapshot--;
+
+		SendPlayerStates();
+		replicator->Flush(*server);
+		BroadcastSnapshot(packetsToSnapshot >= 0);
+		if (packetsToSnapshot < 0) {
+			packetsToSnapshot = 5;
+		}
+	}
+	//Nothing draws these, but game code still queues them up
+	Debug::UpdateRenderables(tickDT);
+
+	float tickTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	totalTickTime += tickTime;
+	worstTickTime = std::max(worstTickTime, tickTime);
+	tickCount++;
+
+	timeToNextStats -= tickDT;
+	if (timeToNextStats < 0.0f) {
+		timeToNextStats += 5.0f;
+		PrintStats();
+	}
+}
+
+void HeadlessServer::PrintStats() {
+	std::cout << "Tick " << tickCount << ": " << clients.size() << " clients, "
+		<< replicator->GetLiveCount() << " network objects (" << replicator->spawnsSent << " spawned, "
+		<< replicator->despawnsSent << " despawned), average tick "
+		<< GetAverageTickTime() * 1000.0f << "ms, worst " << worstTickTime * 1000.0f
+		<< "ms (budget " << tickDT * 1000.0f << "ms)" << std::endl;
+
+	NetworkThreadStats net = server->GetThreadStats();
+	std::cout << "  network thread: queues in/out " << net.incomingDepth << "/" << net.outgoingDepth
+		<< " (max " << net.maxIncomingDepth << "/" << net.maxOutgoingDepth << "), service "
+		<< net.averageServiceTime * 1000.0f << "ms (worst " << net.worstServiceTime * 1000.0f
+		<< "ms), queue delay " << net.averageQueueDelay * 1000.0f << "ms, dropped "
+		<< net.droppedIncoming << ", spilled " << net.spilledOutgoing << ", snapshots held "
+		<< net.heldSnapshots << ", stale " << net.droppedStale << std::endl;
+}
+
+void HeadlessServer::ReceivePacket(int type, GamePacket* payload, int source) {
+	switch (type) {
+		case Client_Connected: {
+			OnClientConnected(source);
+		}break;
+		case Client_Disconnected: {
+			OnClientDisconnected(source);
+		}break;
+		case Player_Input: {
+			server->QueueInputs(source, *(ClientPacket*)payload);
+		}break;
+		case Ack_State: {
+			server->AcknowledgeStates(source, *(AckPacket*)payload);
+		}break;
+	}
+}
+
+void HeadlessServer::OnClientConnected(int peer) {
+	NET_LOG_INFO("Headless server: client " << peer << " connected");
+	replicator->SendExisting(*server, peer);
+
+	ClientSlot& slot = clients[peer];
+	slot.player = replicator->Spawn(Headless_Player, Vector3(peer * 5.0f, 2.0f, -30.0f));
+}
+
+void HeadlessServer::OnClientDisconnected(int peer) {
+	NET_LOG_INFO("Headless server: client " << peer << " disconnected");
+	auto i = clients.find(peer);
+	if (i == clients.end()) {
+		return;
+	}
+	//Its ID goes back on the free list, so the table doesn't keep growing
+	//as clients come and go
+	replicator->Despawn(i->second.player->GetNetworkObject()->GetNetworkID());
+	clients.erase(i);
+}
+
+//Each input is held for as long as it was on the client, so a tick can take
+//in the end of one and the start of the next
+void HeadlessServer::ApplyClientInputs() {
+	for (auto& [peer, slot] : clients) {
+		PeerSlot* peerSlot = server->GetPeer(peer);
+		if (!peerSlot) {
+			continue;
+		}
+		GameObject* player = slot.player;
+		peerSlot->inputs.Play(tickDT, [player](const PlayerInput& input, bool isNewInput, float share) {
+			PlayerMovement::ApplyInput(*player, input, isNewInput, share);
+		});
+	}
+}
+
+void HeadlessServer::SendPlayerStates() {
+	for (auto& [peer, slot] : clients) {
+		PeerSlot* peerSlot = server->GetPeer(peer);
+		if (!peerSlot) {
+			continue;
+		}
+		PredictedState state = PredictedState::FromObject(*slot.player);
+
+		PlayerStatePacket packet;
+		packet.objectID			= slot.player->GetNetworkObject()->GetNetworkID();
+		packet.lastSequence		= peerSlot->inputs.current.sequence;
+		packet.heldFor			= peerSlot->inputs.GetHeldTime();
+		packet.position			= state.position;
+		packet.orientation		= state.orientation;
+		packet.linearVelocity	= state.linearVelocity;
+		packet.angularVelocity	= state.angularVelocity;
+		server->SendPacket(packet, peer);
+	}
+}
+
+//The tick count doubles as the snapshot's state ID
+void HeadlessServer::BroadcastSnapshot(bool deltaFrame) {
+	for (NetworkObject* o : replicator->GetNetworkObjects()) {
+		if (!o) {
+			continue;
+		}
+		o->RecordState(tickCount, serverTime);
+
+		//Full states don't depend on what each client has, so one copy
+		//goes to everyone. Deltas are built per client from its own ack.
+		if (!deltaFrame) {
+			GamePacket* newPacket = nullptr;
+			if (o->WritePacket(&newPacket, false, -1)) {
+				server->SendGlobalPacket(*newPacket);
+				delete newPacket;
+			}
+			continue;
+		}
+		for (auto& [peer, slot] : clients) {
+			PeerSlot* peerSlot = server->GetPeer(peer);
+			GamePacket* newPacket = nullptr;
+			if (peerSlot && o->WritePacket(&newPacket, true, peerSlot->GetAckedState(o->GetNetworkID()))) {
+				server->SendPacket(*newPacket, peer);
+				delete newPacket;
+			}
+		}
+		//States older than every client's baseline won't be asked for again
+		int minID = server->GetMinimumAckedState(o->GetNetworkID());
+		if (minID >= 0) {
+			o->UpdateStateHistory(minID);
+		}
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "NetworkBase.h"
+#include "GameWorld.h"
+#include "PhysicsSystem.h"
+#include "ClientPrediction.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		class GameServer;
+		class GameObject;
+		class NetworkObject;
+		class LagCompensator;
+		class EntityReplicator;
+
+		//Everything the server can spawn. Nothing is placed up front on the
+		//client side, so even the level's objects arrive this way.
+		enum HeadlessPrefab {
+			Headless_Cube,
+			Headless_Sphere,
+			Headless_Player
+		};
+
+		/*
+		A dedicated server with no window, renderer or keyboard. It owns the
+		world, physics and GameServer directly instead of going through
+		TutorialGame, and steps them all at a fixed tick rate, so several
+		can run side by side on one machine.
+		*/
+		class HeadlessServer : public PacketReceiver {
+		public:
+			//A link that isn't perfect is applied to everything sent to clients
+			HeadlessServer(int port, int maxClients, int tickRate, const LinkSettings& link = LinkSettings());
+			~HeadlessServer();
+
+			//Runs for the given number of seconds, or forever if it's <= 0
+			void Run(float seconds);
+
+			//One fixed step of networking, game logic and physics
+			void Tick();
+
+			void ReceivePacket(int type, GamePacket* payload, int source) override;
+
+			float GetTickDT() const {
+				return tickDT;
+			}
+
+			float GetAverageTickTime() const {
+				return tickCount > 0 ? (float)(totalTickTime / tickCount) : 0.0f;
+			}
+
+			float GetWorstTickTime() const {
+				return worstTickTime;
+			}
+
+			int GetTickCount() const {
+				return tickCount;
+			}
+
+			GameServer* GetServer() const {
+				return server;
+			}
+
+		protected:
+			struct ClientSlot {
+				GameObject*	player		= nullptr;
+			};
+
+			void BuildLevel();
+
+			GameObject* AddCube(const Vector3& position, const Vector3& halfSize, float inverseMass);
+			GameObject* AddSphere(const Vector3& position, float radius, float inverseMass);
+			GameObject* AddPlayer(const Vector3& position);
+
+			void OnClientConnected(int peer);
+			void OnClientDisconnected(int peer);
+
+			void ApplyClientInputs();
+			void SendPlayerStates();
+			void BroadcastSnapshot(bool deltaFrame);
+
+			void PrintStats();
+
+			GameWorld*		world;
+			PhysicsSystem*	physics;
+			GameServer*		server;
+			LagCompensator*	lagCompensator;
+			EntityReplicator* replicator;
+
+			std::map<int, ClientSlot> clients;
+
+			float	tickDT;
+			float	serverTime;
+			float	timeToNextPacket;
+			float	packetInterval;
+			int		packetsToSnapshot;
+
+			int		tickCount;
+			double	totalTickTime;
+			float	worstTickTime;
+			float	timeToNextStats;
+		};
+	}
+}
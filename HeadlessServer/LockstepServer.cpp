@@ -0,0 +1,157 @@
+#include "LockstepServer.h"
+#include "LockstepSimulation.h"
+#include "GameServer.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace NCL;
+using namespace CSC8503;
+
+LockstepServer::LockstepServer(int port, int playerCount, int objectCount, int inputDelay, unsigned int seed)
+	: session(playerCount, inputDelay), playerCount(playerCount), objectCount(objectCount), seed(seed) {
+	started			= false;
+	hashesChecked	= 0;
+	simulationTime	= 0.0;
+	simulation		= nullptr;
+	peerSlots.resize(playerCount, -1);
+
+	NetworkBase::Initialise();
+	server = new GameServer(port, playerCount);
+	server->RegisterPacketHandler(Client_Connected, this);
+	server->RegisterPacketHandler(Client_Disconnected, this);
+	server->RegisterPacketHandler(Lockstep_Input, this);
+	server->StartNetworkThread();
+
+	NET_LOG_INFO("Lockstep server waiting for " << playerCount << " players on port " << port);
+}
+
+LockstepServer::~LockstepServer() {
+	delete server;
+	delete simulation;
+	NetworkBase::Destroy();
+}
+
+void LockstepServer::Run(float seconds) {
+	while (!started) {
+		server->UpdateServer();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	auto start = std::chrono::steady_clock::now();
+	float elapsed = 0.0f;
+	while (elapsed < seconds) {
+		server->UpdateServer();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	}
+	PrintStats(elapsed);
+}
+
+void LockstepServer::ReceivePacket(int type, GamePacket* payload, int source) {
+	switch (type) {
+		case Client_Connected: {
+			if (started || source < 0 || source >= playerCount) {
+				break; //no joining part way through, the new client has no world to start from
+			}
+			peerSlots[source] = 0;
+			if (AssignSlots() == playerCount) {
+				Start();
+			}
+		}break;
+		case Client_Disconnected: {
+			if (source < 0 || source >= playerCount || peerSlots[source] < 0) {
+				break;
+			}
+			if (started) {
+				NET_LOG_ERROR("Lockstep player " << peerSlots[source] << " left, the game can't carry on without them");
+				break;
+			}
+			peerSlots[source] = -1;
+			AssignSlots();
+		}break;
+		case Lockstep_Input: {
+			OnInput(source, *(LockstepInputPacket*)payload);
+		}break;
+	}
+}
+
+//Slots follow peer order, so they stay packed as people come and go
+int LockstepServer::AssignSlots() {
+	int slot = 0;
+	for (int& s : peerSlots) {
+		if (s >= 0) {
+			s = slot++;
+		}
+	}
+	return slot;
+}
+
+void LockstepServer::Start() {
+	simulation	= new LockstepSimulation(playerCount, seed, objectCount);
+	started		= true;
+
+	for (int peer = 0; peer < playerCount; ++peer) {
+		LockstepStartPacket packet;
+		packet.slot			= peerSlots[peer];
+		packet.playerCount	= playerCount;
+		packet.inputDelay	= session.GetInputDelay();
+		packet.seed			= seed;
+		packet.objectCount	= objectCount;
+		server->SendPacket(packet, peer);
+	}
+	NET_LOG_INFO("Lockstep game started with " << playerCount << " players and " << objectCount << " objects");
+}
+
+void LockstepServer::OnInput(int peer, const LockstepInputPacket& packet) {
+	if (!started || !packet.IsValid() || peer < 0 || peer >= playerCount || peerSlots[peer] < 0) {
+		return;
+	}
+	session.SetInput(packet.tick, peerSlots[peer], packet.buttons);
+
+	if (packet.hashTick >= 0) {
+		hashesChecked++;
+		if (!session.CheckHash(packet.hashTick, packet.hash)) {
+			NET_LOG_ERROR("Desync! Player " << peerSlots[peer] << " disagrees about tick " << packet.hashTick);
+		}
+	}
+	SendReadyTicks();
+}
+
+void LockstepServer::SendReadyTicks() {
+	while (session.IsNextTickReady()) {
+		int tick = session.GetNextTick();
+
+		LockstepTickPacket packet(playerCount);
+		packet.tick = tick;
+		for (int slot = 0; slot < playerCount; ++slot) {
+			memcpy(packet.buttons[slot], session.GetInput(tick, slot), LOCKSTEP_BUTTONS);
+		}
+		server->SendGlobalPacket(packet);
+
+		auto start = std::chrono::steady_clock::now();
+		simulation->Step(session);
+		simulationTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+void LockstepServer::PrintStats(float seconds) {
+	int ticks = session.GetNextTick();
+
+	float sent		= 0.0f;
+	float received	= 0.0f;
+	for (int peer = 0; peer < playerCount; ++peer) {
+		if (const PeerNetworkStats* stats = server->GetStats().GetPeer(peer)) {
+			sent		+= stats->sendKbps;
+			received	+= stats->receiveKbps;
+		}
+	}
+	std::cout << "Lockstep: " << ticks << " ticks in " << seconds << "s (" << ticks / seconds << " per second), "
+		<< playerCount << " players, " << objectCount << " objects" << std::endl;
+	std::cout << "  per client " << sent / playerCount << " kbps sent, " << received / playerCount << " kbps received" << std::endl;
+	std::cout << "  simulation " << (ticks ? simulationTime / ticks * 1000.0 : 0.0) << "ms per tick" << std::endl;
+	std::cout << "  " << hashesChecked << " hashes checked, " << session.GetDesyncCount() << " desyncs";
+	if (session.GetDesyncCount() > 0) {
+		std::cout << " (first at tick " << session.GetFirstDesyncTick() << ")";
+	}
+	std::cout << std::endl;
+}
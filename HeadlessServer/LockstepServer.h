@@ -0,0 +1,58 @@
+#pragma once
+#include "NetworkBase.h"
+#include "LockstepSession.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		class GameServer;
+		class LockstepSimulation;
+
+		/*
+		Runs a lockstep game instead of replicating snapshots. Waits for the
+		expected number of clients, gives each a slot and the shared seed,
+		then just gathers their inputs and sends each complete tick back out.
+
+		It runs the same simulation as the clients, purely so their state
+		hashes have something to be checked against. Nothing about the
+		world itself is ever sent.
+		*/
+		class LockstepServer : public PacketReceiver {
+		public:
+			LockstepServer(int port, int playerCount, int objectCount, int inputDelay, unsigned int seed);
+			~LockstepServer();
+
+			//Runs until the given number of seconds after everyone joined
+			void Run(float seconds);
+
+			void ReceivePacket(int type, GamePacket* payload, int source) override;
+
+			int GetDesyncCount() const {
+				return session.GetDesyncCount();
+			}
+
+			GameServer* GetServer() const {
+				return server;
+			}
+
+		protected:
+			int AssignSlots();
+			void Start();
+			void OnInput(int peer, const LockstepInputPacket& packet);
+			void SendReadyTicks();
+			void PrintStats(float seconds);
+
+			GameServer*			server;
+			LockstepSession		session;
+			LockstepSimulation* simulation;
+
+			std::vector<int>	peerSlots; //indexed by peer ID, -1 if not playing
+
+			int				playerCount;
+			int				objectCount;
+			unsigned int	seed;
+			bool			started;
+			int				hashesChecked;
+			double			simulationTime;
+		};
+	}
+}
@@ -0,0 +1,280 @@
+#include "HeadlessServer.h"
+#include "LockstepServer.h"
+#include "GameServer.h"
+#include "GameClient.h"
+#include "NetworkObject.h"
+
+#include <chrono>
+#include <thread>
+#include <string>
+
+using namespace NCL;
+using namespace CSC8503;
+
+/*
+
+Runs the game server with no window, so it can be started from a script or
+on a machine without a GPU. All arguments are optional:
+
+HeadlessServer [port] [tick rate] [max clients] [seconds to run for]
+
+Leaving out the run time (or passing 0) runs until the process is killed.
+Average and worst tick times are printed every few seconds and on exit.
+
+HeadlessServer -soak [clients] [seconds]
+
+Starts a server and connects that many clients to it from this process,
+each sending input at 60hz, then reports tick times and per client
+bandwidth. It fails if the average tick is over budget or any snapshot
+had to be dropped, spilled or held back for want of queue space.
+Defaults to 64 clients for 30 seconds.
+
+HeadlessServer -lockstep [players] [objects] [seconds]
+
+Runs a lockstep game instead, where only inputs are sent. It starts once
+that many clients (e.g. LoadGenerator bots) have joined, then reports
+bandwidth and any desyncs. Defaults to 4 players, 100 objects, 30 seconds.
+
+Either way, any of these can be added to simulate a worse connection. In
+soak mode they apply in both directions, otherwise only to what the
+server sends:
+
+-latency [ms] -jitter [ms] -loss [percent] -reorder [percent]
+
+and -csv [file] writes the server's per client stats (RTT, loss, kbps,
+snapshot sizes and so on) to a file once a second. -record [file] logs
+every snapshot sent and input received, for ReplayTool to play back.
+
+*/
+
+//Acknowledges full states the way a real client would, so the server moves
+//on to sending deltas
+class SoakClientReceiver : public PacketReceiver {
+public:
+	void ReceivePacket(int type, GamePacket* payload, int) override {
+		packets++;
+		if (type == Full_State) {
+			FullPacket* full = (FullPacket*)payload;
+			acks.Add(full->objectID, full->fullState.stateID);
+			if (acks.IsFull()) {
+				SendAcks();
+			}
+		}
+		else if (type == Delta_State) {
+			deltas++;
+		}
+	}
+
+	void SendAcks() {
+		if (client && acks.count > 0) {
+			client->SendPacket(acks);
+			acks = AckPacket();
+		}
+	}
+	GameClient* client	= nullptr;
+	AckPacket	acks;
+	int			packets	= 0;
+	int			deltas	= 0;
+};
+
+//Anything asked for on the command line that applies to any kind of server
+struct ServerOutputs {
+	std::string csvFile;
+	std::string replayFile;
+
+	void Apply(GameServer& server) const {
+		if (!csvFile.empty()) {
+			server.GetStats().StartCSV(csvFile);
+		}
+		if (!replayFile.empty()) {
+			server.StartRecording(replayFile);
+		}
+	}
+};
+
+int RunSoakTest(int clientCount, float seconds, const LinkSettings& link, const ServerOutputs& outputs) {
+	const int	tickRate	= 60;
+	const int	inputRate	= 60;
+	int			port		= NetworkBase::GetDefaultPort();
+
+	HeadlessServer* server = new HeadlessServer(port, clientCount, tickRate, link);
+	outputs.Apply(*server->GetServer());
+
+	std::vector<GameClient*>		 clients(clientCount);
+	std::vector<SoakClientReceiver> receivers(clientCount);
+	for (int i = 0; i < clientCount; ++i) {
+		clients[i] = new GameClient();
+		if (!link.IsPerfect()) {
+			clients[i]->EnableLinkConditioner(i)->SetDefaultSettings(link);
+		}
+		receivers[i].client = clients[i];
+		clients[i]->RegisterPacketHandler(Server_Connected,	&receivers[i]);
+		clients[i]->RegisterPacketHandler(Full_State,		&receivers[i]);
+		clients[i]->RegisterPacketHandler(Delta_State,		&receivers[i]);
+		clients[i]->RegisterPacketHandler(Player_State,		&receivers[i]);
+		clients[i]->RegisterPacketHandler(Entity_Spawn,		&receivers[i]);
+		clients[i]->RegisterPacketHandler(Entity_Despawn,	&receivers[i]);
+		clients[i]->Connect(127, 0, 0, 1, port);
+	}
+	//Let everyone finish connecting before anything is measured
+	for (int i = 0; i < 100 && server->GetServer()->GetClientCount() < clientCount; ++i) {
+		server->Tick();
+		for (GameClient* c : clients) {
+			c->UpdateClient();
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	int connected = server->GetServer()->GetClientCount();
+
+	using Clock = std::chrono::steady_clock;
+	auto tickLength = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(1.0f / tickRate));
+	auto nextTick	= Clock::now();
+
+	int		ticks		= (int)(seconds * tickRate);
+	int		inputEvery	= std::max(1, tickRate / inputRate);
+	int		sequence	= 0;
+	double	totalTick	= 0.0;
+	float	worstTick	= 0.0f;
+	double	totalSend	= 0.0;
+	double	totalRecv	= 0.0;
+	int		samples		= 0;
+
+	for (int t = 0; t < ticks; ++t) {
+		if (t % inputEvery == 0) {
+			ClientPacket packet;
+			packet.sequence = sequence++;
+			packet.duration = (float)inputEvery / tickRate;
+			for (GameClient* c : clients) {
+				for (int b = 0; b < 8; ++b) {
+					packet.buttonstates[b] = (rand() % 4) == 0;
+				}
+				c->SendPacket(packet);
+			}
+		}
+		auto start = Clock::now();
+		server->Tick();
+		float tickTime = std::chrono::duration<float>(Clock::now() - start).count();
+		totalTick += tickTime;
+		worstTick = std::max(worstTick, tickTime);
+
+		for (int i = 0; i < clientCount; ++i) {
+			clients[i]->UpdateClient();
+			receivers[i].SendAcks();
+		}
+		//Bandwidth is smoothed over a second, so sample it once a second
+		if (t > 0 && t % tickRate == 0) {
+			GameServer* gs = server->GetServer();
+			for (int p = 0; p < gs->GetMaxClients(); ++p) {
+				if (const PeerNetworkStats* stats = gs->GetStats().GetPeer(p)) {
+					totalSend += stats->sendKbps;
+					totalRecv += stats->receiveKbps;
+					samples++;
+				}
+			}
+		}
+		nextTick += tickLength;
+		std::this_thread::sleep_until(nextTick);
+	}
+	int received	= 0;
+	int deltas		= 0;
+	for (SoakClientReceiver& r : receivers) {
+		received	+= r.packets;
+		deltas		+= r.deltas;
+	}
+	float averageTick	= ticks > 0 ? (float)(totalTick / ticks) : 0.0f;
+	float budget		= 1.0f / tickRate;
+
+	//Anything that didn't fit in a queue means clients were sent less
+	//than the server thought, so the bandwidth above wouldn't be real
+	NetworkThreadStats net	= server->GetServer()->GetThreadStats();
+	int lostSnapshots		= net.droppedIncoming + net.spilledOutgoing + net.heldSnapshots;
+
+	std::cout << "Soak test: " << connected << "/" << clientCount << " clients connected, "
+		<< ticks << " ticks, average tick " << averageTick * 1000.0f << "ms, worst "
+		<< worstTick * 1000.0f << "ms (budget " << budget * 1000.0f << "ms)" << std::endl;
+	std::cout << "  per client: " << (samples ? totalSend / samples : 0.0) << " kbps sent, "
+		<< (samples ? totalRecv / samples : 0.0) << " kbps received, "
+		<< (clientCount ? received / clientCount : 0) << " packets delivered ("
+		<< (clientCount ? deltas / clientCount : 0) << " deltas)" << std::endl;
+	std::cout << "  server queues: " << net.droppedIncoming << " dropped, " << net.spilledOutgoing
+		<< " spilled, " << net.heldSnapshots << " snapshots held back" << std::endl;
+
+	for (GameClient* c : clients) {
+		delete c;
+	}
+	delete server;
+
+	bool pass = connected == clientCount && averageTick <= budget && lostSnapshots == 0;
+	std::cout << (pass ? "PASS" : "FAIL") << std::endl;
+	return pass ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+	LinkSettings				link;
+	ServerOutputs				outputs;
+	std::vector<std::string>	args;
+	bool						soak		= false;
+	bool						lockstep	= false;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "-soak") {
+			soak = true;
+			continue;
+		}
+		if (arg == "-lockstep") {
+			lockstep = true;
+			continue;
+		}
+		if (arg == "-csv" && i + 1 < argc) {
+			outputs.csvFile = argv[++i];
+			continue;
+		}
+		if (arg == "-record" && i + 1 < argc) {
+			outputs.replayFile = argv[++i];
+			continue;
+		}
+		if (arg[0] != '-' || i + 1 >= argc) {
+			args.emplace_back(arg);
+			continue;
+		}
+		float value = std::stof(argv[++i]);
+		if		(arg == "-latency")	{ link.latency	= value / 1000.0f; }
+		else if (arg == "-jitter")	{ link.jitter	= value / 1000.0f; }
+		else if (arg == "-loss")	{ link.loss		= value / 100.0f; }
+		else if (arg == "-reorder")	{ link.reorder	= value / 100.0f; }
+		else {
+			std::cout << "Unknown option " << arg << std::endl;
+			return 1;
+		}
+	}
+	if (soak) {
+		int		clientCount = args.size() > 0 ? std::stoi(args[0]) : 64;
+		float	seconds		= args.size() > 1 ? std::stof(args[1]) : 30.0f;
+		return RunSoakTest(clientCount, seconds, link, outputs);
+	}
+	if (lockstep) {
+		int		players = args.size() > 0 ? std::stoi(args[0]) : 4;
+		int		objects = args.size() > 1 ? std::stoi(args[1]) : 100;
+		float	seconds = args.size() > 2 ? std::stof(args[2]) : 30.0f;
+
+		LockstepServer* server = new LockstepServer(NetworkBase::GetDefaultPort(), players, objects, 4, 1234);
+		outputs.Apply(*server->GetServer());
+		server->Run(seconds);
+		bool desynced = server->GetDesyncCount() > 0;
+		delete server;
+		return desynced ? 1 : 0;
+	}
+	int		port		= args.size() > 0 ? std::stoi(args[0]) : NetworkBase::GetDefaultPort();
+	int		tickRate	= args.size() > 1 ? std::stoi(args[1]) : 60;
+	int		maxClients	= args.size() > 2 ? std::stoi(args[2]) : 4;
+	float	runTime		= args.size() > 3 ? std::stof(args[3]) : 0.0f;
+
+	HeadlessServer* server = new HeadlessServer(port, maxClients, tickRate, link);
+	outputs.Apply(*server->GetServer());
+	server->Run(runTime);
+
+	bool overBudget = server->GetAverageTickTime() > server->GetTickDT();
+	delete server;
+
+	return overBudget ? 1 : 0;
+}
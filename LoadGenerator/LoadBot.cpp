@@ -0,0 +1,253 @@
+#include "LoadBot.h"
+#include "GameClient.h"
+#include "GameObject.h"
+#include "NetworkObject.h"
+#include "LockstepSimulation.h"
+#include "EntityReplicator.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+LoadBot::LoadBot(float inputRate) {
+	client			= new GameClient();
+	connected		= false;
+	inputInterval	= 1.0f / inputRate;
+	timeToNextInput = (rand() % 1000) / 1000.0f * inputInterval; //don't all send on the same frame
+	sequence		= 0;
+	lastAcknowledged = -1;
+
+	lockstep			= nullptr;
+	simulation			= nullptr;
+	lockstepSlot		= -1;
+	lockstepSendTick	= 0;
+
+	client->RegisterPacketHandler(Server_Connected,	this);
+	client->RegisterPacketHandler(Full_State,		this);
+	client->RegisterPacketHandler(Delta_State,		this);
+	client->RegisterPacketHandler(Player_State,		this);
+	client->RegisterPacketHandler(Lockstep_Start,	this);
+	client->RegisterPacketHandler(Lockstep_Tick,	this);
+	client->RegisterPacketHandler(Entity_Spawn,		this);
+	client->RegisterPacketHandler(Entity_Despawn,	this);
+
+	ResetStats();
+}
+
+LoadBot::~LoadBot() {
+	delete client;
+	delete simulation;
+	delete lockstep;
+	for (GameObject* o : objects) {
+		delete o;
+	}
+}
+
+bool LoadBot::Connect(uint8_t a, uint8_t b, uint8_t c, uint8_t d, int port) {
+	return client->Connect(a, b, c, d, port);
+}
+
+void LoadBot::SetLinkSettings(const LinkSettings& settings, unsigned int seed) {
+	client->EnableLinkConditioner(seed)->SetDefaultSettings(settings);
+}
+
+void LoadBot::ResetStats() {
+	packetsReceived		= 0;
+	bytesReceived		= 0;
+	snapshotsDecoded	= 0;
+	decodeTime			= 0.0;
+	inputsSent			= 0;
+	ticksSimulated		= 0;
+	simulationTime		= 0.0;
+	latencies.clear();
+}
+
+void LoadBot::Update(float dt) {
+	if (connected) {
+		timeToNextInput -= dt;
+		while (timeToNextInput < 0.0f) {
+			timeToNextInput += inputInterval;
+			if (lockstep) {
+				SendLockstepInput();
+			}
+			else {
+				SendInput();
+			}
+		}
+	}
+	client->UpdateClient();
+	SendAcks();
+}
+
+//Without these the server has no baseline to build deltas from, and every
+//snapshot stays a full one
+void LoadBot::SendAcks() {
+	if (pendingAcks.count > 0) {
+		client->SendPacket(pendingAcks);
+		pendingAcks = AckPacket();
+	}
+}
+
+void LoadBot::SendInput() {
+	ClientPacket packet;
+	packet.lastID	= lastAcknowledged;
+	packet.sequence = sequence;
+	packet.duration = inputInterval;
+	for (int i = 0; i < 8; ++i) {
+		packet.buttonstates[i] = (rand() % 4) == 0;
+	}
+	//Resends what the server hasn't acknowledged, the same as a real client
+	int older = std::min(sequence - 1 - lastAcknowledged, (int)ClientPacket::MAX_OLDER_INPUTS);
+	for (int i = 0; i < older; ++i) {
+		packet.older[i] = sentInputs[(sequence - 1 - i) % SEND_HISTORY];
+	}
+	packet.SetOlderCount(std::max(older, 0));
+
+	ClientPacket::OlderInput& sent = sentInputs[sequence % SEND_HISTORY];
+	sent.duration = packet.duration;
+	memcpy(sent.buttonstates, packet.buttonstates, sizeof(sent.buttonstates));
+	sendTimes[sequence % SEND_HISTORY] = Clock::now();
+	client->SendPacket(packet);
+	sequence++;
+	inputsSent++;
+}
+
+void LoadBot::ReceivePacket(int type, GamePacket* payload, int) {
+	if (type == Server_Connected) {
+		connected = true;
+		return;
+	}
+	if (type == Lockstep_Start) {
+		StartLockstep(*(LockstepStartPacket*)payload);
+		return;
+	}
+	packetsReceived++;
+	bytesReceived += payload->GetTotalSize();
+
+	if (type == Lockstep_Tick) {
+		ReceiveLockstepTick(*(LockstepTickPacket*)payload);
+		return;
+	}
+	if (type == Entity_Spawn || type == Entity_Despawn) {
+		ReceiveEntities(type, payload);
+		return;
+	}
+	if (type == Player_State) {
+		//Several inputs can be covered by one state, but only the newest
+		//has a meaningful time - the rest were waiting on the send rate
+		int acked = ((PlayerStatePacket*)payload)->lastSequence;
+		if (acked > lastAcknowledged && acked >= 0 && sequence - acked <= SEND_HISTORY) {
+			lastAcknowledged = acked;
+			latencies.emplace_back(std::chrono::duration<float>(Clock::now() - sendTimes[acked % SEND_HISTORY]).count());
+		}
+		return;
+	}
+	int id = type == Full_State ? ((FullPacket*)payload)->objectID : ((DeltaPacket*)payload)->objectID;
+	if (id < 0 || id > MAX_NETWORK_ID) {
+		return;
+	}
+	if (id >= (int)objects.size()) {
+		objects.resize(id + 1, nullptr);
+	}
+	if (!objects[id]) {
+		objects[id] = new GameObject("bot object");
+		objects[id]->SetNetworkObject(new NetworkObject(*objects[id], id));
+	}
+	auto start = Clock::now();
+	if (objects[id]->GetNetworkObject()->ReadPacket(*payload)) {
+		snapshotsDecoded++;
+		if (type == Full_State) {
+			pendingAcks.Add(id, ((FullPacket*)payload)->fullState.stateID);
+			if (pendingAcks.IsFull()) {
+				SendAcks();
+			}
+		}
+	}
+	decodeTime += std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//The bot has no prefabs, every object it's told about becomes the same
+//placeholder that snapshots are decoded into
+void LoadBot::ReceiveEntities(int type, GamePacket* payload) {
+	if (type == Entity_Despawn) {
+		EntityDespawnPacket* packet = (EntityDespawnPacket*)payload;
+		for (int i = 0; i < packet->GetReceivedCount(); ++i) {
+			int id = packet->networkIDs[i];
+			if (id >= 0 && id < (int)objects.size()) {
+				delete objects[id];
+				objects[id] = nullptr;
+			}
+		}
+		return;
+	}
+	EntitySpawnPacket* packet = (EntitySpawnPacket*)payload;
+	for (int i = 0; i < packet->GetReceivedCount(); ++i) {
+		const EntitySpawn& e = packet->entities[i];
+		if (e.networkID < 0 || e.networkID > MAX_NETWORK_ID) {
+			continue;
+		}
+		if (e.networkID >= (int)objects.size()) {
+			objects.resize(e.networkID + 1, nullptr);
+		}
+		delete objects[e.networkID];
+		objects[e.networkID] = new GameObject("bot object");
+		objects[e.networkID]->GetTransform().SetPositionAndOrientation(e.position, e.orientation);
+		objects[e.networkID]->SetNetworkObject(new NetworkObject(*objects[e.networkID], e.networkID));
+	}
+}
+
+void LoadBot::StartLockstep(const LockstepStartPacket& packet) {
+	if (!packet.IsValid()) {
+		NET_LOG_ERROR("Bot got a bad lockstep start packet");
+		return;
+	}
+	delete simulation;
+	delete lockstep;
+	lockstep		= new LockstepSession(packet.playerCount, packet.inputDelay);
+	simulation		= new LockstepSimulation(packet.playerCount, packet.seed, packet.objectCount);
+	lockstepSlot	= packet.slot;
+
+	//Nothing can be simulated until the first few ticks have inputs, so
+	//fill the delay up with empty ones straight away
+	for (lockstepSendTick = 0; lockstepSendTick < packet.inputDelay; ) {
+		SendLockstepInput();
+	}
+}
+
+void LoadBot::SendLockstepInput() {
+	if (lockstepSendTick >= lockstep->GetNextTick() + lockstep->GetInputDelay()) {
+		return; //stalled waiting on someone, don't run further ahead
+	}
+	LockstepInputPacket packet;
+	packet.tick = lockstepSendTick;
+	if (lockstepSendTick >= lockstep->GetInputDelay()) {
+		for (int i = 0; i < LOCKSTEP_BUTTONS; ++i) {
+			packet.buttons[i] = (rand() % 4) == 0;
+		}
+	}
+	packet.hashTick = lockstep->GetNextTick() - 1;
+	if (!lockstep->GetHash(packet.hashTick, packet.hash)) {
+		packet.hashTick = -1;
+	}
+	sendTimes[lockstepSendTick % SEND_HISTORY] = Clock::now();
+	client->SendPacket(packet);
+	lockstepSendTick++;
+	inputsSent++;
+}
+
+void LoadBot::ReceiveLockstepTick(const LockstepTickPacket& packet) {
+	if (!lockstep || !packet.IsValid() || packet.playerCount != lockstep->GetPlayerCount()) {
+		return;
+	}
+	for (int slot = 0; slot < packet.playerCount; ++slot) {
+		lockstep->SetInput(packet.tick, slot, packet.buttons[slot]);
+	}
+	if (packet.tick >= 0 && packet.tick < lockstepSendTick && lockstepSendTick - packet.tick <= SEND_HISTORY) {
+		latencies.emplace_back(std::chrono::duration<float>(Clock::now() - sendTimes[packet.tick % SEND_HISTORY]).count());
+	}
+	auto start = Clock::now();
+	while (lockstep->IsNextTickReady()) {
+		simulation->Step(*lockstep);
+		ticksSimulated++;
+	}
+	simulationTime += std::chrono::duration<double>(Clock::now() - start).count();
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "NetworkBase.h"
+#include "LockstepSession.h"
+#include "NetworkObject.h"
+#include <chrono>
+
+namespace NCL {
+	namespace CSC8503 {
+		class GameClient;
+		class GameObject;
+		class LockstepSimulation;
+
+		/*
+		A fake player with no window or world. It connects like a normal
+		client, sends randomised button presses at a fixed rate, and feeds
+		every snapshot it gets through NetworkObject::ReadPacket so the
+		decode cost is the same one a real client pays. It acknowledges the
+		full states it decodes, so the server moves it on to deltas too.
+
+		Latency is measured from sending an input to getting back the
+		Player_State that says the server has applied it.
+
+		If the server starts a lockstep game instead, the bot builds its own
+		copy of the simulation and steps it from the ticks it's sent, and
+		latency becomes the time until the tick its input was for comes back.
+		*/
+		class LoadBot : public PacketReceiver {
+		public:
+			using Clock = std::chrono::steady_clock;
+
+			LoadBot(float inputRate);
+			~LoadBot();
+
+			bool Connect(uint8_t a, uint8_t b, uint8_t c, uint8_t d, int port);
+
+			//Only applies to what the bot sends - the server needs its own
+			//conditioner for the other direction
+			void SetLinkSettings(const LinkSettings& settings, unsigned int seed);
+
+			//Sends any input that's due and handles whatever has arrived
+			void Update(float dt);
+
+			void ReceivePacket(int type, GamePacket* payload, int source) override;
+
+			bool IsConnected() const {
+				return connected;
+			}
+
+			bool IsLockstep() const {
+				return lockstep != nullptr;
+			}
+
+			//Clears the counters, but keeps the decoded objects
+			void ResetStats();
+
+			int		packetsReceived;
+			int		bytesReceived;
+			int		snapshotsDecoded;
+			double	decodeTime;		//seconds spent inside ReadPacket
+			int		inputsSent;
+			int		ticksSimulated;
+			double	simulationTime;
+
+			std::vector<float> latencies; //seconds, one per acknowledged input
+
+		protected:
+			void SendInput();
+			void SendAcks();
+			void ReceiveEntities(int type, GamePacket* payload);
+
+			void StartLockstep(const LockstepStartPacket& packet);
+			void SendLockstepInput();
+			void ReceiveLockstepTick(const LockstepTickPacket& packet);
+
+			static const int SEND_HISTORY = 256;
+
+			GameClient*	client;
+			bool		connected;
+
+			float	inputInterval;
+			float	timeToNextInput;
+			int		sequence;
+			int		lastAcknowledged;
+
+			Clock::time_point sendTimes[SEND_HISTORY]; //indexed by sequence
+			ClientPacket::OlderInput sentInputs[SEND_HISTORY]; //kept to resend until acknowledged
+			AckPacket pendingAcks; //full states decoded since the last update
+
+			std::vector<GameObject*> objects; //indexed by network ID
+
+			LockstepSession*	lockstep;
+			LockstepSimulation* simulation;
+			int					lockstepSlot;
+			int					lockstepSendTick;	//next tick we'll send input for
+		};
+	}
+}
@@ -0,0 +1,157 @@
+#include "LoadBot.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <cstdio>
+
+using namespace NCL;
+using namespace CSC8503;
+
+/*
+
+Connects a number of fake clients to a running server from one process,
+so scaling can be tested without opening a game window per player. All
+arguments are optional:
+
+LoadGenerator [bots] [input rate] [seconds] [port] [server address]
+
+Any of these can be added to make each bot's link to the server worse:
+
+-latency [ms] -jitter [ms] -loss [percent] -reorder [percent]
+
+Defaults to 16 bots sending 60 inputs a second for 30 seconds, against the
+default port on 127.0.0.1. Start the server first, e.g. with
+HeadlessServer [port] 60 [bots], or HeadlessServer -lockstep [bots] to
+have the bots play a lockstep game instead.
+
+The first couple of seconds are used to connect and are left out of the
+results. Returns 1 if any bot failed to connect.
+
+*/
+
+float Percentile(std::vector<float>& sorted, float p) {
+	if (sorted.empty()) {
+		return 0.0f;
+	}
+	size_t i = std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1) + 0.5f));
+	return sorted[i];
+}
+
+int main(int argc, char** argv) {
+	LinkSettings				link;
+	std::vector<std::string>	args;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg[0] != '-' || i + 1 >= argc) {
+			args.emplace_back(arg);
+			continue;
+		}
+		float value = std::stof(argv[++i]);
+		if		(arg == "-latency")	{ link.latency	= value / 1000.0f; }
+		else if (arg == "-jitter")	{ link.jitter	= value / 1000.0f; }
+		else if (arg == "-loss")	{ link.loss		= value / 100.0f; }
+		else if (arg == "-reorder")	{ link.reorder	= value / 100.0f; }
+		else {
+			std::cout << "Unknown option " << arg << std::endl;
+			return 1;
+		}
+	}
+	int			botCount	= args.size() > 0 ? std::stoi(args[0]) : 16;
+	float		inputRate	= args.size() > 1 ? std::stof(args[1]) : 60.0f;
+	float		runTime		= args.size() > 2 ? std::stof(args[2]) : 30.0f;
+	int			port		= args.size() > 3 ? std::stoi(args[3]) : NetworkBase::GetDefaultPort();
+	std::string address		= args.size() > 4 ? args[4] : "127.0.0.1";
+
+	int a = 127, b = 0, c = 0, d = 1;
+	if (sscanf(address.c_str(), "%d.%d.%d.%d", &a, &b, &c, &d) != 4) {
+		std::cout << "Couldn't read server address " << address << std::endl;
+		return 1;
+	}
+	NetworkBase::Initialise();
+
+	std::vector<LoadBot*> bots;
+	for (int i = 0; i < botCount; ++i) {
+		bots.emplace_back(new LoadBot(inputRate));
+		if (!link.IsPerfect()) {
+			bots.back()->SetLinkSettings(link, i);
+		}
+		bots.back()->Connect(a, b, c, d, port);
+	}
+
+	using Clock = std::chrono::steady_clock;
+	const float frameDT		= 1.0f / 120.0f; //fast enough to not hold back any sane input rate
+	const float warmupTime	= 2.0f;
+
+	auto frameLength	= std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(frameDT));
+	auto nextFrame		= Clock::now();
+	auto measureStart	= Clock::now();
+	bool measuring		= false;
+
+	for (float t = 0.0f; t < warmupTime + runTime; t += frameDT) {
+		if (!measuring && t >= warmupTime) {
+			for (LoadBot* bot : bots) {
+				bot->ResetStats();
+			}
+			measureStart	= Clock::now();
+			measuring		= true;
+		}
+		for (LoadBot* bot : bots) {
+			bot->Update(frameDT);
+		}
+		nextFrame += frameLength;
+		std::this_thread::sleep_until(nextFrame);
+	}
+	float elapsed = std::chrono::duration<float>(Clock::now() - measureStart).count();
+
+	int					connected	= 0;
+	double				packets		= 0.0;
+	double				bytes		= 0.0;
+	double				decoded		= 0.0;
+	double				decodeTime	= 0.0;
+	double				sent		= 0.0;
+	std::vector<float>	latencies;
+
+	for (LoadBot* bot : bots) {
+		connected	+= bot->IsConnected() ? 1 : 0;
+		packets		+= bot->packetsReceived;
+		bytes		+= bot->bytesReceived;
+		decoded		+= bot->snapshotsDecoded;
+		decodeTime	+= bot->decodeTime;
+		sent		+= bot->inputsSent;
+		latencies.insert(latencies.end(), bot->latencies.begin(), bot->latencies.end());
+	}
+	std::sort(latencies.begin(), latencies.end());
+
+	std::cout << connected << "/" << botCount << " bots connected, measured for " << elapsed << "s" << std::endl;
+	if (!link.IsPerfect()) {
+		std::cout << "  link: " << link.latency * 1000.0f << "ms latency, " << link.jitter * 1000.0f << "ms jitter, "
+			<< link.loss * 100.0f << "% loss, " << link.reorder * 100.0f << "% reordered" << std::endl;
+	}
+	std::cout << "  sent " << (int)(sent / elapsed) << " inputs/sec" << std::endl;
+	std::cout << "  received " << (int)(packets / elapsed) << " packets/sec, "
+		<< (int)(bytes / elapsed) << " B/sec (" << (int)(bytes / elapsed / std::max(connected, 1)) << " B/sec per bot)" << std::endl;
+	std::cout << "  decoded " << (int)decoded << " snapshots, " << (decoded > 0 ? decodeTime / decoded * 1000000.0 : 0.0) << "us each" << std::endl;
+	double ticks		= 0.0;
+	double simTime		= 0.0;
+	for (LoadBot* bot : bots) {
+		ticks	+= bot->ticksSimulated;
+		simTime += bot->simulationTime;
+	}
+	if (ticks > 0) {
+		std::cout << "  lockstep: simulated " << (int)(ticks / bots.size()) << " ticks per bot, "
+			<< simTime / ticks * 1000.0 << "ms each" << std::endl;
+	}
+	std::cout << "  input latency p50 " << Percentile(latencies, 0.5f) * 1000.0f << "ms, p95 "
+		<< Percentile(latencies, 0.95f) * 1000.0f << "ms, p99 " << Percentile(latencies, 0.99f) * 1000.0f
+		<< "ms, max " << (latencies.empty() ? 0.0f : latencies.back() * 1000.0f) << "ms ("
+		<< latencies.size() << " samples)" << std::endl;
+
+	for (LoadBot* bot : bots) {
+		delete bot;
+	}
+	NetworkBase::Destroy();
+
+	return connected == botCount ? 0 : 1;
+}
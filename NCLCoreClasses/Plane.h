@@ -15,7 +15,7 @@ namespace NCL::Maths {
 		Plane(void);
 		Plane(const Vector3 &normal, float distance, bool normalise = false);
 
-		~Plane(void) {};
+		~Plane(void) = default; //so planes can be copied as plain bytes, like in navmesh files
 
 		//Sets the planes normal, which should be UNIT LENGTH!!!
 		Plane&	SetNormal(const Vector3 &normal) { this->normal = normal; return *this;}
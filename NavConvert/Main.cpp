@@ -0,0 +1,76 @@
+#include "NavigationMesh.h"
+#include "NavigationGrid.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+using namespace NCL;
+using namespace CSC8503;
+
+/*
+
+Turns a text navmesh or grid into the binary format, which loads with no
+parsing at all - a mesh is used straight out of the file:
+
+NavConvert [input] [output]
+
+Both names are in the data directory, and .navmesh files are taken to be
+meshes, anything else a grid. Each is loaded back once it's written, to
+check it comes out the same size and to show how long each takes.
+
+*/
+
+template <typename T>
+double TimeNavigationLoad(const std::string& filename, std::unique_ptr<T>& loaded) {
+	auto start = std::chrono::high_resolution_clock::now();
+	loaded = std::make_unique<T>(filename);
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::cout << "Usage: NavConvert [input] [output]" << std::endl;
+		return 1;
+	}
+	const std::string input		= argv[1];
+	const std::string output	= argv[2];
+
+	const std::string meshExtension = ".navmesh";
+	bool isMesh = input.size() >= meshExtension.size() && input.compare(input.size() - meshExtension.size(), meshExtension.size(), meshExtension) == 0;
+
+	double textTime		= 0.0;
+	double binaryTime	= 0.0;
+	if (isMesh) {
+		std::unique_ptr<NavigationMesh> text;
+		std::unique_ptr<NavigationMesh> binary;
+		textTime = TimeNavigationLoad(input, text);
+		if (text->GetTriangles().empty() || !text->SaveBinary(output)) {
+			std::cout << "Couldn't convert navmesh " << input << std::endl;
+			return 1;
+		}
+		binaryTime = TimeNavigationLoad(output, binary);
+		if (binary->GetTriangles().size() != text->GetTriangles().size()) {
+			std::cout << "Navmesh " << output << " didn't load back the same" << std::endl;
+			return 1;
+		}
+		std::cout << "Navmesh " << input << " to " << output << ", " << binary->GetTriangles().size() << " triangles" << std::endl;
+	}
+	else {
+		std::unique_ptr<NavigationGrid> text;
+		std::unique_ptr<NavigationGrid> binary;
+		textTime = TimeNavigationLoad(input, text);
+		if (text->GetGridWidth() == 0 || !text->SaveBinary(output)) {
+			std::cout << "Couldn't convert navigation grid " << input << std::endl;
+			return 1;
+		}
+		binaryTime = TimeNavigationLoad(output, binary);
+		if (binary->GetGridWidth() != text->GetGridWidth() || binary->GetGridHeight() != text->GetGridHeight()) {
+			std::cout << "Navigation grid " << output << " didn't load back the same" << std::endl;
+			return 1;
+		}
+		std::cout << "Navigation grid " << input << " to " << output << ", " << binary->GetGridWidth() << "x" << binary->GetGridHeight() << std::endl;
+	}
+	std::cout << "Loads in " << binaryTime << "ms, against " << textTime << "ms as text" << std::endl;
+	return 0;
+}
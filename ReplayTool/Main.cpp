@@ -0,0 +1,106 @@
+#include "ReplayDecoder.h"
+#include "ReplayLog.h"
+
+#include <chrono>
+#include <thread>
+#include <string>
+#include <iomanip>
+
+using namespace NCL;
+using namespace CSC8503;
+
+/*
+
+Plays back a log recorded by a server (HeadlessServer -record, or F4 in
+the game) with no window, decoding every snapshot the way a client does:
+
+ReplayTool [file] [speed] [-peer n]
+
+Speed is how many times faster than real time to play, 100 by default.
+0 plays as fast as the decoder can go, for benchmarking. -peer picks which
+client's snapshots to decode, to see the game as it saw it. Each client's
+deltas are built against what it has acknowledged, so they can't be mixed,
+and it defaults to the first client the server sent anything to.
+
+At the end it prints the decode cost and a hash of the final state of
+every object, which will match between runs of the same log.
+
+*/
+
+int main(int argc, char** argv) {
+	std::vector<std::string>	args;
+	int							peer = -1;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "-peer" && i + 1 < argc) {
+			peer = std::stoi(argv[++i]);
+			continue;
+		}
+		args.emplace_back(arg);
+	}
+	if (args.empty()) {
+		std::cout << "Usage: ReplayTool [file] [speed] [-peer n]" << std::endl;
+		return 1;
+	}
+	float speed = args.size() > 1 ? std::stof(args[1]) : 100.0f;
+
+	ReplayPlayer player;
+	if (!player.Open(args[0])) {
+		return 1;
+	}
+	if (peer < 0) {
+		peer = player.GetFirstPeer();
+	}
+	player.SetPeerFilter(peer);
+
+	ReplayDecoder decoder;
+	player.RegisterPacketHandler(Full_State,		&decoder);
+	player.RegisterPacketHandler(Delta_State,		&decoder);
+	player.RegisterPacketHandler(Player_State,		&decoder);
+	player.RegisterPacketHandler(Player_Input,		&decoder);
+	player.RegisterPacketHandler(Ack_State,			&decoder);
+	player.RegisterPacketHandler(Received_State,	&decoder);
+
+	std::cout << "Playing " << player.GetRecordCount() << " records covering " << player.GetDuration()
+		<< "s at " << (speed > 0.0f ? std::to_string((int)speed) + "x" : std::string("full speed"))
+		<< ", as peer " << peer << " saw it" << std::endl;
+
+	//Steps in the same frame size as the game, so interpolation sees what a
+	//client would - just with the frames arriving faster
+	using Clock = std::chrono::steady_clock;
+	const float frameDT		= 1.0f / 60.0f;
+	auto		frameLength = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(frameDT / std::max(speed, 1.0f)));
+	auto		start		= Clock::now();
+	auto		nextFrame	= start;
+	float		replayTime	= 0.0f;
+
+	bool playing = true;
+	while (playing) {
+		replayTime += frameDT;
+		playing = player.PlayUntil(replayTime);
+		decoder.Update(frameDT);
+
+		if (speed > 0.0f) {
+			nextFrame += frameLength;
+			std::this_thread::sleep_until(nextFrame);
+		}
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::cout << "Played " << player.GetRecordsPlayed() << " records in " << seconds << "s ("
+		<< (seconds > 0.0 ? player.GetDuration() / seconds : 0.0) << "x real time)" << std::endl;
+	std::cout << "  " << decoder.snapshotsDecoded << " snapshots decoded for " << decoder.GetObjectCount() << " objects, "
+		<< decoder.snapshotsRejected << " rejected, " << (decoder.snapshotsDecoded ? decoder.decodeTime / decoder.snapshotsDecoded * 1000000.0 : 0.0)
+		<< "us each" << std::endl;
+	std::cout << "  " << decoder.playerStates << " player states, " << decoder.acks << " acks" << std::endl;
+	for (int p = 0; p < (int)decoder.inputsPerPeer.size(); ++p) {
+		if (decoder.inputsPerPeer[p] > 0) {
+			std::cout << "  peer " << p << ": " << decoder.inputsPerPeer[p] << " inputs, newest " << decoder.newestInput[p] << std::endl;
+		}
+	}
+	if (decoder.inputsOutOfOrder > 0) {
+		std::cout << "  " << decoder.inputsOutOfOrder << " inputs arrived out of order" << std::endl;
+	}
+	std::cout << "  final state hash " << std::hex << std::setw(8) << std::setfill('0') << decoder.GetStateHash() << std::dec << std::endl;
+	return 0;
+}
@@ -0,0 +1,119 @@
+#include "ReplayDecoder.h"
+#include "GameObject.h"
+#include "NetworkObject.h"
+#include "EntityReplicator.h"
+
+#include <chrono>
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	void HashBytes(uint32_t& hash, const void* data, size_t length) {
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < length; ++i) {
+			hash = (hash ^ bytes[i]) * 16777619u;
+		}
+	}
+}
+
+ReplayDecoder::ReplayDecoder() {
+	snapshotsDecoded	= 0;
+	snapshotsRejected	= 0;
+	decodeTime			= 0.0;
+	playerStates		= 0;
+	acks				= 0;
+	inputsOutOfOrder	= 0;
+}
+
+ReplayDecoder::~ReplayDecoder() {
+	for (GameObject* o : objects) {
+		delete o;
+	}
+}
+
+void ReplayDecoder::ReceivePacket(int type, GamePacket* payload, int source) {
+	//The log's sizes have been checked against the file, but not against
+	//what each type needs before it can be cast
+	if (payload->size < NetworkBase::GetMinimumPayload(type)) {
+		return;
+	}
+	if (type == Player_Input) {
+		if (source < 0) {
+			return;
+		}
+		if (source >= (int)inputsPerPeer.size()) {
+			inputsPerPeer.resize(source + 1, 0);
+			newestInput.resize(source + 1, -1);
+		}
+		int sequence = ((ClientPacket*)payload)->sequence;
+		if (sequence <= newestInput[source]) {
+			inputsOutOfOrder++;
+		}
+		newestInput[source] = std::max(newestInput[source], sequence);
+		inputsPerPeer[source]++;
+		return;
+	}
+	if (type == Ack_State || type == Received_State) {
+		acks++;
+		return;
+	}
+	if (type == Player_State) {
+		playerStates++;
+		return;
+	}
+	if (type != Full_State && type != Delta_State) {
+		return;
+	}
+	int id = type == Full_State ? ((FullPacket*)payload)->objectID : ((DeltaPacket*)payload)->objectID;
+	if (id < 0 || id > MAX_NETWORK_ID) {
+		snapshotsRejected++;
+		return;
+	}
+	if (id >= (int)objects.size()) {
+		objects.resize(id + 1, nullptr);
+	}
+	if (!objects[id]) {
+		objects[id] = new GameObject("replay object");
+		objects[id]->SetNetworkObject(new NetworkObject(*objects[id], id));
+	}
+	auto start = std::chrono::steady_clock::now();
+	if (objects[id]->GetNetworkObject()->ReadPacket(*payload)) {
+		snapshotsDecoded++;
+	}
+	else {
+		snapshotsRejected++;
+	}
+	decodeTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ReplayDecoder::Update(float dt) {
+	for (GameObject* o : objects) {
+		if (o) {
+			o->GetNetworkObject()->UpdateInterpolation(dt);
+		}
+	}
+}
+
+uint32_t ReplayDecoder::GetStateHash() const {
+	uint32_t hash = 2166136261u;
+	for (int id = 0; id < (int)objects.size(); ++id) {
+		if (!objects[id]) {
+			continue;
+		}
+		const NetworkState& state = objects[id]->GetNetworkObject()->GetLatestNetworkState();
+		HashBytes(hash, &id, sizeof(id));
+		HashBytes(hash, &state.position, sizeof(state.position));
+		HashBytes(hash, &state.orientation, sizeof(state.orientation));
+		HashBytes(hash, &state.stateID, sizeof(state.stateID));
+	}
+	return hash;
+}
+
+int ReplayDecoder::GetObjectCount() const {
+	int count = 0;
+	for (GameObject* o : objects) {
+		count += o ? 1 : 0;
+	}
+	return count;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "NetworkBase.h"
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		class GameObject;
+
+		/*
+		Stands in for both ends of a recorded game. Snapshots are decoded
+		into network objects through NetworkObject::ReadPacket and played
+		through their interpolation buffers, exactly as a client would, and
+		client inputs are checked and counted per peer as the server saw
+		them. Deltas are built against each client's own acks, so only one
+		client's snapshots should be played into a decoder.
+
+		GetStateHash covers the last state decoded for every object, so two
+		playbacks of the same log - or a playback and a live client - can
+		be compared to find where they went different.
+		*/
+		class ReplayDecoder : public PacketReceiver {
+		public:
+			ReplayDecoder();
+			~ReplayDecoder();
+
+			void ReceivePacket(int type, GamePacket* payload, int source) override;
+
+			//Moves every object along its interpolation buffer
+			void Update(float dt);
+
+			uint32_t GetStateHash() const;
+
+			int GetObjectCount() const;
+
+			int		snapshotsDecoded;
+			int		snapshotsRejected;	//deltas whose baseline we never saw, etc.
+			double	decodeTime;			//seconds spent inside ReadPacket
+			int		playerStates;
+			int		acks;
+
+			std::vector<int> inputsPerPeer;
+			std::vector<int> newestInput;	//per peer, for spotting inputs out of order
+			int		inputsOutOfOrder;
+
+		protected:
+			std::vector<GameObject*> objects; //indexed by network ID
+		};
+	}
+}